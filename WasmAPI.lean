@@ -35,38 +35,16 @@ import LeanServerPure
   - `wasm_bytes_to_hex(data, len) → ptr`
   - `wasm_hex_to_bytes(hex_str) → ptr`
 
-  All returned pointers point to length-prefixed byte buffers:
-    [4 bytes LE length][payload...]
-  The JS glue reads the length, copies the payload, then frees.
+  All exports return the result ByteArray itself, with no framing.
+  The C glue (`wasm/wasm_glue.c`) reports its length through the
+  `out_len` pointer, or copies it into a caller-provided buffer.
+  `wasm_aes_gcm_decrypt`, `wasm_huffman_decode` and `wasm_base64_decode`
+  return `Option ByteArray`. The glue maps `none` to a distinct status
+  (`JS_RESULT_NONE`), so an empty result and a failure differ.
 -/
 
 namespace LeanServerWASM
 
--- ═══════════════════════════════════════════════════════════
--- Helpers: ByteArray ↔ C buffer interop
--- ═══════════════════════════════════════════════════════════
-
-/-- Pack a ByteArray into a length-prefixed buffer for JS consumption. -/
-def packResult (b : ByteArray) : ByteArray :=
-  let len := b.size
-  let header := ByteArray.mk #[
-    (len &&& 0xFF).toUInt8,
-    ((len >>> 8) &&& 0xFF).toUInt8,
-    ((len >>> 16) &&& 0xFF).toUInt8,
-    ((len >>> 24) &&& 0xFF).toUInt8
-  ]
-  header ++ b
-
-/-- Pack a String result (UTF-8) into a length-prefixed buffer. -/
-def packString (s : String) : ByteArray :=
-  packResult s.toUTF8
-
-/-- Pack an Option ByteArray — returns empty (len=0) on None. -/
-def packOption (o : Option ByteArray) : ByteArray :=
-  match o with
-  | some b => packResult b
-  | none   => packResult ByteArray.empty
-
 -- ═══════════════════════════════════════════════════════════
 -- SHA-256 & HMAC & HKDF
 -- ═══════════════════════════════════════════════════════════
@@ -74,29 +52,29 @@ def packOption (o : Option ByteArray) : ByteArray :=
 /-- SHA-256 hash. Returns 32-byte digest. -/
 @[export wasm_sha256]
 def wasm_sha256 (data : ByteArray) : ByteArray :=
-  packResult (LeanServer.sha256 data)
+  LeanServer.sha256 data
 
 /-- HMAC-SHA-256. Returns 32-byte MAC. -/
 @[export wasm_hmac_sha256]
 def wasm_hmac_sha256 (key : ByteArray) (msg : ByteArray) : ByteArray :=
-  packResult (LeanServer.hmac_sha256 key msg)
+  LeanServer.hmac_sha256 key msg
 
 /-- HKDF-Extract (TLS 1.3 key extraction). Returns 32-byte PRK. -/
 @[export wasm_hkdf_extract]
 def wasm_hkdf_extract (salt : ByteArray) (ikm : ByteArray) : ByteArray :=
-  packResult (LeanServer.hkdf_extract salt ikm)
+  LeanServer.hkdf_extract salt ikm
 
 /-- HKDF-Expand-Label (TLS 1.3). Returns derived key material. -/
 @[export wasm_hkdf_expand_label]
 def wasm_hkdf_expand_label (secret : ByteArray) (label : String)
     (context : ByteArray) (length : UInt16) : ByteArray :=
-  packResult (LeanServer.hkdfExpandLabel secret label context length)
+  LeanServer.hkdfExpandLabel secret label context length
 
 /-- Derive secret (TLS 1.3 convenience wrapper). -/
 @[export wasm_derive_secret]
 def wasm_derive_secret (secret : ByteArray) (label : String)
     (context : ByteArray) : ByteArray :=
-  packResult (LeanServer.deriveSecret secret label context)
+  LeanServer.deriveSecret secret label context
 
 -- ═══════════════════════════════════════════════════════════
 -- AES-128-GCM
@@ -107,13 +85,13 @@ def wasm_derive_secret (secret : ByteArray) (label : String)
 def wasm_aes_gcm_encrypt (key : ByteArray) (iv : ByteArray)
     (aad : ByteArray) (plaintext : ByteArray) : ByteArray :=
   let (ct, tag) := LeanServer.aes128_gcm_encrypt key iv aad plaintext
-  packResult (ct ++ tag)
+  ct ++ tag
 
-/-- AES-128-GCM decrypt. Returns plaintext or empty on auth failure. -/
+/-- AES-128-GCM decrypt. Returns plaintext, or `none` on auth failure. -/
 @[export wasm_aes_gcm_decrypt]
 def wasm_aes_gcm_decrypt (key : ByteArray) (iv : ByteArray)
-    (aad : ByteArray) (ciphertextWithTag : ByteArray) : ByteArray :=
-  packOption (LeanServer.aes128_gcm_decrypt key iv aad ciphertextWithTag)
+    (aad : ByteArray) (ciphertextWithTag : ByteArray) : Option ByteArray :=
+  LeanServer.aes128_gcm_decrypt key iv aad ciphertextWithTag
 
 -- ═══════════════════════════════════════════════════════════
 -- X25519 Key Exchange
@@ -123,12 +101,12 @@ def wasm_aes_gcm_decrypt (key : ByteArray) (iv : ByteArray)
     Returns 32-byte public key. -/
 @[export wasm_x25519_base]
 def wasm_x25519_base (privateKey : ByteArray) : ByteArray :=
-  packResult (LeanServer.X25519.scalarmult_base privateKey)
+  LeanServer.X25519.scalarmult_base privateKey
 
 /-- X25519 Diffie-Hellman. Returns 32-byte shared secret. -/
 @[export wasm_x25519_scalarmult]
 def wasm_x25519_scalarmult (scalar : ByteArray) (point : ByteArray) : ByteArray :=
-  packResult (LeanServer.X25519.scalarmult scalar point)
+  LeanServer.X25519.scalarmult scalar point
 
 -- ═══════════════════════════════════════════════════════════
 -- Hex Encoding
@@ -137,12 +115,12 @@ def wasm_x25519_scalarmult (scalar : ByteArray) (point : ByteArray) : ByteArray
 /-- Encode bytes to hex string. -/
 @[export wasm_bytes_to_hex]
 def wasm_bytes_to_hex (data : ByteArray) : ByteArray :=
-  packString (LeanServer.bytesToHex data)
+  (LeanServer.bytesToHex data).toUTF8
 
 /-- Decode hex string to bytes. -/
 @[export wasm_hex_to_bytes]
 def wasm_hex_to_bytes (hexStr : String) : ByteArray :=
-  packResult (LeanServer.hexToBytes hexStr)
+  LeanServer.hexToBytes hexStr
 
 -- ═══════════════════════════════════════════════════════════
 -- HPACK (HTTP/2 Header Compression)
@@ -151,7 +129,7 @@ def wasm_hex_to_bytes (hexStr : String) : ByteArray :=
 /-- Encode headers (stateless). Input: array of (name, value) pairs. -/
 @[export wasm_hpack_encode]
 def wasm_hpack_encode (headers : Array (String × String)) : ByteArray :=
-  packResult (LeanServer.encodeHeadersPublic headers)
+  LeanServer.encodeHeadersPublic headers
 
 /-- Decode HPACK-encoded header block.
     Returns serialized header list or empty on failure. -/
@@ -167,12 +145,11 @@ def wasm_hpack_decode (data : ByteArray) : ByteArray :=
       ((n >>> 24) &&& 0xFF).toUInt8
     ]
     let count := headers.size
-    let buf := headers.foldl (init := encodeLen count) fun acc h =>
+    headers.foldl (init := encodeLen count) fun acc h =>
       let nameBytes := h.name.toUTF8
       let valBytes := h.value.toUTF8
       acc ++ encodeLen nameBytes.size ++ nameBytes ++ encodeLen valBytes.size ++ valBytes
-    packResult buf
-  | none => packResult ByteArray.empty
+  | none => ByteArray.empty
 
 -- ═══════════════════════════════════════════════════════════
 -- HTTP/2 Frames
@@ -183,8 +160,8 @@ def wasm_hpack_decode (data : ByteArray) : ByteArray :=
 @[export wasm_http2_parse_frame]
 def wasm_http2_parse_frame (data : ByteArray) : ByteArray :=
   match LeanServer.parseHTTP2Frame data with
-  | some frame => packResult (LeanServer.serializeHTTP2Frame frame)
-  | none       => packResult ByteArray.empty
+  | some frame => LeanServer.serializeHTTP2Frame frame
+  | none       => ByteArray.empty
 
 /-- Serialize an HTTP/2 frame. -/
 @[export wasm_http2_serialize_frame]
@@ -193,8 +170,8 @@ def wasm_http2_serialize_frame (frameType : UInt8) (flags : UInt8)
   match LeanServer.FrameType.fromByte frameType with
   | some ft =>
     let frame := LeanServer.createHTTP2Frame ft flags streamId payload
-    packResult (LeanServer.serializeHTTP2Frame frame)
-  | none => packResult ByteArray.empty
+    LeanServer.serializeHTTP2Frame frame
+  | none => ByteArray.empty
 
 -- ═══════════════════════════════════════════════════════════
 -- TLS 1.3 Handshake
@@ -205,8 +182,8 @@ def wasm_http2_serialize_frame (frameType : UInt8) (flags : UInt8)
 @[export wasm_tls_parse_client_hello]
 def wasm_tls_parse_client_hello (data : ByteArray) : ByteArray :=
   match LeanServer.parseClientHello data with
-  | some ch => packResult ch.clientRandom  -- return clientRandom for now
-  | none    => packResult ByteArray.empty
+  | some ch => ch.clientRandom  -- return clientRandom for now
+  | none    => ByteArray.empty
 
 /-- Derive TLS 1.3 handshake keys from shared secret + hello hash. -/
 @[export wasm_tls_derive_handshake]
@@ -215,7 +192,7 @@ def wasm_tls_derive_handshake (sharedSecret : ByteArray)
   let keys : LeanServer.HandshakeKeys :=
     LeanServer.TLSKeySchedule.deriveHandshake sharedSecret helloHash
   -- Pack: serverKey(16) ++ serverIV(12) ++ clientKey(16) ++ clientIV(12)
-  packResult (keys.serverKey ++ keys.serverIV ++ keys.clientKey ++ keys.clientIV)
+  keys.serverKey ++ keys.serverIV ++ keys.clientKey ++ keys.clientIV
 
 /-- Derive TLS 1.3 application keys from handshake secret + hello hash. -/
 @[export wasm_tls_derive_application]
@@ -223,7 +200,7 @@ def wasm_tls_derive_application (handshakeSecret : ByteArray)
     (helloHash : ByteArray) : ByteArray :=
   let keys : LeanServer.ApplicationKeys :=
     LeanServer.TLSKeySchedule.deriveApplication handshakeSecret helloHash
-  packResult (keys.serverKey ++ keys.serverIV ++ keys.clientKey ++ keys.clientIV)
+  keys.serverKey ++ keys.serverIV ++ keys.clientKey ++ keys.clientIV
 
 -- ═══════════════════════════════════════════════════════════
 -- Huffman (HPACK sub-codec)
@@ -232,20 +209,20 @@ def wasm_tls_derive_application (handshakeSecret : ByteArray)
 /-- Huffman-encode a byte array. -/
 @[export wasm_huffman_encode]
 def wasm_huffman_encode (data : ByteArray) : ByteArray :=
-  packResult (LeanServer.huffmanEncode data)
+  LeanServer.huffmanEncode data
 
-/-- Huffman-decode a byte array. -/
+/-- Huffman-decode a byte array. Returns `none` on invalid input. -/
 @[export wasm_huffman_decode]
-def wasm_huffman_decode (data : ByteArray) : ByteArray :=
-  packOption (LeanServer.huffmanDecode data)
+def wasm_huffman_decode (data : ByteArray) : Option ByteArray :=
+  LeanServer.huffmanDecode data
 
 -- ═══════════════════════════════════════════════════════════
 -- Base64
 -- ═══════════════════════════════════════════════════════════
 
-/-- Base64-decode a string. -/
+/-- Base64-decode a string. Returns `none` on invalid input. -/
 @[export wasm_base64_decode]
-def wasm_base64_decode (encoded : String) : ByteArray :=
-  packOption (LeanServer.Base64.decode encoded)
+def wasm_base64_decode (encoded : String) : Option ByteArray :=
+  LeanServer.Base64.decode encoded
 
 end LeanServerWASM
@@ -7,7 +7,28 @@
 #   • Emscripten SDK (emcc in PATH)
 #   • LeanServer (fetched by Lake as git dependency, or local at ../LeanServer6)
 #
-# Output: dist/lean_crypto.{js,wasm}
+# Output: dist/lean_crypto.{js,wasm}  (override the directory with OUT_DIR)
+#
+# Runtime options (environment variables):
+#   WASM_ARENA=1   Per-call bump arena for Lean objects (-DLEAN_WASM_ARENA)
+#   WASM_SLAB=1    Size-class slab allocator for small objects (-DLEAN_WASM_SLAB)
+#   WASM_DEFERRED_FREE=1
+#                  Batch frees per call, reuse same-size objects
+#                  (-DLEAN_WASM_DEFERRED_FREE)
+#   WASM_ALLOC_STATS=1
+#                  Count allocations by tag and size, live/peak bytes
+#                  (-DLEAN_WASM_ALLOC_STATS)
+#   WASM_COW_STATS=1
+#                  Count copies of shared arrays/strings (-DLEAN_WASM_COW_STATS)
+#   WASM_SIMD=1    Enable wasm simd128 (-msimd128); the runtime's string
+#                  scanners then test 16 bytes per step
+#   WASM_MALLOC=mimalloc
+#                  Link Emscripten's mimalloc and keep lean.h's LEAN_MIMALLOC
+#                  allocation path (-sMALLOC=mimalloc -DLEAN_WASM_MIMALLOC)
+#   WASM_THREADS=1 Thread-safe runtime that runs Lean tasks on a pool of
+#                  worker threads (-pthread -DLEAN_WASM_THREADS); not
+#                  combinable with the arena, slab, deferred-free or stats
+#                  options
 # ──────────────────────────────────────────────────────────────
 set -euo pipefail
 
@@ -27,7 +48,57 @@ else
   exit 1
 fi
 WASM_IR=".lake/build/ir"
-OUT_DIR="dist"
+OUT_DIR="${OUT_DIR:-dist}"
+
+# ── Runtime options ──────────────────────────────────────────
+RUNTIME_FLAGS=""
+if [ "${WASM_ARENA:-0}" = "1" ]; then
+  RUNTIME_FLAGS="${RUNTIME_FLAGS} -DLEAN_WASM_ARENA"
+fi
+if [ "${WASM_SLAB:-0}" = "1" ]; then
+  RUNTIME_FLAGS="${RUNTIME_FLAGS} -DLEAN_WASM_SLAB"
+fi
+if [ "${WASM_DEFERRED_FREE:-0}" = "1" ]; then
+  RUNTIME_FLAGS="${RUNTIME_FLAGS} -DLEAN_WASM_DEFERRED_FREE"
+fi
+if [ "${WASM_ALLOC_STATS:-0}" = "1" ]; then
+  RUNTIME_FLAGS="${RUNTIME_FLAGS} -DLEAN_WASM_ALLOC_STATS"
+fi
+if [ "${WASM_COW_STATS:-0}" = "1" ]; then
+  RUNTIME_FLAGS="${RUNTIME_FLAGS} -DLEAN_WASM_COW_STATS"
+fi
+if [ "${WASM_SIMD:-0}" = "1" ]; then
+  RUNTIME_FLAGS="${RUNTIME_FLAGS} -msimd128"
+fi
+EMCC_THREADS=""
+if [ "${WASM_THREADS:-0}" = "1" ]; then
+  for opt in WASM_ARENA WASM_SLAB WASM_DEFERRED_FREE WASM_ALLOC_STATS WASM_COW_STATS; do
+    if [ "${!opt:-0}" = "1" ]; then
+      echo "❌ WASM_THREADS=1 cannot be combined with ${opt}=1"
+      exit 1
+    fi
+  done
+  RUNTIME_FLAGS="${RUNTIME_FLAGS} -pthread -DLEAN_WASM_THREADS"
+  # One worker per core; navigator is undefined under Node, so fall back
+  # to os.cpus() there. No spaces: ${EMCC_THREADS} is expanded unquoted.
+  EMCC_THREADS="-s PTHREAD_POOL_SIZE=(typeof(navigator)!=='undefined'&&navigator.hardwareConcurrency)||require('os').cpus().length"
+fi
+EMCC_MALLOC=""
+case "${WASM_MALLOC:-dlmalloc}" in
+  dlmalloc) ;;
+  mimalloc)
+    if [ "${WASM_SLAB:-0}" = "1" ]; then
+      echo "❌ WASM_SLAB=1 and WASM_MALLOC=mimalloc are alternative allocators"
+      exit 1
+    fi
+    EMCC_MALLOC="-s MALLOC=mimalloc"
+    RUNTIME_FLAGS="${RUNTIME_FLAGS} -DLEAN_WASM_MIMALLOC"
+    ;;
+  *)
+    echo "❌ Unknown WASM_MALLOC='${WASM_MALLOC}' (expected dlmalloc or mimalloc)"
+    exit 1
+    ;;
+esac
 
 echo "═══════════════════════════════════════════════════════════"
 echo "  LeanServerWASM → WebAssembly Build"
@@ -36,6 +107,8 @@ echo ""
 echo "  Lean prefix:  ${LEAN_PREFIX}"
 echo "  Include dir:  ${LEAN_INCLUDE}"
 echo "  Output:       ${OUT_DIR}/lean_crypto.{js,wasm}"
+echo "  Runtime:      ${RUNTIME_FLAGS:-(defaults)}"
+echo "  Allocator:    ${WASM_MALLOC:-dlmalloc}"
 echo ""
 
 # ── Step 1: Build Lean → C ──────────────────────────────────
@@ -79,19 +152,59 @@ mkdir -p "${OUT_DIR}"
 
 EXPORTED_FUNCTIONS="[
   '_js_sha256',
+  '_js_sha256_h',
+  '_js_sha256_into',
+  '_js_sha256_many',
   '_js_hmac_sha256',
+  '_js_hmac_sha256_h',
+  '_js_hmac_sha256_into',
   '_js_hkdf_extract',
+  '_js_hkdf_extract_h',
+  '_js_hkdf_extract_into',
   '_js_aes_gcm_encrypt',
+  '_js_aes_gcm_encrypt_h',
+  '_js_aes_gcm_encrypt_into',
   '_js_aes_gcm_decrypt',
+  '_js_aes_gcm_decrypt_h',
+  '_js_aes_gcm_decrypt_into',
   '_js_x25519_base',
+  '_js_x25519_base_h',
+  '_js_x25519_base_into',
   '_js_x25519_scalarmult',
+  '_js_x25519_scalarmult_h',
+  '_js_x25519_scalarmult_into',
+  '_js_x25519_keypair',
+  '_js_x25519_keypair_into',
   '_js_bytes_to_hex',
+  '_js_bytes_to_hex_h',
+  '_js_bytes_to_hex_into',
   '_js_hpack_decode',
+  '_js_hpack_decode_h',
+  '_js_hpack_decode_into',
   '_js_huffman_encode',
+  '_js_huffman_encode_h',
+  '_js_huffman_encode_into',
   '_js_huffman_decode',
+  '_js_huffman_decode_h',
+  '_js_huffman_decode_into',
   '_js_tls_derive_handshake',
+  '_js_tls_derive_handshake_h',
+  '_js_tls_derive_handshake_into',
   '_js_tls_derive_application',
+  '_js_tls_derive_application_h',
+  '_js_tls_derive_application_into',
   '_js_http2_parse_frame',
+  '_js_http2_parse_frame_h',
+  '_js_http2_parse_frame_into',
+  '_js_alloc_byte_array',
+  '_js_free_byte_array',
+  '_js_take_result_into',
+  '_js_batch',
+  '_js_alloc_stats',
+  '_js_alloc_stats_reset',
+  '_js_cow_stats',
+  '_js_cow_stats_reset',
+  '_js_now_ns',
   '_js_free',
   '_malloc',
   '_free'
@@ -111,6 +224,8 @@ emcc \
   -O2 \
   -s WASM=1 \
   -s ALLOW_MEMORY_GROWTH=1 \
+  ${EMCC_MALLOC} \
+  ${EMCC_THREADS} \
   -s INITIAL_MEMORY=67108864 \
   -s MAXIMUM_MEMORY=536870912 \
   -s EXPORTED_FUNCTIONS="${EXPORTED_FUNCTIONS}" \
@@ -120,10 +235,11 @@ emcc \
   -s NO_EXIT_RUNTIME=1 \
   -s FILESYSTEM=0 \
   -s ASSERTIONS=0 \
-  -s ENVIRONMENT='web,worker' \
+  -s ENVIRONMENT='web,worker,node' \
   -I wasm \
   -I "${LEAN_INCLUDE}" \
   -DLEAN_EMSCRIPTEN \
+  ${RUNTIME_FLAGS} \
   wasm/lean_runtime_wasm.c \
   wasm/init_stubs_wasm.c \
   wasm/wasm_glue.c \
@@ -0,0 +1,84 @@
+/**
+ * LeanServer WASM — pool worker
+ *
+ * Hosts one LeanCrypto module instance for LeanServerCrypto.initPool().
+ * Runs as a classic Web Worker or as a Node worker_threads worker, so it
+ * has no static imports. The first message names lean_server_wasm.js and
+ * lean_crypto.js and is answered with { ready: true } (or { error }).
+ * Every later message is a call { id, method, args }, answered with
+ * { id, result, busyMs } or { id, error, busyMs }, where busyMs is the
+ * time spent inside the module. Result buffers are transferred back.
+ *
+ * If the first message also carries a `ring` (LeanServerCrypto.initRing),
+ * the worker instead serves that SharedArrayBuffer ring from then on and
+ * takes no further messages.
+ */
+
+/** The ArrayBuffers behind the Uint8Arrays in a result, each once. */
+function transferables(value) {
+  const buffers = new Set();
+  const visit = v => {
+    if (v instanceof Uint8Array) buffers.add(v.buffer);
+    else if (v && typeof v === 'object') Object.values(v).forEach(visit);
+  };
+  visit(value);
+  return [...buffers];
+}
+
+async function load({ apiUrl, wasmPath }) {
+  const api = await import(apiUrl);
+  let factory;
+  if (typeof importScripts === 'function') {
+    // Classic Web Worker: lean_crypto.js defines a global LeanCrypto
+    importScripts(wasmPath);
+    factory = self.LeanCrypto;
+  } else {
+    const m = await import(wasmPath);
+    factory = m.default || globalThis.LeanCrypto;
+  }
+  if (typeof factory !== 'function') {
+    throw new Error(`LeanCrypto not found in ${wasmPath}`);
+  }
+  return { api, crypto: new api.LeanServerCrypto(await factory()) };
+}
+
+(async () => {
+  let port;
+  if (typeof self !== 'undefined') {
+    // Set synchronously, before the first message can arrive
+    port = {
+      on: fn => { self.onmessage = e => fn(e.data); },
+      post: (msg, transfer) => self.postMessage(msg, transfer),
+    };
+  } else {
+    const { parentPort } = await import('node:worker_threads');
+    port = {
+      on: fn => parentPort.on('message', fn),
+      post: (msg, transfer) => parentPort.postMessage(msg, transfer),
+    };
+  }
+
+  let crypto = null;
+  port.on(async msg => {
+    if (msg.init) {
+      let api;
+      try {
+        ({ api, crypto } = await load(msg.init));
+        port.post({ ready: true });
+      } catch (e) {
+        port.post({ error: String((e && e.message) || e) });
+        return;
+      }
+      if (msg.init.ring) api.serveRing(crypto, msg.init.ring);
+      return;
+    }
+    const { id, method, args } = msg;
+    const t0 = performance.now();
+    try {
+      const result = crypto[method](...args);
+      port.post({ id, result, busyMs: performance.now() - t0 }, transferables(result));
+    } catch (e) {
+      port.post({ id, error: String((e && e.message) || e), busyMs: performance.now() - t0 });
+    }
+  });
+})();
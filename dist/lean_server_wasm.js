@@ -10,106 +10,258 @@
  *   const crypto = await LeanServerCrypto.init();
  *   const hash = crypto.sha256(new TextEncoder().encode('hello'));
  *   console.log(crypto.bytesToHex(hash));
+ *
+ *   // Off the calling thread, on one module instance per worker:
+ *   const pool = await LeanServerCrypto.initPool({ workers: 4 });
+ *   const digest = await pool.sha256(data);
  */
 
 /**
- * Read a 4-byte LE length prefix from the given buffer, then extract
- * the payload bytes.
+ * Length a js_*_into call returns for an `Option` result that is `none`
+ * (JS_RESULT_NONE in wasm_glue.c, i.e. (size_t)-1 on wasm32).
  */
-function unpack(module, ptr, totalLen) {
-  if (totalLen < 4) return new Uint8Array(0);
-  const heap = module.HEAPU8;
-  const payloadLen =
-    heap[ptr] |
-    (heap[ptr + 1] << 8) |
-    (heap[ptr + 2] << 16) |
-    (heap[ptr + 3] << 24);
-  if (payloadLen <= 0 || payloadLen + 4 > totalLen) return new Uint8Array(0);
-  return new Uint8Array(heap.buffer.slice(ptr + 4, ptr + 4 + payloadLen));
-}
+const RESULT_NONE = 0xFFFFFFFF;
 
-/**
- * Allocate WASM memory, copy data in, return pointer.
- */
-function toWasm(module, data) {
-  const ptr = module._malloc(data.length);
-  module.HEAPU8.set(data, ptr);
-  return ptr;
-}
+/** Initial size of the per-module output region; grows on demand. */
+const OUT_REGION_INITIAL = 64 * 1024;
 
 /**
- * Call a WASM function that takes (ptr, len) and returns a length-prefixed
- * result via an out-pointer.
+ * Layout of js_alloc_stats() (lean_wasm_alloc_stats in
+ * lean_runtime_wasm.h): allocs by tag, bytes by tag, allocs by size
+ * class, then frees, live bytes and peak bytes.
  */
-function callUnary(module, fn, data) {
-  const dataPtr = toWasm(module, data);
-  const outLenPtr = module._malloc(4);
+const ALLOC_STAT_TAGS = ['ctor', 'closure', 'array', 'sarray', 'string', 'other'];
+const ALLOC_STAT_SIZES = [16, 32, 64, 128, 256, 512, 1024, 4096, Infinity];
+const ALLOC_STATS_COUNT = 2 * ALLOC_STAT_TAGS.length + ALLOC_STAT_SIZES.length + 3;
 
-  const resultPtr = fn(dataPtr, data.length, outLenPtr);
-  const totalLen = module.HEAPU32[outLenPtr >> 2];
+/** Copy kinds reported by js_cow_stats() (LEAN_WASM_COW_* order). */
+const COW_KINDS = [
+  'array', 'arrayMap', 'byteArray', 'byteArraySlice', 'stringPush', 'stringAppend',
+  'stringSet',
+];
 
-  const result = unpack(module, resultPtr, totalLen);
+/**
+ * Per-module scratch state, allocated once:
+ *   cell   — 4-byte slot where js_alloc_byte_array writes the payload pointer
+ *   out    — output region the js_*_into calls write results into
+ *   outCap — current size of `out`
+ *   cmds   — region batch() and sha256Many() lay out their descriptors,
+ *            arguments and results in
+ *   cmdsCap — current size of `cmds` (0 until first used)
+ * Reusing it means a steady-state call makes no malloc/free of its own.
+ */
+const scratchState = new WeakMap();
 
-  module._js_free(resultPtr);
-  module._free(dataPtr);
-  module._free(outLenPtr);
+function scratch(module) {
+  let st = scratchState.get(module);
+  if (st === undefined) {
+    st = {
+      cell: module._malloc(4),
+      out: module._malloc(OUT_REGION_INITIAL),
+      outCap: OUT_REGION_INITIAL,
+      cmds: 0,
+      cmdsCap: 0,
+    };
+    scratchState.set(module, st);
+  }
+  return st;
+}
 
-  return result;
+/** The `cmds` region, grown to at least `size` bytes. Returns its address. */
+function cmdsRegion(module, size) {
+  const st = scratch(module);
+  if (size > st.cmdsCap) {
+    let cap = Math.max(st.cmdsCap, 4096);
+    while (cap < size) cap *= 2;
+    if (st.cmds) module._free(st.cmds);
+    st.cmds = module._malloc(cap);
+    st.cmdsCap = cap;
+  }
+  return st.cmds;
 }
 
 /**
- * Call a WASM function that takes (ptr1, len1, ptr2, len2) and returns
- * a length-prefixed result.
+ * Allocate a Lean ByteArray in WASM memory and write data straight into
+ * its payload. Returns the handle, which the js_*_into call consumes.
  */
-function callBinary(module, fn, a, b) {
-  const aPtr = toWasm(module, a);
-  const bPtr = toWasm(module, b);
-  const outLenPtr = module._malloc(4);
+function toLean(module, data) {
+  const cell = scratch(module).cell;
+  const handle = module._js_alloc_byte_array(data.length, cell);
+  // Re-read HEAPU8/HEAPU32: the allocation may have grown memory.
+  module.HEAPU8.set(data, module.HEAPU32[cell >> 2]);
+  return handle;
+}
 
-  const resultPtr = fn(aPtr, a.length, bPtr, b.length, outLenPtr);
-  const totalLen = module.HEAPU32[outLenPtr >> 2];
+/**
+ * Complete a js_*_into call that reported `n` result bytes. If the result
+ * did not fit, grow the output region and fetch the kept result. Returns
+ * a view of the result in WASM memory, valid until the next call, or null
+ * for RESULT_NONE.
+ */
+function resultView(module, n) {
+  n >>>= 0;  // size_t comes back as a signed i32
+  if (n === RESULT_NONE) return null;
+  const st = scratch(module);
+  if (n > st.outCap) {
+    let cap = st.outCap;
+    while (cap < n) cap *= 2;
+    module._free(st.out);
+    st.out = module._malloc(cap);
+    st.outCap = cap;
+    module._js_take_result_into(st.out, cap);
+  }
+  return module.HEAPU8.subarray(st.out, st.out + n);
+}
 
-  const result = unpack(module, resultPtr, totalLen);
+/**
+ * Copy a result view into `out` (returning the filled prefix), or into a
+ * fresh Uint8Array when no output buffer was given.
+ */
+function deliver(view, out) {
+  if (!out) return view.slice();
+  if (out.length < view.length) {
+    throw new RangeError(
+      `Output buffer too small: need ${view.length} bytes, got ${out.length}`
+    );
+  }
+  out.set(view);
+  return out.subarray(0, view.length);
+}
 
-  module._js_free(resultPtr);
-  module._free(aPtr);
-  module._free(bPtr);
-  module._free(outLenPtr);
+/**
+ * Call a js_*_into function taking one byte-array argument.
+ * Returns a view of the result in WASM memory.
+ */
+function callUnary(module, fn, data) {
+  const st = scratch(module);
+  const n = fn(toLean(module, data), st.out, st.outCap);
+  return resultView(module, n);
+}
 
-  return result;
+/**
+ * Call a js_*_into function taking two byte-array arguments.
+ */
+function callBinary(module, fn, a, b) {
+  const st = scratch(module);
+  const n = fn(toLean(module, a), toLean(module, b), st.out, st.outCap);
+  return resultView(module, n);
 }
 
 /**
- * Call a WASM function with 4 byte-array arguments.
+ * Call a js_*_into function with 4 byte-array arguments.
  */
 function callQuad(module, fn, a, b, c, d) {
-  const aPtr = toWasm(module, a);
-  const bPtr = toWasm(module, b);
-  const cPtr = toWasm(module, c);
-  const dPtr = toWasm(module, d);
-  const outLenPtr = module._malloc(4);
-
-  const resultPtr = fn(
-    aPtr, a.length,
-    bPtr, b.length,
-    cPtr, c.length,
-    dPtr, d.length,
-    outLenPtr
+  const st = scratch(module);
+  const n = fn(
+    toLean(module, a),
+    toLean(module, b),
+    toLean(module, c),
+    toLean(module, d),
+    st.out, st.outCap
   );
-  const totalLen = module.HEAPU32[outLenPtr >> 2];
+  return resultView(module, n);
+}
+
+/**
+ * Call a js_*_into function with any number of byte-array arguments.
+ */
+function callN(module, fn, args) {
+  const st = scratch(module);
+  const handles = args.map(a => toLean(module, a));
+  return resultView(module, fn(...handles, st.out, st.outCap));
+}
+
+/** Split the 64-byte result of js_x25519_keypair into its two keys. */
+function decodeKeyPair(pair) {
+  return { privateKey: pair.slice(0, 32), publicKey: pair.slice(32, 64) };
+}
 
-  const result = unpack(module, resultPtr, totalLen);
+/** Decode the [count][len name][len value]... list js_hpack_decode returns. */
+function decodeHeaders(buf) {
+  if (buf.length < 4) return [];
 
-  module._js_free(resultPtr);
-  module._free(aPtr);
-  module._free(bPtr);
-  module._free(cPtr);
-  module._free(dPtr);
-  module._free(outLenPtr);
+  const view = new DataView(buf.buffer, buf.byteOffset, buf.byteLength);
+  const count = view.getUint32(0, true);
+  const headers = [];
+  let offset = 4;
 
-  return result;
+  for (let i = 0; i < count && offset < buf.length; i++) {
+    const nameLen = view.getUint32(offset, true); offset += 4;
+    const name = new TextDecoder().decode(buf.subarray(offset, offset + nameLen));
+    offset += nameLen;
+
+    const valLen = view.getUint32(offset, true); offset += 4;
+    const value = new TextDecoder().decode(buf.subarray(offset, offset + valLen));
+    offset += valLen;
+
+    headers.push({ name, value });
+  }
+  return headers;
 }
 
+/** Split the 56-byte key block of the TLS key-derivation exports. */
+function decodeTrafficKeys(buf) {
+  return {
+    serverKey: buf.slice(0, 16),
+    serverIV:  buf.slice(16, 28),
+    clientKey: buf.slice(28, 44),
+    clientIV:  buf.slice(44, 56),
+  };
+}
+
+/**
+ * Operations that can be described in memory rather than called, by the
+ * ring and by batch(). The opcode is the index (JS_OP_* in wasm_glue.c).
+ * `out` gives the result size from the argument lengths: exact where
+ * `fixed` is set, otherwise an estimate.
+ */
+const OPS = [
+  { name: 'sha256',               fn: '_js_sha256_into',               arity: 1,
+    out: () => 32, fixed: true },
+  { name: 'hmacSha256',           fn: '_js_hmac_sha256_into',          arity: 2,
+    out: () => 32, fixed: true },
+  { name: 'hkdfExtract',          fn: '_js_hkdf_extract_into',         arity: 2,
+    out: () => 32, fixed: true },
+  { name: 'aesGcmEncrypt',        fn: '_js_aes_gcm_encrypt_into',      arity: 4,
+    out: n => n[3] + 16 },
+  { name: 'aesGcmDecrypt',        fn: '_js_aes_gcm_decrypt_into',      arity: 4,
+    out: n => n[3] },
+  { name: 'x25519PublicKey',      fn: '_js_x25519_base_into',          arity: 1,
+    out: () => 32, fixed: true },
+  { name: 'x25519SharedSecret',   fn: '_js_x25519_scalarmult_into',    arity: 2,
+    out: () => 32, fixed: true },
+  { name: 'x25519KeyPair',        fn: '_js_x25519_keypair_into',       arity: 0,
+    out: () => 64, fixed: true, decode: decodeKeyPair },
+  { name: 'bytesToHex',           fn: '_js_bytes_to_hex_into',         arity: 1,
+    out: n => 2 * n[0], decode: buf => new TextDecoder().decode(buf) },
+  { name: 'hpackDecode',          fn: '_js_hpack_decode_into',         arity: 1,
+    out: n => 4 + 64 * n[0], decode: decodeHeaders },
+  { name: 'huffmanEncode',        fn: '_js_huffman_encode_into',       arity: 1,
+    out: n => 4 * n[0] },
+  { name: 'huffmanDecode',        fn: '_js_huffman_decode_into',       arity: 1,
+    out: n => Math.ceil(8 * n[0] / 5) },
+  { name: 'tlsDeriveHandshake',   fn: '_js_tls_derive_handshake_into', arity: 2,
+    out: () => 56, fixed: true, decode: decodeTrafficKeys },
+  { name: 'tlsDeriveApplication', fn: '_js_tls_derive_application_into', arity: 2,
+    out: () => 56, fixed: true, decode: decodeTrafficKeys },
+  { name: 'http2ParseFrame',      fn: '_js_http2_parse_frame_into',    arity: 1,
+    out: n => n[0] + 16 },
+];
+
+const OP_CODES = new Map(OPS.map((op, opcode) => [op.name, opcode]));
+
+/** Words of an operation descriptor (js_batch_cmd in wasm_glue.c):
+    opcode, argument offsets and lengths, output offset and capacity,
+    then the status written back. */
+const MAX_ARGS = 4;
+const D_OP = 0;
+const D_ARG_OFF = 1;
+const D_ARG_LEN = D_ARG_OFF + MAX_ARGS;
+const D_OUT_OFF = D_ARG_LEN + MAX_ARGS;
+const D_OUT_CAP = D_OUT_OFF + 1;
+const D_STATUS = D_OUT_CAP + 1;
+const DESC_WORDS = 16;
+
 export class LeanServerCrypto {
   constructor(module) {
     this._mod = module;
@@ -136,35 +288,123 @@ export class LeanServerCrypto {
     return new LeanServerCrypto(mod);
   }
 
+  /**
+   * Start a pool of module instances in Web Workers (browsers) or
+   * worker_threads (Node), each running lean_crypto_worker.js.
+   * @param {Object} [options]
+   * @param {number} [options.workers] - Number of workers
+   *   (default: one per core)
+   * @param {string} [options.wasmPath] - URL of lean_crypto.js
+   *   (default: next to this file)
+   * @param {string} [options.workerPath] - URL of lean_crypto_worker.js
+   *   (default: next to this file)
+   * @param {boolean} [options.transfer=false] - Move argument buffers to
+   *   the worker instead of copying them. A moved buffer is detached, so
+   *   the caller must not use it again
+   * @returns {Promise<LeanServerCryptoPool>}
+   */
+  static async initPool(options = {}) {
+    const wasmPath = options.wasmPath || new URL('./lean_crypto.js', import.meta.url).href;
+    const workerPath = options.workerPath || new URL('./lean_crypto_worker.js', import.meta.url);
+    const n = options.workers || await defaultWorkerCount();
+    const init = { apiUrl: import.meta.url, wasmPath: String(wasmPath) };
+    const ports = await Promise.all(
+      Array.from({ length: n }, () => startWorker(workerPath, init)));
+    return new LeanServerCryptoPool(ports, !!options.transfer);
+  }
+
+  /**
+   * Start one worker that takes requests from a submission/completion
+   * ring in a SharedArrayBuffer instead of from postMessage. Browsers
+   * only provide SharedArrayBuffer to cross-origin isolated pages.
+   * @param {Object} [options]
+   * @param {string} [options.wasmPath] - URL of lean_crypto.js
+   * @param {string} [options.workerPath] - URL of lean_crypto_worker.js
+   * @param {number} [options.slots=64] - Requests in flight (power of two)
+   * @param {number} [options.slotBytes=65536] - Room for the arguments and
+   *   result of one request
+   * @param {number} [options.timeout=Infinity] - Milliseconds the worker may
+   *   go without completing a request while some are in flight. Past that
+   *   it is considered hung: it is stopped and every pending request is
+   *   rejected
+   * @returns {Promise<LeanServerCryptoRing>}
+   */
+  static async initRing(options = {}) {
+    const wasmPath = options.wasmPath || new URL('./lean_crypto.js', import.meta.url).href;
+    const workerPath = options.workerPath || new URL('./lean_crypto_worker.js', import.meta.url);
+    const slots = options.slots || 64;
+    const slotBytes = options.slotBytes || 64 * 1024;
+    if (slots & (slots - 1)) throw new RangeError('slots must be a power of two');
+    const ring = { buffer: new SharedArrayBuffer(ringSize(slots, slotBytes)), slots, slotBytes };
+    const port = await startWorker(workerPath,
+                                   { apiUrl: import.meta.url, wasmPath: String(wasmPath), ring });
+    return new LeanServerCryptoRing(port, ring, options.timeout || Infinity);
+  }
+
   // ── SHA-256 ──────────────────────────────────────────────
 
   /**
    * SHA-256 hash.
    * @param {Uint8Array} data - Input data
+   * @param {Uint8Array} [out] - Optional output buffer (≥32 bytes)
    * @returns {Uint8Array} 32-byte digest
    */
-  sha256(data) {
-    return callUnary(this._mod, this._mod._js_sha256, data);
+  sha256(data, out) {
+    return deliver(
+      callUnary(this._mod, this._mod._js_sha256_into, data), out);
+  }
+
+  /**
+   * SHA-256 of many messages in one call. The messages are hashed several
+   * at a time in SIMD lanes, which beats one sha256() per message once
+   * there are a few of them (see sha256_many_bench.js).
+   * @param {Uint8Array[]} messages
+   * @param {Uint8Array} [out] - Optional output buffer (≥32 bytes per message)
+   * @returns {Uint8Array} The digests, 32 bytes each, in message order
+   */
+  sha256Many(messages, out) {
+    const mod = this._mod;
+    const n = messages.length;
+    let size = 40 * n;
+    for (const m of messages) size += m.length;
+    // The descriptors (address, length), the messages, then the digests
+    const base = cmdsRegion(mod, size);
+    const heap = mod.HEAPU8;
+    const words = mod.HEAPU32;
+    let p = base + 8 * n;
+    for (let i = 0; i < n; i++) {
+      heap.set(messages[i], p);
+      words[(base >> 2) + 2 * i] = p;
+      words[(base >> 2) + 2 * i + 1] = messages[i].length;
+      p += messages[i].length;
+    }
+    mod._js_sha256_many(base, n, p);
+    // Re-read HEAPU8: the call may have grown memory
+    return deliver(mod.HEAPU8.subarray(p, p + 32 * n), out);
   }
 
   /**
    * HMAC-SHA-256.
    * @param {Uint8Array} key - HMAC key
    * @param {Uint8Array} msg - Message to authenticate
+   * @param {Uint8Array} [out] - Optional output buffer (≥32 bytes)
    * @returns {Uint8Array} 32-byte MAC
    */
-  hmacSha256(key, msg) {
-    return callBinary(this._mod, this._mod._js_hmac_sha256, key, msg);
+  hmacSha256(key, msg, out) {
+    return deliver(
+      callBinary(this._mod, this._mod._js_hmac_sha256_into, key, msg), out);
   }
 
   /**
    * HKDF-Extract (TLS 1.3).
    * @param {Uint8Array} salt
    * @param {Uint8Array} ikm - Input key material
+   * @param {Uint8Array} [out] - Optional output buffer (≥32 bytes)
    * @returns {Uint8Array} 32-byte PRK
    */
-  hkdfExtract(salt, ikm) {
-    return callBinary(this._mod, this._mod._js_hkdf_extract, salt, ikm);
+  hkdfExtract(salt, ikm, out) {
+    return deliver(
+      callBinary(this._mod, this._mod._js_hkdf_extract_into, salt, ikm), out);
   }
 
   // ── AES-128-GCM ─────────────────────────────────────────
@@ -175,11 +415,14 @@ export class LeanServerCrypto {
    * @param {Uint8Array} iv  - 12-byte IV/nonce
    * @param {Uint8Array} aad - Additional authenticated data
    * @param {Uint8Array} plaintext
+   * @param {Uint8Array} [out] - Optional output buffer
+   *   (≥ plaintext.length + 16 bytes)
    * @returns {Uint8Array} ciphertext + 16-byte authentication tag
    */
-  aesGcmEncrypt(key, iv, aad, plaintext) {
-    return callQuad(this._mod, this._mod._js_aes_gcm_encrypt,
-                    key, iv, aad, plaintext);
+  aesGcmEncrypt(key, iv, aad, plaintext, out) {
+    return deliver(
+      callQuad(this._mod, this._mod._js_aes_gcm_encrypt_into,
+               key, iv, aad, plaintext), out);
   }
 
   /**
@@ -188,12 +431,14 @@ export class LeanServerCrypto {
    * @param {Uint8Array} iv  - 12-byte IV/nonce
    * @param {Uint8Array} aad - Additional authenticated data
    * @param {Uint8Array} ciphertextWithTag - ciphertext + 16-byte tag
+   * @param {Uint8Array} [out] - Optional output buffer
+   *   (≥ ciphertextWithTag.length - 16 bytes)
    * @returns {Uint8Array|null} Plaintext, or null if authentication fails
    */
-  aesGcmDecrypt(key, iv, aad, ciphertextWithTag) {
-    const result = callQuad(this._mod, this._mod._js_aes_gcm_decrypt,
+  aesGcmDecrypt(key, iv, aad, ciphertextWithTag, out) {
+    const result = callQuad(this._mod, this._mod._js_aes_gcm_decrypt_into,
                             key, iv, aad, ciphertextWithTag);
-    return result.length > 0 ? result : null;
+    return result === null ? null : deliver(result, out);
   }
 
   // ── X25519 Key Exchange ──────────────────────────────────
@@ -201,32 +446,36 @@ export class LeanServerCrypto {
   /**
    * Generate X25519 public key from private key.
    * @param {Uint8Array} privateKey - 32-byte private key
+   * @param {Uint8Array} [out] - Optional output buffer (≥32 bytes)
    * @returns {Uint8Array} 32-byte public key
    */
-  x25519PublicKey(privateKey) {
-    return callUnary(this._mod, this._mod._js_x25519_base, privateKey);
+  x25519PublicKey(privateKey, out) {
+    return deliver(
+      callUnary(this._mod, this._mod._js_x25519_base_into, privateKey), out);
   }
 
   /**
    * X25519 Diffie-Hellman key exchange.
    * @param {Uint8Array} privateKey - 32-byte private key
    * @param {Uint8Array} publicKey  - 32-byte peer's public key
+   * @param {Uint8Array} [out] - Optional output buffer (≥32 bytes)
    * @returns {Uint8Array} 32-byte shared secret
    */
-  x25519SharedSecret(privateKey, publicKey) {
-    return callBinary(this._mod, this._mod._js_x25519_scalarmult,
-                      privateKey, publicKey);
+  x25519SharedSecret(privateKey, publicKey, out) {
+    return deliver(
+      callBinary(this._mod, this._mod._js_x25519_scalarmult_into,
+                 privateKey, publicKey), out);
   }
 
   /**
-   * Generate a fresh X25519 key pair using Web Crypto for randomness.
+   * Generate a fresh X25519 key pair. The private key comes from the
+   * module's own CSPRNG (HMAC_DRBG seeded from crypto.getRandomValues).
    * @returns {{ privateKey: Uint8Array, publicKey: Uint8Array }}
    */
   x25519KeyPair() {
-    const privateKey = new Uint8Array(32);
-    crypto.getRandomValues(privateKey);
-    const publicKey = this.x25519PublicKey(privateKey);
-    return { privateKey, publicKey };
+    const st = scratch(this._mod);
+    return decodeKeyPair(resultView(this._mod,
+                                    this._mod._js_x25519_keypair_into(st.out, st.outCap)));
   }
 
   // ── Hex Encoding ─────────────────────────────────────────
@@ -237,7 +486,7 @@ export class LeanServerCrypto {
    * @returns {string}
    */
   bytesToHex(data) {
-    const result = callUnary(this._mod, this._mod._js_bytes_to_hex, data);
+    const result = callUnary(this._mod, this._mod._js_bytes_to_hex_into, data);
     return new TextDecoder().decode(result);
   }
 
@@ -249,26 +498,7 @@ export class LeanServerCrypto {
    * @returns {Array<{name: string, value: string}>}
    */
   hpackDecode(data) {
-    const buf = callUnary(this._mod, this._mod._js_hpack_decode, data);
-    if (buf.length < 4) return [];
-
-    const view = new DataView(buf.buffer, buf.byteOffset, buf.byteLength);
-    const count = view.getUint32(0, true);
-    const headers = [];
-    let offset = 4;
-
-    for (let i = 0; i < count && offset < buf.length; i++) {
-      const nameLen = view.getUint32(offset, true); offset += 4;
-      const name = new TextDecoder().decode(buf.slice(offset, offset + nameLen));
-      offset += nameLen;
-
-      const valLen = view.getUint32(offset, true); offset += 4;
-      const value = new TextDecoder().decode(buf.slice(offset, offset + valLen));
-      offset += valLen;
-
-      headers.push({ name, value });
-    }
-    return headers;
+    return decodeHeaders(callUnary(this._mod, this._mod._js_hpack_decode_into, data));
   }
 
   // ── Huffman (HPACK sub-codec) ────────────────────────────
@@ -276,20 +506,23 @@ export class LeanServerCrypto {
   /**
    * Huffman-encode bytes (HPACK RFC 7541 Appendix B).
    * @param {Uint8Array} data
+   * @param {Uint8Array} [out] - Optional output buffer
    * @returns {Uint8Array}
    */
-  huffmanEncode(data) {
-    return callUnary(this._mod, this._mod._js_huffman_encode, data);
+  huffmanEncode(data, out) {
+    return deliver(
+      callUnary(this._mod, this._mod._js_huffman_encode_into, data), out);
   }
 
   /**
    * Huffman-decode bytes.
    * @param {Uint8Array} data
-   * @returns {Uint8Array|null}
+   * @param {Uint8Array} [out] - Optional output buffer
+   * @returns {Uint8Array|null} Decoded bytes, or null on invalid input
    */
-  huffmanDecode(data) {
-    const result = callUnary(this._mod, this._mod._js_huffman_decode, data);
-    return result.length > 0 ? result : null;
+  huffmanDecode(data, out) {
+    const result = callUnary(this._mod, this._mod._js_huffman_decode_into, data);
+    return result === null ? null : deliver(result, out);
   }
 
   // ── TLS 1.3 Key Derivation ──────────────────────────────
@@ -302,14 +535,9 @@ export class LeanServerCrypto {
    *             clientKey: Uint8Array, clientIV: Uint8Array }}
    */
   tlsDeriveHandshake(sharedSecret, helloHash) {
-    const buf = callBinary(this._mod, this._mod._js_tls_derive_handshake,
-                           sharedSecret, helloHash);
-    return {
-      serverKey: buf.slice(0, 16),
-      serverIV:  buf.slice(16, 28),
-      clientKey: buf.slice(28, 44),
-      clientIV:  buf.slice(44, 56),
-    };
+    return decodeTrafficKeys(
+      callBinary(this._mod, this._mod._js_tls_derive_handshake_into,
+                 sharedSecret, helloHash));
   }
 
   /**
@@ -320,14 +548,9 @@ export class LeanServerCrypto {
    *             clientKey: Uint8Array, clientIV: Uint8Array }}
    */
   tlsDeriveApplication(handshakeSecret, helloHash) {
-    const buf = callBinary(this._mod, this._mod._js_tls_derive_application,
-                           handshakeSecret, helloHash);
-    return {
-      serverKey: buf.slice(0, 16),
-      serverIV:  buf.slice(16, 28),
-      clientKey: buf.slice(28, 44),
-      clientIV:  buf.slice(44, 56),
-    };
+    return decodeTrafficKeys(
+      callBinary(this._mod, this._mod._js_tls_derive_application_into,
+                 handshakeSecret, helloHash));
   }
 
   // ── HTTP/2 Frame Parsing ─────────────────────────────────
@@ -335,9 +558,671 @@ export class LeanServerCrypto {
   /**
    * Parse an HTTP/2 frame from binary data.
    * @param {Uint8Array} data - Raw frame bytes (≥9 bytes header)
+   * @param {Uint8Array} [out] - Optional output buffer
    * @returns {Uint8Array} Re-serialized frame, or empty on failure
    */
-  http2ParseFrame(data) {
-    return callUnary(this._mod, this._mod._js_http2_parse_frame, data);
+  http2ParseFrame(data, out) {
+    return deliver(
+      callUnary(this._mod, this._mod._js_http2_parse_frame_into, data), out);
+  }
+
+  // ── Command Batches ──────────────────────────────────────
+
+  /**
+   * Run several operations in one call into the module, e.g. the hashes
+   * and HMACs of one TLS handshake step. Each op names a method from the
+   * list below with its arguments; an argument may be `{ ref: i }`, the
+   * result of the earlier op `i`, if that op returns fixed-size bytes
+   * (sha256, hmacSha256, hkdfExtract, x25519PublicKey,
+   * x25519SharedSecret). Ops run in order.
+   *
+   * Methods: sha256, hmacSha256, hkdfExtract, aesGcmEncrypt,
+   * aesGcmDecrypt, x25519PublicKey, x25519SharedSecret, x25519KeyPair,
+   * bytesToHex, hpackDecode, huffmanEncode, huffmanDecode,
+   * tlsDeriveHandshake, tlsDeriveApplication, http2ParseFrame.
+   *
+   * @example
+   *   const [th, finishedKey, verify] = crypto.batch([
+   *     { op: 'sha256', args: [transcript] },
+   *     { op: 'hmacSha256', args: [trafficSecret, finishedLabel] },
+   *     { op: 'hmacSha256', args: [{ ref: 1 }, { ref: 0 }] },
+   *   ]);
+   * @param {Array<{op: string, args?: Array<Uint8Array|{ref: number}>}>} ops
+   * @returns {Array} One result per op, as the method itself returns it
+   */
+  batch(ops) {
+    const mod = this._mod;
+    const n = ops.length;
+    const codes = new Array(n);
+    const caps = new Array(n);
+    const lens = [0, 0, 0, 0];
+    let size = n * DESC_WORDS * 4;
+    for (let i = 0; i < n; i++) {
+      const opcode = OP_CODES.get(ops[i].op);
+      if (opcode === undefined) throw new TypeError(`batch: unknown op '${ops[i].op}'`);
+      const op = OPS[opcode];
+      const args = ops[i].args || [];
+      if (args.length < op.arity) {
+        throw new TypeError(`batch: ${op.name} takes ${op.arity} arguments`);
+      }
+      for (let k = 0; k < op.arity; k++) {
+        const a = args[k];
+        if (a instanceof Uint8Array) {
+          lens[k] = a.length;
+          size += a.length;
+          continue;
+        }
+        const src = a && a.ref < i ? OPS[codes[a.ref]] : null;
+        if (!src || !src.fixed || src.decode) {
+          throw new TypeError(`batch: op ${i} refers to op ${a && a.ref}, ` +
+                              'which is not an earlier op with a fixed-size byte result');
+        }
+        lens[k] = src.out();
+      }
+      codes[i] = opcode;
+      caps[i] = op.out(lens);
+      size += caps[i];
+    }
+
+    // The descriptors, then each op's arguments and output region
+    const base = cmdsRegion(mod, size);
+    const outs = new Array(n);
+    let heap = mod.HEAPU8;
+    let words = mod.HEAPU32;
+    let p = base + n * DESC_WORDS * 4;
+    for (let i = 0; i < n; i++) {
+      const d = (base >> 2) + i * DESC_WORDS;
+      const arity = OPS[codes[i]].arity;
+      words[d + D_OP] = codes[i];
+      for (let k = 0; k < arity; k++) {
+        const a = ops[i].args[k];
+        if (a instanceof Uint8Array) {
+          heap.set(a, p);
+          words[d + D_ARG_OFF + k] = p;
+          words[d + D_ARG_LEN + k] = a.length;
+          p += a.length;
+        } else {
+          words[d + D_ARG_OFF + k] = outs[a.ref];
+          words[d + D_ARG_LEN + k] = caps[a.ref];
+        }
+      }
+      outs[i] = p;
+      words[d + D_OUT_OFF] = p;
+      words[d + D_OUT_CAP] = caps[i];
+      p += caps[i];
+    }
+
+    const done = mod._js_batch(base, n) >>> 0;
+    if (done !== n) throw new Error(`batch: op ${done} was not run`);
+
+    // Re-read the heap views: the calls may have grown memory
+    heap = mod.HEAPU8;
+    words = mod.HEAPU32;
+    const results = new Array(n);
+    for (let i = 0; i < n; i++) {
+      const op = OPS[codes[i]];
+      const len = words[(base >> 2) + i * DESC_WORDS + D_STATUS];
+      if (len === RESULT_NONE) {
+        results[i] = null;
+      } else if (len > caps[i]) {
+        // Larger than estimated, so it was dropped: run this op again alone.
+        // Referenced results are fixed-size and always fit.
+        results[i] = this[op.name](...ops[i].args.slice(0, op.arity).map(
+          a => a instanceof Uint8Array ? a : results[a.ref]));
+      } else {
+        const buf = heap.slice(outs[i], outs[i] + len);
+        results[i] = op.decode ? op.decode(buf) : buf;
+      }
+    }
+    return results;
+  }
+
+  // ── Allocation & Copy Statistics ─────────────────────────
+
+  /**
+   * Allocation counters from a build made with WASM_ALLOC_STATS=1.
+   * Counts accumulate across calls until resetAllocStats().
+   * @returns {?{byTag: Object<string, {allocs: number, bytes: number}>,
+   *             bySize: Array<{maxBytes: number, allocs: number}>,
+   *             frees: number, liveBytes: number, peakBytes: number}}
+   *   Counters, or null if the build has no allocation statistics
+   */
+  allocStats() {
+    const mod = this._mod;
+    const ptr = mod._malloc(ALLOC_STATS_COUNT * 8);
+    try {
+      const n = mod._js_alloc_stats(ptr, ALLOC_STATS_COUNT);
+      if (n === 0) return null;
+      const v = new Float64Array(mod.HEAPU8.buffer, ptr, ALLOC_STATS_COUNT);
+      const tags = ALLOC_STAT_TAGS.length;
+      const byTag = {};
+      ALLOC_STAT_TAGS.forEach((tag, i) => {
+        byTag[tag] = { allocs: v[i], bytes: v[tags + i] };
+      });
+      const bySize = ALLOC_STAT_SIZES.map((maxBytes, i) =>
+        ({ maxBytes, allocs: v[2 * tags + i] }));
+      const rest = 2 * tags + ALLOC_STAT_SIZES.length;
+      return {
+        byTag,
+        bySize,
+        frees: v[rest],
+        liveBytes: v[rest + 1],
+        peakBytes: v[rest + 2],
+      };
+    } finally {
+      mod._free(ptr);
+    }
+  }
+
+  /** Zero the allocation counters. Live bytes are kept. */
+  resetAllocStats() {
+    this._mod._js_alloc_stats_reset();
+  }
+
+  /**
+   * Copy-on-write counters from a build made with WASM_COW_STATS=1: how
+   * often, and how many bytes, each runtime path copied a shared object.
+   * @returns {?Object<string, {copies: number, bytes: number}>}
+   *   Counters by kind, or null if the build has no copy-on-write counters
+   */
+  cowStats() {
+    const mod = this._mod;
+    const count = 2 * COW_KINDS.length;
+    const ptr = mod._malloc(count * 8);
+    try {
+      if (mod._js_cow_stats(ptr, count) === 0) return null;
+      const v = new Float64Array(mod.HEAPU8.buffer, ptr, count);
+      const stats = {};
+      COW_KINDS.forEach((kind, i) => {
+        stats[kind] = { copies: v[i], bytes: v[COW_KINDS.length + i] };
+      });
+      return stats;
+    } finally {
+      mod._free(ptr);
+    }
+  }
+
+  /** Zero the copy-on-write counters. */
+  resetCowStats() {
+    this._mod._js_cow_stats_reset();
+  }
+
+  /**
+   * The module's monotonic clock (the one Lean code sees through
+   * IO.monoNanosNow), in nanoseconds from an arbitrary origin.
+   * @returns {number}
+   */
+  nowNs() {
+    return this._mod._js_now_ns();
+  }
+}
+
+// ── Worker pool ───────────────────────────────────────────────
+
+/**
+ * Methods a LeanServerCryptoPool runs in its workers, with the number of
+ * arguments each takes (an optional `out` buffer is not forwarded).
+ */
+const POOL_METHODS = {
+  sha256: 1, sha256Many: 1, hmacSha256: 2, hkdfExtract: 2,
+  aesGcmEncrypt: 4, aesGcmDecrypt: 4,
+  x25519PublicKey: 1, x25519SharedSecret: 2, x25519KeyPair: 0,
+  bytesToHex: 1, hpackDecode: 1, huffmanEncode: 1, huffmanDecode: 1,
+  tlsDeriveHandshake: 2, tlsDeriveApplication: 2, http2ParseFrame: 1,
+};
+
+/**
+ * Calls posted to a worker ahead of its replies: one running and one
+ * waiting, so a worker does not idle for a round trip between calls.
+ * The rest wait in the pool's per-worker queues, where idle workers can
+ * still take them.
+ */
+const POOL_PIPELINE_DEPTH = 2;
+
+async function defaultWorkerCount() {
+  if (typeof navigator !== 'undefined' && navigator.hardwareConcurrency) {
+    return navigator.hardwareConcurrency;
+  }
+  const os = await import('node:os');
+  return os.availableParallelism ? os.availableParallelism() : os.cpus().length;
+}
+
+/**
+ * Start one worker and wait until its module is loaded. Returns a port
+ * { post(msg, transfer), onMessage, terminate() } over either a Web
+ * Worker or a worker_threads Worker. An uncaught error in the worker, or
+ * a worker_threads worker exiting, arrives as a message { error } with
+ * no id.
+ */
+async function startWorker(workerPath, init) {
+  let port;
+  if (typeof Worker === 'function') {
+    const w = new Worker(workerPath);
+    port = {
+      post: (msg, transfer) => w.postMessage(msg, transfer),
+      terminate: () => w.terminate(),
+    };
+    w.onmessage = e => port.onMessage(e.data);
+    w.onerror = e => port.onMessage({ error: e.message || 'worker error' });
+  } else {
+    const { Worker: NodeWorker } = await import('node:worker_threads');
+    const w = new NodeWorker(workerPath);
+    port = {
+      post: (msg, transfer) => w.postMessage(msg, transfer),
+      terminate: () => w.terminate(),
+    };
+    w.on('message', msg => port.onMessage(msg));
+    w.on('error', e => port.onMessage({ error: e.message }));
+    w.on('exit', code => port.onMessage({ error: `worker exited with code ${code}` }));
   }
+  await new Promise((resolve, reject) => {
+    port.onMessage = msg => {
+      if (msg.ready) resolve();
+      else reject(new Error(`LeanCrypto worker failed to start: ${msg.error}`));
+    };
+    port.post({ init });
+  });
+  return port;
+}
+
+/** The ArrayBuffers of the Uint8Array arguments that can be moved. */
+function movableBuffers(args) {
+  const buffers = new Set();
+  for (const a of args) {
+    if (a instanceof Uint8Array && a.buffer instanceof ArrayBuffer &&
+        a.byteOffset === 0 && a.byteLength === a.buffer.byteLength) {
+      buffers.add(a.buffer);
+    }
+  }
+  return [...buffers];
 }
+
+/**
+ * A set of module instances in workers. Offers the LeanServerCrypto
+ * methods listed in POOL_METHODS, each returning a Promise of the same
+ * result. Every worker has a queue; a call joins the queue of the
+ * worker with the least work queued and in flight, and a worker whose
+ * queue runs dry takes from the longest other queue.
+ */
+export class LeanServerCryptoPool {
+  constructor(ports, transfer) {
+    this._transfer = transfer;
+    this._nextId = 1;
+    this._next = 0;        // where the least-loaded search starts
+    this._since = performance.now();
+    this._workers = ports.map(port => {
+      const w = { port, queue: [], inFlight: new Map(), calls: 0, busyMs: 0 };
+      port.onMessage = msg => this._done(w, msg);
+      return w;
+    });
+  }
+
+  /** Number of workers. */
+  get size() {
+    return this._workers.length;
+  }
+
+  _submit(method, args) {
+    return new Promise((resolve, reject) => {
+      if (!this._workers) {
+        reject(new Error('LeanServerCryptoPool has been terminated'));
+        return;
+      }
+      const job = { id: this._nextId++, method, args, resolve, reject };
+      const w = this._leastLoaded();
+      w.queue.push(job);
+      this._pump(w);
+    });
+  }
+
+  _leastLoaded() {
+    const ws = this._workers;
+    let best = null, bestLoad = Infinity;
+    for (let k = 0; k < ws.length; k++) {
+      const w = ws[(this._next + k) % ws.length];
+      const load = w.queue.length + w.inFlight.size;
+      if (load < bestLoad) { best = w; bestLoad = load; }
+    }
+    this._next = (this._next + 1) % ws.length;
+    return best;
+  }
+
+  /** Take the newest job of the longest queue other than `w`'s. */
+  _steal(w) {
+    let victim = null;
+    for (const v of this._workers) {
+      if (v !== w && v.queue.length > 0 && (!victim || v.queue.length > victim.queue.length)) {
+        victim = v;
+      }
+    }
+    return victim ? victim.queue.pop() : undefined;
+  }
+
+  _pump(w) {
+    while (w.inFlight.size < POOL_PIPELINE_DEPTH) {
+      const job = w.queue.length > 0 ? w.queue.shift() : this._steal(w);
+      if (!job) break;
+      w.inFlight.set(job.id, job);
+      const transfer = this._transfer ? movableBuffers(job.args) : [];
+      w.port.post({ id: job.id, method: job.method, args: job.args }, transfer);
+    }
+  }
+
+  _done(w, msg) {
+    const job = w.inFlight.get(msg.id);
+    if (!job) return;
+    w.inFlight.delete(msg.id);
+    w.calls++;
+    w.busyMs += msg.busyMs || 0;
+    if (msg.error !== undefined) job.reject(new Error(msg.error));
+    else job.resolve(msg.result);
+    if (this._workers) this._pump(w);
+  }
+
+  /**
+   * Per-worker load since the pool started or resetUtilization().
+   * @returns {Array<{calls: number, busyMs: number, utilization: number,
+   *                  queued: number, inFlight: number}>}
+   *   utilization is the fraction of wall time spent inside the module
+   */
+  utilization() {
+    const elapsed = performance.now() - this._since;
+    return this._workers.map(w => ({
+      calls: w.calls,
+      busyMs: w.busyMs,
+      utilization: elapsed > 0 ? w.busyMs / elapsed : 0,
+      queued: w.queue.length,
+      inFlight: w.inFlight.size,
+    }));
+  }
+
+  /** Zero the call counts and busy times. */
+  resetUtilization() {
+    this._since = performance.now();
+    for (const w of this._workers) {
+      w.calls = 0;
+      w.busyMs = 0;
+    }
+  }
+
+  /** Stop the workers. Calls that have not completed are rejected. */
+  terminate() {
+    const ws = this._workers;
+    this._workers = null;
+    const err = new Error('LeanServerCryptoPool has been terminated');
+    for (const w of ws) {
+      w.port.terminate();
+      for (const job of [...w.queue, ...w.inFlight.values()]) job.reject(err);
+    }
+  }
+}
+
+for (const [name, arity] of Object.entries(POOL_METHODS)) {
+  LeanServerCryptoPool.prototype[name] = function (...args) {
+    return this._submit(name, args.slice(0, arity));
+  };
+}
+
+// ── Shared-memory request ring ────────────────────────────────
+//
+// A SharedArrayBuffer holds, in order:
+//   control    Int32[16]   [RING_SQ_TAIL] and [RING_CQ_TAIL], the doorbells
+//   sq, cq     Int32[slots] each, rings of slot numbers
+//   desc       Int32[slots * DESC_WORDS], one descriptor per slot
+//   data       slots * slotBytes bytes, one region per slot
+// The caller writes a request's arguments into its slot's region, fills
+// the descriptor and appends the slot to sq. The worker drains sq in
+// batches, writes each result after the arguments, appends the slot to
+// cq and rings the cq doorbell once per batch. Each side is the only
+// writer of its tail and keeps its read position privately; a slot is
+// in at most one ring at a time, so neither ring can overflow.
+
+const RING_SQ_TAIL = 0;
+const RING_CQ_TAIL = 1;
+const RING_CONTROL_WORDS = 16;
+
+/** Negative statuses; otherwise the status is the result length. */
+const RING_STATUS_NONE = -1;       // RESULT_NONE: e.g. failed authentication
+const RING_STATUS_TOO_LARGE = -2;  // result did not fit after the arguments
+const RING_STATUS_ERROR = -3;      // the call threw
+
+function ringSize(slots, slotBytes) {
+  return 4 * (RING_CONTROL_WORDS + 2 * slots + slots * DESC_WORDS) + slots * slotBytes;
+}
+
+function ringViews({ buffer, slots, slotBytes }) {
+  let off = 0;
+  const words = n => {
+    const v = new Int32Array(buffer, off, n);
+    off += 4 * n;
+    return v;
+  };
+  const control = words(RING_CONTROL_WORDS);
+  const sq = words(slots);
+  const cq = words(slots);
+  const desc = words(slots * DESC_WORDS);
+  const data = new Uint8Array(buffer, off, slots * slotBytes);
+  return { control, sq, cq, desc, data, mask: slots - 1 };
+}
+
+/**
+ * Worker side of the ring: serve requests forever, blocking in
+ * Atomics.wait while the submission ring is empty. Called by
+ * lean_crypto_worker.js.
+ * @param {LeanServerCrypto} crypto
+ * @param {{buffer: SharedArrayBuffer, slots: number, slotBytes: number}} ring
+ */
+export function serveRing(crypto, ring) {
+  const r = ringViews(ring);
+  const mod = crypto._mod;
+  const ops = OPS.map(op => mod[op.fn]);
+  let sqHead = 0;
+  let cqTail = 0;
+  for (;;) {
+    const sqTail = Atomics.load(r.control, RING_SQ_TAIL);
+    if (sqHead === sqTail) {
+      Atomics.wait(r.control, RING_SQ_TAIL, sqTail);
+      continue;
+    }
+    for (; sqHead !== sqTail; sqHead = (sqHead + 1) | 0) {
+      const slot = r.sq[sqHead & r.mask];
+      const d = slot * DESC_WORDS;
+      const opcode = r.desc[d + D_OP];
+      let status;
+      try {
+        if (opcode < 0 || opcode >= OPS.length) throw new RangeError(`unknown ring opcode ${opcode}`);
+        const args = [];
+        for (let i = 0; i < OPS[opcode].arity; i++) {
+          const off = r.desc[d + D_ARG_OFF + i];
+          args.push(r.data.subarray(off, off + r.desc[d + D_ARG_LEN + i]));
+        }
+        const view = callN(mod, ops[opcode], args);
+        if (view === null) {
+          status = RING_STATUS_NONE;
+        } else if (view.length > r.desc[d + D_OUT_CAP]) {
+          status = RING_STATUS_TOO_LARGE;
+        } else {
+          r.data.set(view, r.desc[d + D_OUT_OFF]);
+          status = view.length;
+        }
+      } catch (e) {
+        status = RING_STATUS_ERROR;
+      }
+      r.desc[d + D_STATUS] = status;
+      r.cq[cqTail & r.mask] = slot;
+      cqTail = (cqTail + 1) | 0;
+    }
+    Atomics.store(r.control, RING_CQ_TAIL, cqTail);
+    Atomics.notify(r.control, RING_CQ_TAIL);
+  }
+}
+
+/** Resolve once control[i] may have changed from `value`, or after
+    `timeout` milliseconds. */
+function ringWait(control, i, value, timeout) {
+  if (Atomics.waitAsync) return Atomics.waitAsync(control, i, value, timeout).value;
+  return new Promise(resolve => setTimeout(resolve, 0));
+}
+
+/**
+ * Caller side of the ring, backed by one worker. Offers the methods in
+ * OPS, each returning a Promise of the same result as the
+ * LeanServerCrypto method. Requests made in the same turn of the event
+ * loop share one doorbell, and the worker runs them as one batch. A
+ * request whose arguments do not fit in a slot is rejected with a
+ * RangeError. If the worker fails (an uncaught error, exiting, or no
+ * completion within `timeout` ms while requests are in flight), it is
+ * stopped and every pending and later request is rejected with the
+ * reason.
+ */
+export class LeanServerCryptoRing {
+  constructor(port, ring, timeout = Infinity) {
+    this._port = port;
+    this._slotBytes = ring.slotBytes;
+    this._r = ringViews(ring);
+    this._jobs = new Array(ring.slots).fill(null);
+    this._free = Array.from({ length: ring.slots }, (_, i) => ring.slots - 1 - i);
+    this._waiting = [];      // requests for which no slot was free
+    this._sqTail = 0;
+    this._cqHead = 0;
+    this._inFlight = 0;
+    this._doorbell = false;  // a doorbell is scheduled for this turn
+    this._reaping = false;
+    this._timeout = timeout;
+    this._error = null;      // why the ring stopped, once it has
+    port.onMessage = msg => {
+      if (msg.error !== undefined) {
+        this._fail(new Error(`LeanServerCryptoRing worker failed: ${msg.error}`));
+      }
+    };
+  }
+
+  _submit(opcode, args) {
+    return new Promise((resolve, reject) => {
+      if (!this._r) {
+        reject(this._error);
+        return;
+      }
+      const job = { opcode, args, resolve, reject };
+      if (this._free.length > 0) this._start(this._free.pop(), job);
+      else this._waiting.push(job);
+    });
+  }
+
+  _start(slot, job) {
+    const r = this._r;
+    const d = slot * DESC_WORDS;
+    const end = (slot + 1) * this._slotBytes;
+    let off = slot * this._slotBytes;
+    for (let i = 0; i < job.args.length; i++) {
+      const a = job.args[i];
+      if (off + a.length > end) {
+        job.reject(new RangeError(
+          `Arguments exceed the ring's ${this._slotBytes}-byte slot`));
+        this._release(slot);
+        return;
+      }
+      r.data.set(a, off);
+      r.desc[d + D_ARG_OFF + i] = off;
+      r.desc[d + D_ARG_LEN + i] = a.length;
+      off += a.length;
+    }
+    r.desc[d + D_OP] = job.opcode;
+    r.desc[d + D_OUT_OFF] = off;
+    r.desc[d + D_OUT_CAP] = end - off;
+    this._jobs[slot] = job;
+    r.sq[this._sqTail & r.mask] = slot;
+    this._sqTail = (this._sqTail + 1) | 0;
+    this._inFlight++;
+    if (!this._doorbell) {
+      this._doorbell = true;
+      queueMicrotask(() => this._ring());
+    }
+  }
+
+  _ring() {
+    this._doorbell = false;
+    if (!this._r) return;
+    Atomics.store(this._r.control, RING_SQ_TAIL, this._sqTail);
+    Atomics.notify(this._r.control, RING_SQ_TAIL);
+    this._reap();
+  }
+
+  /** Hand a free slot to the next waiting request, or free it. */
+  _release(slot) {
+    const next = this._waiting.shift();
+    if (next) this._start(slot, next);
+    else this._free.push(slot);
+  }
+
+  async _reap() {
+    if (this._reaping) return;
+    this._reaping = true;
+    let lastDone = performance.now();
+    while (this._r && this._inFlight > 0) {
+      const r = this._r;
+      const cqTail = Atomics.load(r.control, RING_CQ_TAIL);
+      if (this._cqHead === cqTail) {
+        const left = this._timeout - (performance.now() - lastDone);
+        if (left <= 0) {
+          this._fail(new Error(
+            `LeanServerCryptoRing worker completed nothing in ${this._timeout} ms`));
+          break;
+        }
+        await ringWait(r.control, RING_CQ_TAIL, cqTail, left);
+        continue;
+      }
+      lastDone = performance.now();
+      for (; this._cqHead !== cqTail; this._cqHead = (this._cqHead + 1) | 0) {
+        const slot = r.cq[this._cqHead & r.mask];
+        const d = slot * DESC_WORDS;
+        const status = r.desc[d + D_STATUS];
+        const job = this._jobs[slot];
+        this._jobs[slot] = null;
+        this._inFlight--;
+        if (status >= 0) {
+          const off = r.desc[d + D_OUT_OFF];
+          // slice() copies out of shared memory, which TextDecoder rejects
+          const buf = r.data.slice(off, off + status);
+          const decode = OPS[job.opcode].decode;
+          job.resolve(decode ? decode(buf) : buf);
+        } else if (status === RING_STATUS_NONE) {
+          job.resolve(null);
+        } else if (status === RING_STATUS_TOO_LARGE) {
+          job.reject(new RangeError(`Result exceeds the ring's ${this._slotBytes}-byte slot`));
+        } else {
+          job.reject(new Error(`${OPS[job.opcode].name} failed in the ring worker`));
+        }
+        this._release(slot);
+      }
+    }
+    this._reaping = false;
+  }
+
+  /** Stop the worker and reject every pending request with `err`. */
+  _fail(err) {
+    const r = this._r;
+    if (!r) return;
+    this._r = null;
+    this._error = err;
+    this._port.terminate();
+    // Wake _reap if it is waiting on the completion doorbell
+    Atomics.notify(r.control, RING_CQ_TAIL);
+    const jobs = [...this._jobs, ...this._waiting];
+    this._jobs.fill(null);
+    this._waiting = [];
+    this._inFlight = 0;
+    for (const job of jobs) if (job) job.reject(err);
+  }
+
+  /** Stop the worker. Requests that have not completed are rejected. */
+  terminate() {
+    this._fail(new Error('LeanServerCryptoRing has been terminated'));
+  }
+}
+
+OPS.forEach((op, opcode) => {
+  LeanServerCryptoRing.prototype[op.name] = function (...args) {
+    return this._submit(opcode, args.slice(0, op.arity));
+  };
+});
@@ -0,0 +1,72 @@
+/**
+ * Request latency through a LeanServerCryptoRing (SharedArrayBuffer ring,
+ * Atomics doorbells) against a one-worker LeanServerCryptoPool
+ * (postMessage), for SHA-256 requests from 32 bytes to 16 KiB.
+ *
+ *   node dist/ring_bench.js [path/to/lean_crypto.js]
+ *
+ * "serial" awaits each request before making the next one, so it measures
+ * the round trip. "batch" keeps 64 requests in flight and reports time per
+ * request. Times are medians of several runs, in microseconds.
+ */
+import { LeanServerCrypto } from './lean_server_wasm.js';
+import { pathToFileURL } from 'node:url';
+
+const SIZES = [32, 256, 1024, 4096, 16384];
+const SERIAL = 500;
+const BATCH = 64;
+const BATCHES = 20;
+const RUNS = 5;
+
+const wasmPath = process.argv[2]
+  ? pathToFileURL(process.argv[2]).href
+  : new URL('./lean_crypto.js', import.meta.url).href;
+
+function median(xs) {
+  const s = [...xs].sort((a, b) => a - b);
+  return s[s.length >> 1];
+}
+
+async function usPerCall(run, calls) {
+  await run();   // warm-up
+  const ts = [];
+  for (let r = 0; r < RUNS; r++) {
+    const t0 = performance.now();
+    await run();
+    ts.push((performance.now() - t0) * 1000 / calls);
+  }
+  return median(ts);
+}
+
+async function serial(target, data) {
+  for (let i = 0; i < SERIAL; i++) await target.sha256(data);
+}
+
+async function batch(target, data) {
+  for (let b = 0; b < BATCHES; b++) {
+    await Promise.all(Array.from({ length: BATCH }, () => target.sha256(data)));
+  }
+}
+
+const pool = await LeanServerCrypto.initPool({ workers: 1, wasmPath });
+const ring = await LeanServerCrypto.initRing({ wasmPath });
+
+console.log('bytes   serial postMessage   serial ring   batch postMessage   batch ring');
+for (const size of SIZES) {
+  const data = new Uint8Array(size).map((_, i) => i * 31);
+  const [a, b] = await Promise.all([pool.sha256(data), ring.sha256(data)]);
+  if (a.length !== b.length || a.some((x, i) => x !== b[i])) {
+    throw new Error(`ring and pool digests differ for ${size} bytes`);
+  }
+  const row = [
+    await usPerCall(() => serial(pool, data), SERIAL),
+    await usPerCall(() => serial(ring, data), SERIAL),
+    await usPerCall(() => batch(pool, data), BATCH * BATCHES),
+    await usPerCall(() => batch(ring, data), BATCH * BATCHES),
+  ];
+  console.log(String(size).padStart(5) +
+              row.map((t, i) => t.toFixed(1).padStart([20, 14, 20, 13][i])).join(''));
+}
+
+pool.terminate();
+ring.terminate();
@@ -0,0 +1,143 @@
+/**
+ * Failure handling of LeanServerCryptoRing, with stand-in workers instead
+ * of lean_crypto_worker.js, so no wasm build is needed:
+ *
+ *   throws    answers { ready }, then throws an uncaught error
+ *   exits     answers { ready }, then exits with code 3
+ *   hangs     answers { ready }, then never completes a request
+ *   slow      completes one request every 100 ms (status RESULT_NONE)
+ *   badinit   throws before answering { ready }
+ *   noinit    exits before answering { ready }
+ *
+ *   node dist/ring_test.js
+ *
+ * Every request in flight must be rejected with the reason, later ones
+ * too, and a slow worker that keeps completing requests must not trip
+ * the deadline. Exits non-zero on failure.
+ */
+import { LeanServerCrypto } from './lean_server_wasm.js';
+import { mkdtempSync, writeFileSync, rmSync } from 'node:fs';
+import { tmpdir } from 'node:os';
+import { join } from 'node:path';
+import { pathToFileURL } from 'node:url';
+
+// Worker bodies. `ring` is the init message's ring; the layout is that of
+// ringViews() in lean_server_wasm.js.
+const WORKERS = {
+  throws: `setTimeout(() => { throw new Error('boom'); }, 50);`,
+  exits: `setTimeout(() => process.exit(3), 50);`,
+  hangs: ``,
+  slow: `
+    const slots = ring.slots;
+    const control = new Int32Array(ring.buffer, 0, 16);
+    const sq = new Int32Array(ring.buffer, 64, slots);
+    const cq = new Int32Array(ring.buffer, 64 + 4 * slots, slots);
+    const desc = new Int32Array(ring.buffer, 64 + 8 * slots, 16 * slots);
+    const D_STATUS = 11, STATUS_NONE = -1;
+    let head = 0, tail = 0;
+    for (;;) {
+      const sqTail = Atomics.load(control, 0);
+      if (head === sqTail) { Atomics.wait(control, 0, sqTail); continue; }
+      for (; head !== sqTail; head = (head + 1) | 0) {
+        Atomics.wait(new Int32Array(new SharedArrayBuffer(4)), 0, 0, 100);
+        const slot = sq[head & (slots - 1)];
+        desc[16 * slot + D_STATUS] = STATUS_NONE;
+        cq[tail & (slots - 1)] = slot;
+        tail = (tail + 1) | 0;
+        Atomics.store(control, 1, tail);
+        Atomics.notify(control, 1);
+      }
+    }`,
+};
+
+function workerSource(body, ready) {
+  return `
+    import { parentPort } from 'node:worker_threads';
+    parentPort.on('message', ({ init }) => {
+      const ring = init.ring;
+      ${ready ? `parentPort.postMessage({ ready: true });` : ''}
+      ${body}
+    });`;
+}
+
+const dir = mkdtempSync(join(tmpdir(), 'ring_test-'));
+function workerFile(name, source) {
+  const path = join(dir, `${name}.mjs`);
+  writeFileSync(path, source);
+  return pathToFileURL(path);
+}
+
+let failures = 0;
+function check(cond, what) {
+  if (!cond) {
+    console.error(`FAIL ${what}`);
+    failures++;
+  }
+}
+
+/** Settle `p` or give up after `ms`, so a hang fails instead of blocking. */
+function settle(p, ms = 5000) {
+  return Promise.race([
+    p.then(value => ({ value }), error => ({ error })),
+    new Promise(resolve => setTimeout(() => resolve({ hung: true }), ms)),
+  ]);
+}
+
+function initRing(name, source, options = {}) {
+  return LeanServerCrypto.initRing({
+    workerPath: workerFile(name, source), wasmPath: 'unused', slots: 4, ...options,
+  });
+}
+
+const data = new Uint8Array(32);
+
+// A worker that dies rejects what is in flight, queued or submitted later
+for (const [name, reason] of [['throws', /boom/], ['exits', /exited with code 3/]]) {
+  const ring = await initRing(name, workerSource(WORKERS[name], true));
+  // 6 requests for 4 slots: two wait for a slot
+  const results = await Promise.all(
+    Array.from({ length: 6 }, () => settle(ring.sha256(data))));
+  check(results.every(r => r.error && reason.test(r.error.message)),
+        `${name}: in-flight requests rejected with ${reason} ` +
+        `(${results.map(r => r.hung ? 'hung' : r.error ? r.error.message : 'resolved').join('; ')})`);
+  const later = await settle(ring.sha256(data));
+  check(later.error && reason.test(later.error.message), `${name}: later request rejected`);
+  ring.terminate();
+}
+
+// A hung worker trips the deadline
+{
+  const ring = await initRing('hangs', workerSource(WORKERS.hangs, true), { timeout: 200 });
+  const t0 = performance.now();
+  const r = await settle(ring.sha256(data));
+  const ms = performance.now() - t0;
+  check(r.error && /completed nothing in 200 ms/.test(r.error.message),
+        `hangs: rejected by the deadline (${r.hung ? 'hung' : r.error ? r.error.message : 'resolved'})`);
+  check(ms >= 190 && ms < 2000, `hangs: rejected after ${ms.toFixed(0)} ms`);
+}
+
+// The deadline is per completion, not per batch: 6 x 100 ms > 300 ms
+{
+  const ring = await initRing('slow', workerSource(WORKERS.slow, true), { timeout: 300 });
+  const results = await Promise.all(
+    Array.from({ length: 6 }, () => settle(ring.sha256(data))));
+  check(results.every(r => !r.error && !r.hung && r.value === null),
+        `slow: every request completed (${results.map(r => r.hung ? 'hung' : r.error ? r.error.message : 'ok').join('; ')})`);
+  ring.terminate();
+  const after = await settle(ring.sha256(data));
+  check(after.error && /terminated/.test(after.error.message), 'slow: request after terminate() rejected');
+}
+
+// A worker that fails before it is ready rejects initRing
+for (const [name, source] of [
+  ['badinit', workerSource(`throw new Error('no module');`, false)],
+  ['noinit', workerSource(`process.exit(1);`, false)],
+]) {
+  const r = await settle(initRing(name, source));
+  check(r.error && /failed to start/.test(r.error.message),
+        `${name}: initRing rejected (${r.hung ? 'hung' : r.error ? r.error.message : 'resolved'})`);
+}
+
+rmSync(dir, { recursive: true });
+if (failures) process.exit(1);
+console.log('ring_test: ok');
@@ -0,0 +1,70 @@
+/**
+ * SHA-256 throughput of sha256Many() (one call, messages hashed several
+ * at a time in SIMD lanes) against one sha256() call per message, for
+ * message sizes from 32 bytes to 4 KiB and batches of 1 to 1024.
+ *
+ *   node dist/sha256_many_bench.js [path/to/lean_crypto.js]
+ *
+ * Build with WASM_SIMD=1 for the 4-lane path; without it sha256Many()
+ * still saves the per-call overhead but hashes one message at a time.
+ * Each row gives MB/s for both paths and, last, the smallest batch at
+ * which sha256Many() was faster (the crossover).
+ */
+import { LeanServerCrypto } from './lean_server_wasm.js';
+import { pathToFileURL } from 'node:url';
+
+const SIZES = [32, 64, 256, 1024, 4096];
+const COUNTS = [1, 2, 4, 8, 16, 64, 256, 1024];
+const BYTES_PER_RUN = 1 << 20;
+const RUNS = 5;
+
+const wasmPath = process.argv[2]
+  ? pathToFileURL(process.argv[2]).href
+  : new URL('./lean_crypto.js', import.meta.url).href;
+
+function median(xs) {
+  const s = [...xs].sort((a, b) => a - b);
+  return s[s.length >> 1];
+}
+
+/** MB/s of `run`, which hashes `bytes` bytes per call. */
+function mbPerSec(run, bytes) {
+  const reps = Math.max(1, Math.round(BYTES_PER_RUN / bytes));
+  run();   // warm-up
+  const ts = [];
+  for (let r = 0; r < RUNS; r++) {
+    const t0 = performance.now();
+    for (let i = 0; i < reps; i++) run();
+    ts.push(performance.now() - t0);
+  }
+  return bytes * reps / (median(ts) * 1000);
+}
+
+const crypto = await LeanServerCrypto.init(wasmPath);
+
+console.log('bytes  count   sha256 MB/s   sha256Many MB/s');
+for (const size of SIZES) {
+  let crossover = null;
+  for (const count of COUNTS) {
+    const messages = Array.from({ length: count },
+                                (_, m) => new Uint8Array(size).map((_, i) => i * 31 + m));
+    const digests = new Uint8Array(32 * count);
+    const many = crypto.sha256Many(messages, digests);
+    messages.forEach((msg, m) => {
+      const one = crypto.sha256(msg);
+      if (one.some((x, i) => x !== many[32 * m + i])) {
+        throw new Error(`sha256Many and sha256 differ for message ${m} of ${size} bytes`);
+      }
+    });
+    const single = mbPerSec(() => {
+      for (let m = 0; m < count; m++) crypto.sha256(messages[m], digests.subarray(32 * m));
+    }, size * count);
+    const batched = mbPerSec(() => crypto.sha256Many(messages, digests), size * count);
+    if (crossover === null && batched > single) crossover = count;
+    console.log(String(size).padStart(5) + String(count).padStart(7) +
+                single.toFixed(1).padStart(14) + batched.toFixed(1).padStart(18));
+  }
+  console.log(crossover === null
+    ? `  ${size} B: sha256Many not faster up to ${COUNTS[COUNTS.length - 1]} messages\n`
+    : `  ${size} B: sha256Many faster from a batch of ${crossover}\n`);
+}
@@ -0,0 +1,89 @@
+/*
+ * apply_bench.c — closure application cost
+ *
+ *   partial chain  build a 3-argument closure one argument at a time and
+ *                  saturate it (exclusive under-application)
+ *   shared apply_1 call a shared closure with four fixed arguments
+ *   shared apply_1 call a shared closure with one fixed argument, as for
+ *                  the predicate of List.all
+ *   exclusive apply_2
+ *                  saturate a fresh closure with one fixed argument,
+ *                  which is moved out of it
+ *
+ *   tests/run.sh apply_bench   (TARGET=wasm for the emcc build)
+ */
+#include <lean/lean.h>
+#include <stdio.h>
+#include <time.h>
+
+#define CALLS 20000000
+
+static lean_object *g3(lean_object *a, lean_object *b, lean_object *c) {
+    return lean_box(lean_unbox(a) + lean_unbox(b) + lean_unbox(c));
+}
+
+static lean_object *f5(lean_object *a, lean_object *b, lean_object *c, lean_object *d, lean_object *x) {
+    lean_dec(a);
+    lean_dec(b);
+    lean_dec(c);
+    lean_dec(d);
+    return x;
+}
+
+static lean_object *pred(lean_object *env, lean_object *x) {
+    lean_dec(env);
+    return lean_box(lean_unbox(x) & 1);
+}
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int main(void) {
+    volatile size_t acc = 0;
+
+    double t0 = now();
+    for (int i = 0; i < CALLS; i++) {
+        lean_object *q = lean_alloc_closure((void *)g3, 3, 0);
+        q = lean_apply_1(q, lean_box(1));
+        q = lean_apply_1(q, lean_box(2));
+        acc += lean_unbox(lean_apply_1(q, lean_box(i)));
+    }
+    double partial = (now() - t0) / CALLS * 1e9;
+
+    lean_object *p4 = lean_alloc_closure((void *)f5, 5, 4);
+    for (unsigned k = 0; k < 4; k++) lean_closure_set(p4, k, lean_alloc_ctor(0, 0, 0));
+    t0 = now();
+    for (int i = 0; i < CALLS; i++) {
+        lean_inc(p4);
+        acc += lean_unbox(lean_apply_1(p4, lean_box(i)));
+    }
+    double shared4 = (now() - t0) / CALLS * 1e9;
+    lean_dec(p4);
+
+    lean_object *p1 = lean_alloc_closure((void *)pred, 2, 1);
+    lean_closure_set(p1, 0, lean_alloc_ctor(0, 0, 0));
+    t0 = now();
+    for (int i = 0; i < CALLS; i++) {
+        lean_inc(p1);
+        acc += lean_unbox(lean_apply_1(p1, lean_box(i)));
+    }
+    double shared1 = (now() - t0) / CALLS * 1e9;
+    lean_dec(p1);
+
+    t0 = now();
+    for (int i = 0; i < CALLS; i++) {
+        lean_object *q = lean_alloc_closure((void *)g3, 3, 1);
+        lean_closure_set(q, 0, lean_box(1));
+        acc += lean_unbox(lean_apply_2(q, lean_box(2), lean_box(i)));
+    }
+    double exclusive = (now() - t0) / CALLS * 1e9;
+
+    printf("partial chain (3 x apply_1)   %6.1f ns\n", partial);
+    printf("shared apply_1, 4 fixed       %6.1f ns\n", shared4);
+    printf("shared apply_1, 1 fixed       %6.1f ns\n", shared1);
+    printf("exclusive apply_2, 1 fixed    %6.1f ns\n", exclusive);
+    return 0;
+}
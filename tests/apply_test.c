@@ -0,0 +1,179 @@
+/*
+ * apply_test.c — closure application (lean_apply_*)
+ *
+ * Partial application extends an exclusive closure in place when its cell
+ * has room, and otherwise moves or copies the fixed arguments into a new
+ * closure (closure_take_fixed). A call that saturates a closure with at
+ * most four fixed arguments calls its function directly from
+ * lean_apply_1..4, moving the fixed arguments out of an exclusive closure
+ * and inc'ing those of a shared one. Checks results and reference counts for
+ * exclusive and shared closures, under-, exact and over-application, and
+ * a fixed object that must survive with its count restored.
+ */
+#include <lean/lean.h>
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do {                                   \
+        if (!(cond)) {                                          \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                       \
+            fputc('\n', stderr);                                \
+            failures++;                                         \
+        }                                                       \
+    } while (0)
+
+static lean_object *sum5(lean_object *a, lean_object *b, lean_object *c, lean_object *d, lean_object *e) {
+    return lean_box(lean_unbox(a) + lean_unbox(b) + lean_unbox(c) + lean_unbox(d) + lean_unbox(e));
+}
+
+/* Takes an object, returns x plus its field count */
+static lean_object *with_env(lean_object *env, lean_object *x) {
+    size_t r = lean_unbox(x) + lean_ctor_num_objs(env);
+    lean_dec(env);
+    return lean_box(r);
+}
+
+/* Boxed value of an argument: a scalar, or a one-field ctor (consumed) */
+static size_t val(lean_object *o) {
+    if (lean_is_scalar(o)) return lean_unbox(o);
+    size_t v = lean_unbox(lean_ctor_get(o, 0));
+    lean_dec(o);
+    return v;
+}
+
+#define V(x) val(x)
+static lean_object *s1(lean_object *a) { return lean_box(V(a)); }
+static lean_object *s2(lean_object *a, lean_object *b) { return lean_box(V(a) + V(b)); }
+static lean_object *s3(lean_object *a, lean_object *b, lean_object *c) { return lean_box(V(a) + V(b) + V(c)); }
+static lean_object *s4(lean_object *a, lean_object *b, lean_object *c, lean_object *d) {
+    return lean_box(V(a) + V(b) + V(c) + V(d));
+}
+static lean_object *s5(lean_object *a, lean_object *b, lean_object *c, lean_object *d, lean_object *e) {
+    return lean_box(V(a) + V(b) + V(c) + V(d) + V(e));
+}
+static lean_object *s6(lean_object *a, lean_object *b, lean_object *c, lean_object *d, lean_object *e,
+                       lean_object *f) {
+    return lean_box(V(a) + V(b) + V(c) + V(d) + V(e) + V(f));
+}
+static lean_object *s7(lean_object *a, lean_object *b, lean_object *c, lean_object *d, lean_object *e,
+                       lean_object *f, lean_object *g) {
+    return lean_box(V(a) + V(b) + V(c) + V(d) + V(e) + V(f) + V(g));
+}
+static lean_object *s8(lean_object *a, lean_object *b, lean_object *c, lean_object *d, lean_object *e,
+                       lean_object *f, lean_object *g, lean_object *h) {
+    return lean_box(V(a) + V(b) + V(c) + V(d) + V(e) + V(f) + V(g) + V(h));
+}
+#undef V
+
+static void *const sums[] = { NULL, s1, s2, s3, s4, s5, s6, s7, s8 };
+
+static lean_object *apply_k(lean_object *f, unsigned k, lean_object **a) {
+    switch (k) {
+    case 1:  return lean_apply_1(f, a[0]);
+    case 2:  return lean_apply_2(f, a[0], a[1]);
+    case 3:  return lean_apply_3(f, a[0], a[1], a[2]);
+    default: return lean_apply_4(f, a[0], a[1], a[2], a[3]);
+    }
+}
+
+/* Returns a closure of arity 1 (for over-application) */
+static lean_object *adder(lean_object *k) {
+    lean_object *c = lean_alloc_closure((void *)sum5, 5, 4);
+    lean_closure_set(c, 0, k);
+    for (unsigned i = 1; i < 4; i++) lean_closure_set(c, i, lean_box(0));
+    return c;
+}
+
+int main(void) {
+    /* One argument at a time: every step is an exclusive under-application */
+    lean_object *f = lean_alloc_closure((void *)sum5, 5, 0);
+    for (size_t i = 1; i <= 4; i++) f = lean_apply_1(f, lean_box(i));
+    lean_object *r = lean_apply_1(f, lean_box(5));
+    CHECK(lean_unbox(r) == 15, "1+2+3+4+5 = %zu", lean_unbox(r));
+
+    /* Shared partial application must leave the original usable */
+    lean_object *g = lean_apply_1(lean_alloc_closure((void *)sum5, 5, 0), lean_box(100));
+    lean_inc(g);
+    lean_object *g2 = lean_apply_2(g, lean_box(1), lean_box(2));
+    lean_inc(g);
+    lean_object *g3 = lean_apply_3(g, lean_box(10), lean_box(20), lean_box(30));
+    r = lean_apply_2(g2, lean_box(3), lean_box(4));
+    CHECK(lean_unbox(r) == 110, "shared, then 1+2+3+4: %zu", lean_unbox(r));
+    r = lean_apply_1(g3, lean_box(40));
+    CHECK(lean_unbox(r) == 200, "shared, then 10+20+30+40: %zu", lean_unbox(r));
+    r = lean_apply_4(g, lean_box(1), lean_box(1), lean_box(1), lean_box(1));
+    CHECK(lean_unbox(r) == 104, "original after sharing: %zu", lean_unbox(r));
+
+    /* A fixed object: its count must be back to 1 after each pattern */
+    lean_object *env = lean_alloc_ctor(0, 2, 0);
+    lean_ctor_set(env, 0, lean_box(0));
+    lean_ctor_set(env, 1, lean_box(0));
+    for (int shared = 0; shared < 2; shared++) {
+        lean_inc(env);
+        lean_object *c = lean_alloc_closure((void *)with_env, 2, 1);
+        lean_closure_set(c, 0, env);
+        if (shared) lean_inc(c);
+        r = lean_apply_1(c, lean_box(40));
+        CHECK(lean_unbox(r) == 42, "with_env: %zu", lean_unbox(r));
+        if (shared) lean_dec(c);
+        CHECK(env->m_rc == 1, "env count %d after %s call", env->m_rc, shared ? "shared" : "exclusive");
+    }
+    lean_inc(env);
+    lean_object *part = lean_apply_1(lean_alloc_closure((void *)with_env, 2, 0), env);
+    lean_inc(part);
+    lean_dec(part);
+    r = lean_apply_1(part, lean_box(1));
+    CHECK(lean_unbox(r) == 3 && env->m_rc == 1, "partial with_env: %zu, env count %d",
+          lean_unbox(r), env->m_rc);
+    lean_dec(env);
+
+    /* Exact application through lean_apply_1..4 with 0-4 fixed arguments.
+       Fixed arguments are one-field ctors, so their counts can be checked:
+       moved out of an exclusive closure, inc'd for a shared one. */
+    for (unsigned fixed = 0; fixed <= 4; fixed++) {
+        for (unsigned k = 1; k <= 4; k++) {
+            for (int shared = 0; shared < 2; shared++) {
+                lean_object *objs[4], *args[4];
+                size_t want = 0;
+                lean_object *c = lean_alloc_closure(sums[fixed + k], fixed + k, fixed);
+                for (unsigned i = 0; i < fixed; i++) {
+                    objs[i] = lean_alloc_ctor(0, 1, 0);
+                    lean_ctor_set(objs[i], 0, lean_box(10 * (i + 1)));
+                    lean_inc(objs[i]);
+                    lean_closure_set(c, i, objs[i]);
+                    want += 10 * (i + 1);
+                }
+                for (unsigned i = 0; i < k; i++) {
+                    args[i] = lean_box(i + 1);
+                    want += i + 1;
+                }
+                if (shared) lean_inc(c);
+                r = apply_k(c, k, args);
+                CHECK(lean_unbox(r) == want, "%u fixed + %u args, %s: %zu, want %zu", fixed, k,
+                      shared ? "shared" : "exclusive", lean_unbox(r), want);
+                if (shared) {
+                    for (unsigned i = 0; i < fixed; i++)
+                        CHECK(objs[i]->m_rc == 2, "%u fixed + %u args, shared: count %d while closure lives",
+                              fixed, k, objs[i]->m_rc);
+                    lean_dec(c);
+                }
+                for (unsigned i = 0; i < fixed; i++) {
+                    CHECK(objs[i]->m_rc == 1, "%u fixed + %u args, %s: count %d", fixed, k,
+                          shared ? "shared" : "exclusive", objs[i]->m_rc);
+                    lean_dec(objs[i]);
+                }
+            }
+        }
+    }
+
+    /* Over-application: adder returns a closure that takes the rest */
+    lean_object *ov = lean_alloc_closure((void *)adder, 1, 0);
+    r = lean_apply_2(ov, lean_box(7), lean_box(8));
+    CHECK(lean_unbox(r) == 15, "over-application: %zu", lean_unbox(r));
+
+    if (failures) return 1;
+    puts("apply_test: ok");
+    return 0;
+}
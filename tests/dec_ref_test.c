@@ -0,0 +1,113 @@
+/*
+ * dec_ref_test.c — freeing large object graphs (lean_dec_ref_cold)
+ *
+ * Frees a 10^6-cell List, a 10^6-node binary tree and a 10^6-element
+ * Array. Every list cell and array element holds a fresh leaf that is
+ * still pending when the next cell is taken, so the 256-entry dec_stack
+ * fills up and the rest of the graph goes through the spill chain that
+ * is threaded through dead objects' headers (dead_set_next /
+ * dead_get_next). Each leaf references one shared object, whose count
+ * must be back to 1 once everything is freed; builds with
+ * LEAN_WASM_ALLOC_STATS also check that live bytes return to where they
+ * started. With LEAN_WASM_THREADS the second round marks each graph
+ * multi-threaded first (lean_mark_mt), so it is freed through the atomic
+ * decrements and the shared object's count ends at -1.
+ */
+#include <lean/lean.h>
+#include "lean_runtime_wasm.h"
+#include <stdio.h>
+
+#define N 1000000
+#define TREE_DEPTH 20   /* 2^20 - 1 nodes */
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do {                                   \
+        if (!(cond)) {                                          \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                       \
+            fputc('\n', stderr);                                \
+            failures++;                                         \
+        }                                                       \
+    } while (0)
+
+static lean_object *shared;
+static int shared_rc = 1;   /* count of `shared` once a graph is freed */
+
+static lean_object *leaf(void) {
+    lean_object *o = lean_alloc_ctor(0, 1, 0);
+    lean_inc(shared);
+    lean_ctor_set(o, 0, shared);
+    return o;
+}
+
+static lean_object *list(size_t n) {
+    lean_object *l = lean_box(0);
+    for (size_t i = 0; i < n; i++) {
+        lean_object *c = lean_alloc_ctor(1, 2, 0);
+        lean_ctor_set(c, 0, leaf());
+        lean_ctor_set(c, 1, l);
+        l = c;
+    }
+    return l;
+}
+
+static lean_object *tree(unsigned depth) {
+    if (depth == 0) return leaf();
+    lean_object *t = lean_alloc_ctor(1, 2, 0);
+    lean_ctor_set(t, 0, tree(depth - 1));
+    lean_ctor_set(t, 1, tree(depth - 1));
+    return t;
+}
+
+static lean_object *array(size_t n) {
+    lean_object *a = lean_alloc_array(n, n);
+    for (size_t i = 0; i < n; i++) lean_array_set_core(a, i, leaf());
+    return a;
+}
+
+static uint64_t live_bytes(void) {
+    lean_wasm_free_drain();
+    lean_wasm_alloc_stats s;
+    lean_wasm_alloc_stats_get(&s);
+    return s.live_bytes;
+}
+
+static void free_all(const char *what, lean_object *o, int round) {
+#ifdef LEAN_WASM_THREADS
+    if (round > 0) {
+        lean_mark_mt(o);
+        shared_rc = -1;
+    }
+#else
+    (void)round;
+#endif
+    int before_rc = shared->m_rc;
+    lean_dec(o);
+    lean_wasm_free_drain();
+    CHECK(shared->m_rc == shared_rc, "%s: shared count %d after free (was %d)",
+          what, shared->m_rc, before_rc);
+}
+
+int main(void) {
+    shared = lean_alloc_ctor(0, 0, 0);
+    uint64_t live0 = live_bytes();
+
+    /* Twice, so the second round starts from the reused work stack */
+    for (int round = 0; round < 2; round++) {
+        free_all("list", list(N), round);
+        free_all("tree", tree(TREE_DEPTH), round);
+        free_all("array", array(N), round);
+    }
+
+    lean_wasm_alloc_stats s;
+    lean_wasm_alloc_stats_get(&s);
+    if (s.frees > 0)
+        CHECK(live_bytes() == live0, "live bytes %llu, expected %llu",
+              (unsigned long long)live_bytes(), (unsigned long long)live0);
+
+    lean_dec(shared);
+    if (failures) return 1;
+    puts("dec_ref_test: ok");
+    return 0;
+}
@@ -0,0 +1,208 @@
+/*
+ * drbg_test.c — HMAC_DRBG and the random-byte pool
+ *
+ * Includes the runtime to reach its static generator and replaces its
+ * entropy source (rng_entropy). Checks:
+ *   - NIST CAVP HMAC_DRBG SHA-256 vectors without prediction resistance
+ *     (256-bit entropy, 128-bit nonce, no personalization string or
+ *     additional input, 1024 returned bits): instantiate, reseed where
+ *     the vector has one, generate twice, compare the second output;
+ *   - lean_wasm_random_bytes against a second generator seeded alike:
+ *     requests straddling RNG_POOL_SIZE are served from the pool, then
+ *     from a refill or straight from the generator, requests over
+ *     RNG_MAX_REQUEST are split into generate calls of at most that size,
+ *     and bytes handed out are wiped from the pool;
+ *   - a reseed of 256 bits after RNG_RESEED_INTERVAL generate calls.
+ */
+#include "lean_runtime_wasm.c"
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do {                                   \
+        if (!(cond)) {                                          \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                       \
+            fputc('\n', stderr);                                \
+            failures++;                                         \
+        }                                                       \
+    } while (0)
+
+/* ── Test entropy ─────────────────────────────────────────────
+ * Bytes queued with queue_entropy, then a counter pattern. Every request
+ * is recorded. */
+
+static uint8_t  ent_queue[128];
+static size_t   ent_len, ent_pos;
+static unsigned ent_pattern;
+static size_t   ent_calls, ent_last;
+
+static void test_entropy(uint8_t *p, size_t n) {
+    ent_calls++;
+    ent_last = n;
+    for (size_t i = 0; i < n; i++)
+        p[i] = ent_pos < ent_len ? ent_queue[ent_pos++] : (uint8_t)(ent_pattern++ * 151 + 17);
+}
+
+static unsigned hex_digit(char c) {
+    return c <= '9' ? (unsigned)(c - '0') : (unsigned)(c - 'a' + 10);
+}
+
+static size_t unhex(uint8_t *out, const char *s) {
+    size_t n = 0;
+    for (; s[0] && s[1]; s += 2)
+        out[n++] = (uint8_t)(hex_digit(s[0]) << 4 | hex_digit(s[1]));
+    return n;
+}
+
+static void queue_entropy(const char *hex) {
+    ent_len += unhex(ent_queue + ent_len, hex);
+}
+
+static void reset_entropy(void) {
+    ent_len = ent_pos = 0;
+    ent_pattern = 0;
+    ent_calls = ent_last = 0;
+}
+
+/* ── CAVP vectors ─────────────────────────────────────────── */
+
+typedef struct {
+    const char *entropy, *nonce, *reseed, *returned;
+} cavp_vector;
+
+static const cavp_vector vectors[] = {
+    /* drbgvectors_pr_false/HMAC_DRBG.rsp, [SHA-256], COUNT = 0 */
+    { "06032cd5eed33f39265f49ecb142c511da9aff2af71203bffaf34a9ca5bd9c0d",
+      "0e66f71edc43e42a45ad3c6fc6cdc4df",
+      "01920a4e669ed3a85ae8a33b35a74ad7fb2a6bb4cf395ce00334a9c9a5a5d552",
+      "76fc79fe9b50beccc991a11b5635783a83536add03c157fb30645e611c2898bb"
+      "2b1bc215000209208cd506cb28da2a51bdb03826aaf2bd2335d576d519160842"
+      "e7158ad0949d1a9ec3e66ea1b1a064b005de914eac2e9d4f2d72a8616a802254"
+      "22918250ff66a41bd2f864a6a38cc5b6499dc43f7f2bd09e1e0f8f5885935124" },
+    /* COUNT = 1 */
+    { "aadcf337788bb8ac01976640726bc51635d417777fe6939eded9ccc8a378c76a",
+      "9ccc9d80c89ac55a8cfe0f99942f5a4d",
+      "03a57792547e0c98ea1776e4ba80c007346296a56a270a35fd9ea2845c7e81e2",
+      "17d09f40a43771f4a2f0db327df637dea972bfff30c98ebc8842dc7a9e3d681c"
+      "61902f71bffaf5093607fbfba9674a70d048e562ee88f027f630a78522ec6f70"
+      "6bb44ae130e05c8d7eac668bf6980d99b4c0242946452399cb032cc6f9fd9628"
+      "4709bd2fa565b9eb9f2004be6c9ea9ff9128c3f93b60dc30c5fc8587a10de68c" },
+    /* drbgvectors_no_reseed/HMAC_DRBG.rsp, [SHA-256], COUNT = 0 */
+    { "ca851911349384bffe89de1cbdc46e6831e44d34a4fb935ee285dd14b71a7488",
+      "659ba96c601dc69fc902940805ec0ca8",
+      NULL,
+      "e528e9abf2dece54d47c7e75e5fe302149f817ea9fb4bee6f4199697d04d5b89"
+      "d54fbb978a15b5c443c9ec21036d2460b6f73ebad0dc2aba6e624abf07745bc1"
+      "07694bb7547bb0995f70de25d6b29e2d3011bb19d27676c07162c8b5ccde0668"
+      "961df86803482cb37ed6d5c0bb8d50cf1f50d476aa0458bdaba806f48be9dcb8" },
+};
+
+static void check_vector(size_t i, const cavp_vector *v) {
+    uint8_t want[128], out[128];
+    unhex(want, v->returned);
+    reset_entropy();
+    queue_entropy(v->entropy);
+    queue_entropy(v->nonce);
+    if (v->reseed) queue_entropy(v->reseed);
+
+    hmac_drbg d = {0};
+    drbg_seed(&d);
+    CHECK(ent_last == 48, "vector %zu: instantiate drew %zu bytes", i, ent_last);
+    if (v->reseed) {
+        drbg_seed(&d);
+        CHECK(ent_last == 32, "vector %zu: reseed drew %zu bytes", i, ent_last);
+    }
+    drbg_generate(&d, out, sizeof(out));
+    drbg_generate(&d, out, sizeof(out));
+    CHECK(ent_pos == ent_len && ent_calls == (v->reseed ? 2u : 1u),
+          "vector %zu: %zu entropy requests", i, ent_calls);
+    CHECK(memcmp(out, want, sizeof(want)) == 0, "vector %zu: returned bits differ", i);
+}
+
+/* ── Pool ─────────────────────────────────────────────────── */
+
+/* Fresh pool and generator, and a reference generator `ref` that will be
+   instantiated from the same entropy */
+static void reset_rng(hmac_drbg *ref) {
+    memset(&rng_drbg, 0, sizeof(rng_drbg));
+    memset(rng_pool, 0, sizeof(rng_pool));
+    rng_avail = 0;
+    reset_entropy();
+    memset(ref, 0, sizeof(*ref));
+    drbg_seed(ref);
+    reset_entropy();
+}
+
+static bool pool_wiped(void) {
+    for (size_t i = 0; i < RNG_POOL_SIZE - rng_avail; i++)
+        if (rng_pool[i]) return false;
+    return true;
+}
+
+enum { BIG = 2 * RNG_MAX_REQUEST + 100 };
+static uint8_t got[BIG], want[BIG], block[RNG_MAX_REQUEST];
+
+static void check_pool(void) {
+    hmac_drbg ref;
+    uint8_t p1[RNG_POOL_SIZE], p2[RNG_POOL_SIZE];
+
+    /* 4000 + 200 bytes: the second request takes the last 96 bytes of
+       the first refill and 104 of a second one */
+    reset_rng(&ref);
+    drbg_generate(&ref, p1, RNG_POOL_SIZE);
+    drbg_generate(&ref, p2, RNG_POOL_SIZE);
+    lean_wasm_random_bytes(got, 4000);
+    lean_wasm_random_bytes(got + 4000, 200);
+    memcpy(want, p1, RNG_POOL_SIZE);
+    memcpy(want + RNG_POOL_SIZE, p2, 104);
+    CHECK(memcmp(got, want, 4200) == 0, "4000 + 200: bytes differ");
+    CHECK(rng_avail == RNG_POOL_SIZE - 104, "4000 + 200: %zu bytes left", rng_avail);
+    CHECK(pool_wiped(), "4000 + 200: handed-out bytes left in the pool");
+
+    /* 3992 + 5000 bytes: the rest of the pool, then 5000 straight from
+       the generator */
+    drbg_generate(&ref, want + 3992, 5000);
+    memcpy(want, p2 + 104, 3992);
+    lean_wasm_random_bytes(got, 3992 + 5000);
+    CHECK(memcmp(got, want, 3992 + 5000) == 0, "3992 + 5000: bytes differ");
+    CHECK(rng_avail == 0, "3992 + 5000: %zu bytes left", rng_avail);
+
+    /* RNG_POOL_SIZE - 1, then 1: one refill serves both */
+    drbg_generate(&ref, p1, RNG_POOL_SIZE);
+    lean_wasm_random_bytes(got, RNG_POOL_SIZE - 1);
+    lean_wasm_random_bytes(got + RNG_POOL_SIZE - 1, 1);
+    CHECK(memcmp(got, p1, RNG_POOL_SIZE) == 0, "pool size - 1, then 1: bytes differ");
+    CHECK(rng_avail == 0 && pool_wiped(), "pool size - 1, then 1: %zu bytes left", rng_avail);
+
+    /* Over RNG_MAX_REQUEST: two full generate calls, then 100 bytes from
+       a refill */
+    reset_rng(&ref);
+    drbg_generate(&ref, want, RNG_MAX_REQUEST);
+    drbg_generate(&ref, want + RNG_MAX_REQUEST, RNG_MAX_REQUEST);
+    drbg_generate(&ref, p1, RNG_POOL_SIZE);
+    memcpy(want + 2 * RNG_MAX_REQUEST, p1, 100);
+    lean_wasm_random_bytes(got, BIG);
+    CHECK(memcmp(got, want, BIG) == 0, "2 * RNG_MAX_REQUEST + 100: bytes differ");
+    CHECK(rng_avail == RNG_POOL_SIZE - 100, "2 * RNG_MAX_REQUEST + 100: %zu bytes left", rng_avail);
+
+    /* Reseed after RNG_RESEED_INTERVAL generate calls */
+    reset_rng(&ref);
+    for (unsigned i = 0; i < RNG_RESEED_INTERVAL; i++)
+        lean_wasm_random_bytes(block, RNG_POOL_SIZE);
+    CHECK(ent_calls == 1 && ent_last == 48, "%zu entropy requests before the reseed", ent_calls);
+    lean_wasm_random_bytes(block, RNG_POOL_SIZE);
+    CHECK(ent_calls == 2 && ent_last == 32, "reseed: %zu requests, last of %zu bytes",
+          ent_calls, ent_last);
+}
+
+int main(void) {
+    rng_entropy = test_entropy;
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++)
+        check_vector(i, &vectors[i]);
+    check_pool();
+
+    if (failures) return 1;
+    puts("drbg_test: ok");
+    return 0;
+}
@@ -0,0 +1,116 @@
+/*
+ * hash_bench.c — wyhash (hash_bytes) against the old h * 31 + c loop
+ *
+ * Collisions: 200k short keys (three or four letters, the worst case for
+ * a multiplicative hash) and 200k "x-custom-header-N" names, counting
+ * full 64-bit collisions and the largest bucket of a 2^16-bucket table
+ * indexed by the low bits, as HashMap does.
+ *
+ * Throughput: MB/s of lean_byte_array_hash from 8 bytes to 64 KiB.
+ *
+ *   tests/run.sh hash_bench           (TARGET=wasm for the emcc build)
+ */
+#include <lean/lean.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define KEYS     200000
+#define BUCKETS  (1 << 16)
+#define MB_PER_SIZE 64
+
+static uint64_t old_hash(const uint8_t *p, size_t n) {
+    uint64_t h = 7;
+    for (size_t i = 0; i < n; i++) h = h * 31 + p[i];
+    return h;
+}
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static lean_object *byte_array(const void *p, size_t n) {
+    lean_object *o = lean_alloc_sarray(1, n, n);
+    memcpy(lean_sarray_cptr(o), p, n);
+    return o;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Key i of a set: short letter combinations or numbered header names */
+static size_t make_key(int set, int i, char *k) {
+    static const char letters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+    if (set == 1) return (size_t)snprintf(k, 64, "x-custom-header-%d", i);
+    k[0] = letters[i % 52];
+    k[1] = letters[i / 52 % 52];
+    k[2] = letters[i / (52 * 52) % 52];
+    if (i < 52 * 52 * 52) return 3;
+    k[3] = letters[i % 7];
+    return 4;
+}
+
+static void report(const char *name, uint64_t *h) {
+    static unsigned bucket[BUCKETS];
+    memset(bucket, 0, sizeof bucket);
+    unsigned max = 0;
+    for (int i = 0; i < KEYS; i++)
+        if (++bucket[h[i] & (BUCKETS - 1)] > max) max = bucket[h[i] & (BUCKETS - 1)];
+    qsort(h, KEYS, sizeof *h, cmp_u64);
+    unsigned full = 0;
+    for (int i = 1; i < KEYS; i++) full += h[i] == h[i - 1];
+    printf("  %-8s %8u %14u\n", name, full, max);
+}
+
+static void collisions(void) {
+    static const char *sets[] = { "short keys", "header names" };
+    uint64_t *hn = malloc(sizeof(uint64_t) * KEYS), *ho = malloc(sizeof(uint64_t) * KEYS);
+    for (int set = 0; set < 2; set++) {
+        for (int i = 0; i < KEYS; i++) {
+            char k[64];
+            size_t n = make_key(set, i, k);
+            lean_object *b = byte_array(k, n);
+            hn[i] = lean_byte_array_hash(b);
+            ho[i] = old_hash((const uint8_t *)k, n);
+            lean_dec(b);
+        }
+        printf("%s (%d keys): 64-bit collisions, max bucket of %d\n", sets[set], KEYS, BUCKETS);
+        report("wyhash", hn);
+        report("h*31+c", ho);
+    }
+    free(hn);
+    free(ho);
+}
+
+static void throughput(void) {
+    static const size_t sizes[] = { 8, 16, 32, 64, 128, 256, 1024, 65536 };
+    printf("\n  bytes   wyhash MB/s   h*31+c MB/s\n");
+    for (size_t si = 0; si < sizeof sizes / sizeof *sizes; si++) {
+        size_t n = sizes[si];
+        uint8_t *d = malloc(n);
+        for (size_t i = 0; i < n; i++) d[i] = (uint8_t)(i * 7);
+        lean_object *b = byte_array(d, n);
+        size_t iters = ((size_t)MB_PER_SIZE << 20) / n;
+        volatile uint64_t sink = 0;
+        double t0 = now();
+        for (size_t i = 0; i < iters; i++) sink += lean_byte_array_hash(b);
+        double t1 = now();
+        for (size_t i = 0; i < iters; i++) sink += old_hash(lean_sarray_cptr(b), n);
+        double t2 = now();
+        printf("%7zu %13.0f %13.0f\n", n, MB_PER_SIZE / (t1 - t0), MB_PER_SIZE / (t2 - t1));
+        (void)sink;
+        lean_dec(b);
+        free(d);
+    }
+}
+
+int main(void) {
+    collisions();
+    throughput();
+    return 0;
+}
@@ -0,0 +1,86 @@
+/*
+ * hash_test.c — ByteArray, String and String.Slice hash agreement
+ *
+ * lean_byte_array_hash, lean_string_hash and lean_slice_hash share
+ * hash_bytes, so equal bytes must hash equally whichever type holds them.
+ * Checked for every length 0..200, for slices not starting at offset 0,
+ * and for each start alignment (the 8-byte reads are unaligned). Also
+ * checks that lean_slice_dec_lt compares the slices' byte ranges.
+ */
+#include <lean/lean.h>
+#include <stdio.h>
+#include <string.h>
+
+LEAN_EXPORT uint64_t lean_slice_hash(b_lean_obj_arg s);
+LEAN_EXPORT uint8_t lean_slice_dec_lt(b_lean_obj_arg s1, b_lean_obj_arg s2);
+
+#define MAX_LEN 200
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do {                                   \
+        if (!(cond)) {                                          \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                       \
+            fputc('\n', stderr);                                \
+            failures++;                                         \
+        }                                                       \
+    } while (0)
+
+static lean_object *byte_array(const char *p, size_t n) {
+    lean_object *o = lean_alloc_sarray(1, n, n);
+    memcpy(lean_sarray_cptr(o), p, n);
+    return o;
+}
+
+/* String.Slice {str, startInclusive, endExclusive}; takes str. */
+static lean_object *slice(lean_object *str, size_t start, size_t end) {
+    lean_object *o = lean_alloc_ctor(0, 3, 0);
+    lean_ctor_set(o, 0, str);
+    lean_ctor_set(o, 1, lean_box(start));
+    lean_ctor_set(o, 2, lean_box(end));
+    return o;
+}
+
+int main(void) {
+    char buf[MAX_LEN + 16];
+    for (size_t i = 0; i < sizeof buf; i++) buf[i] = (char)('a' + (i * 7) % 26);
+
+    for (size_t n = 0; n <= MAX_LEN; n++) {
+        lean_object *s = lean_mk_string_from_bytes(buf, n);
+        lean_object *b = byte_array(buf, n);
+        uint64_t h = lean_byte_array_hash(b);
+        CHECK(lean_string_hash(s) == h, "len %zu: String and ByteArray differ", n);
+        lean_inc(s);
+        lean_object *whole = slice(s, 0, n);
+        CHECK(lean_slice_hash(whole) == h, "len %zu: full slice and ByteArray differ", n);
+        lean_dec(whole);
+
+        /* The same n bytes starting at offsets 1..8 of a longer string */
+        lean_object *wide = lean_mk_string_from_bytes(buf, n + 16);
+        for (size_t off = 1; off <= 8; off++) {
+            lean_object *b2 = byte_array(buf + off, n);
+            lean_inc(wide);
+            lean_object *sub = slice(wide, off, off + n);
+            CHECK(lean_slice_hash(sub) == lean_byte_array_hash(b2),
+                  "len %zu offset %zu: slice and ByteArray differ", n, off);
+            if (n > 0) {
+                lean_inc(wide);
+                lean_object *longer = slice(wide, off, off + n + 1);
+                CHECK(lean_slice_dec_lt(sub, longer) && !lean_slice_dec_lt(longer, sub),
+                      "len %zu offset %zu: slice is not below its extension", n, off);
+                CHECK(!lean_slice_dec_lt(sub, sub), "len %zu offset %zu: slice below itself", n, off);
+                lean_dec(longer);
+            }
+            lean_dec(sub);
+            lean_dec(b2);
+        }
+        lean_dec(wide);
+        lean_dec(b);
+        lean_dec(s);
+    }
+
+    if (failures) return 1;
+    puts("hash_test: ok");
+    return 0;
+}
@@ -0,0 +1,139 @@
+/*
+ * nat_overflow_test.c — scalar/big Nat boundary (known values)
+ *
+ * On wasm32 LEAN_MAX_SMALL_NAT is 2^31 - 1, so values from 2^31 up leave
+ * the boxed-scalar path: lean_usize_to_nat, lean_uint64_to_nat, Nat
+ * multiplication and lean_nat_shiftl all fall back to the bignum code.
+ * Run it with TARGET=m32 or TARGET=wasm for that limit to apply; natively
+ * the same checks cover the 2^63 boundary instead.
+ *
+ * Each result is compared against lean_cstr_to_nat of its decimal value,
+ * and must be a scalar exactly when the expected value is one.
+ */
+#include <lean/lean.h>
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do {                                   \
+        if (!(cond)) {                                          \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                       \
+            fputc('\n', stderr);                                \
+            failures++;                                         \
+        }                                                       \
+    } while (0)
+
+#define WIDE (sizeof(size_t) == 8)
+
+/* Consumes r. */
+static void expect(const char *what, lean_object *r, const char *dec) {
+    lean_object *e = lean_cstr_to_nat(dec);
+    CHECK(lean_nat_eq(r, e), "%s: expected %s, low 64 bits are %llu", what, dec,
+          (unsigned long long)(lean_is_scalar(r) ? lean_unbox(r) : lean_uint64_of_big_nat(r)));
+    CHECK(lean_is_scalar(r) == lean_is_scalar(e), "%s = %s: %s, expected %s", what, dec,
+          lean_is_scalar(r) ? "scalar" : "big", lean_is_scalar(e) ? "scalar" : "big");
+    lean_dec(r);
+    lean_dec(e);
+}
+
+static void expect_u64(const char *what, uint64_t got, uint64_t want) {
+    CHECK(got == want, "%s: got %llx, expected %llx", what,
+          (unsigned long long)got, (unsigned long long)want);
+}
+
+static void test_usize_to_nat(void) {
+    expect("usize 2^31-1", lean_usize_to_nat(0x7fffffff), "2147483647");
+    expect("usize 2^31", lean_usize_to_nat(0x80000000u), "2147483648");
+    expect("usize 2^31+1", lean_usize_to_nat(0x80000001u), "2147483649");
+    expect("usize 2^32-1", lean_usize_to_nat(0xffffffffu), "4294967295");
+    expect("big_usize 2^31", lean_big_usize_to_nat(0x80000000u), "2147483648");
+    if (WIDE)
+        expect("usize 2^63", lean_usize_to_nat(SIZE_MAX / 2 + 1), "9223372036854775808");
+    expect("usize SIZE_MAX", lean_usize_to_nat(SIZE_MAX),
+           WIDE ? "18446744073709551615" : "4294967295");
+}
+
+static void test_uint64_to_nat(void) {
+    expect("u64 2^31-1", lean_uint64_to_nat(0x7fffffffULL), "2147483647");
+    expect("u64 2^31", lean_uint64_to_nat(0x80000000ULL), "2147483648");
+    expect("u64 2^32-1", lean_uint64_to_nat(0xffffffffULL), "4294967295");
+    expect("u64 2^32", lean_uint64_to_nat(0x100000000ULL), "4294967296");
+    expect("u64 2^32+1", lean_uint64_to_nat(0x100000001ULL), "4294967297");
+    expect("u64 2^63-1", lean_uint64_to_nat(0x7fffffffffffffffULL), "9223372036854775807");
+    expect("u64 2^63", lean_uint64_to_nat(0x8000000000000000ULL), "9223372036854775808");
+    expect("u64 2^64-1", lean_uint64_to_nat(UINT64_MAX), "18446744073709551615");
+    expect("big_u64 2^32", lean_big_uint64_to_nat(0x100000000ULL), "4294967296");
+    expect("big_u64 2^64-1", lean_big_uint64_to_nat(UINT64_MAX), "18446744073709551615");
+}
+
+static void test_mul(void) {
+    expect("46340^2", lean_nat_mul(lean_box(46340), lean_box(46340)), "2147395600");
+    expect("46341^2", lean_nat_mul(lean_box(46341), lean_box(46341)), "2147488281");
+    expect("65536^2", lean_nat_mul(lean_box(65536), lean_box(65536)), "4294967296");
+    expect("overflow_mul 65536^2", lean_nat_overflow_mul(65536, 65536), "4294967296");
+    expect("overflow_mul 2^31*2", lean_nat_overflow_mul(0x80000000u, 2), "4294967296");
+    expect("overflow_mul SIZE_MAX^2", lean_nat_overflow_mul(SIZE_MAX, SIZE_MAX),
+           WIDE ? "340282366920938463426481119284349108225" : "18446744065119617025");
+}
+
+static void test_shiftl(void) {
+    expect("1 << 30", lean_nat_shiftl(lean_box(1), lean_box(30)), "1073741824");
+    expect("1 << 31", lean_nat_shiftl(lean_box(1), lean_box(31)), "2147483648");
+    expect("1 << 32", lean_nat_shiftl(lean_box(1), lean_box(32)), "4294967296");
+    expect("3 << 31", lean_nat_shiftl(lean_box(3), lean_box(31)), "6442450944");
+    expect("1 << 63", lean_nat_shiftl(lean_box(1), lean_box(63)), "9223372036854775808");
+    expect("1 << 64", lean_nat_shiftl(lean_box(1), lean_box(64)), "18446744073709551616");
+    expect("0 << 1000", lean_nat_shiftl(lean_box(0), lean_box(1000)), "0");
+    lean_object *a = lean_uint64_to_nat(0xffffffffULL);
+    expect("(2^32-1) << 1", lean_nat_shiftl(a, lean_box(1)), "8589934590");
+    expect("(2^32-1) << 0", lean_nat_shiftl(a, lean_box(0)), "4294967295");
+    lean_dec(a);
+    lean_object *b = lean_uint64_to_nat(0x10000000001ULL);   /* 2^40 + 1 */
+    expect("(2^40+1) << 33", lean_nat_shiftl(b, lean_box(33)), "9444732965747880361984");
+    lean_dec(b);
+}
+
+/* UIntN.ofNat of a big Nat keeps its low N bits. */
+static void test_of_big_nat(void) {
+    lean_object *a = lean_cstr_to_nat("19758512541173341936");   /* 2^64 + 0x123456789abcdef0 */
+    expect_u64("u8 of 2^64+c", lean_uint8_of_big_nat(a), 0xf0);
+    expect_u64("u16 of 2^64+c", lean_uint16_of_big_nat(a), 0xdef0);
+    expect_u64("u32 of 2^64+c", lean_uint32_of_big_nat(a), 0x9abcdef0);
+    expect_u64("u64 of 2^64+c", lean_uint64_of_big_nat(a), 0x123456789abcdef0ULL);
+    lean_dec(a);
+
+    lean_object *b = lean_cstr_to_nat("340282366920938463481821351505477763079");   /* 2^128 + 2^64 + 7 */
+    expect_u64("u16 of 2^128+2^64+7", lean_uint16_of_big_nat(b), 7);
+    expect_u64("u32 of 2^128+2^64+7", lean_uint32_of_big_nat(b), 7);
+    expect_u64("u64 of 2^128+2^64+7", lean_uint64_of_big_nat(b), 7);
+    lean_dec(b);
+
+    lean_object *c = lean_cstr_to_nat("4295000065");   /* 2^32 + 0x8001 */
+    expect_u64("u16 of 2^32+0x8001", lean_uint16_of_big_nat(c), 0x8001);
+    expect_u64("u32 of 2^32+0x8001", lean_uint32_of_big_nat(c), 0x8001);
+    expect_u64("u64 of 2^32+0x8001", lean_uint64_of_big_nat(c), 0x100008001ULL);
+    lean_dec(c);
+
+    /* Big only where LEAN_MAX_SMALL_NAT is 2^31 - 1 */
+    lean_object *d = lean_usize_to_nat(0x80000001u);
+    if (!lean_is_scalar(d)) {
+        expect_u64("u16 of 2^31+1", lean_uint16_of_big_nat(d), 1);
+        expect_u64("u32 of 2^31+1", lean_uint32_of_big_nat(d), 0x80000001u);
+        expect_u64("u64 of 2^31+1", lean_uint64_of_big_nat(d), 0x80000001u);
+    }
+    lean_dec(d);
+}
+
+int main(void) {
+    test_usize_to_nat();
+    test_uint64_to_nat();
+    test_mul();
+    test_shiftl();
+    test_of_big_nat();
+    if (failures) return 1;
+    printf("nat_overflow_test: ok (LEAN_MAX_SMALL_NAT = %llu)\n",
+           (unsigned long long)LEAN_MAX_SMALL_NAT);
+    return 0;
+}
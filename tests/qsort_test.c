@@ -0,0 +1,282 @@
+/*
+ * qsort_test.c — Array.qsort through l_Array_qpartition___redArg
+ *
+ * The stub sorts the whole range [lo, hi] with an introsort and answers
+ * mid = hi, so one call is all of Array.qsort. Checks, for every length
+ * up to 40 and a few larger ones:
+ *   - Nat (scalar and big), String and UInt8 arrays come out sorted, as a
+ *     permutation of the input, with each element's count unchanged;
+ *   - a shared array is left as it was and the sorted copy holds a second
+ *     reference to each element;
+ *   - Nat.decLt, Nat.blt and UInt8.decLt closures (the scalar path that
+ *     skips the closure) agree with an equivalent lambda comparator,
+ *     and with a Nat.decLt closure on arrays holding a big Nat, which
+ *     takes the closure path;
+ *   - comparators that are not strict weak orders (random, always true,
+ *     always false) keep the result a permutation of the input. Run with
+ *     CFLAGS=-fsanitize=address to see that they stay in bounds.
+ */
+#include <lean/lean.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+LEAN_EXPORT lean_object *l_Array_qpartition___redArg(lean_object *a, lean_object *lt,
+                                                     lean_object *lo, lean_object *hi);
+LEAN_EXPORT lean_object *l_Nat_decLt___boxed(lean_object *a, lean_object *b);
+LEAN_EXPORT lean_object *l_Nat_blt___boxed(lean_object *a, lean_object *b);
+LEAN_EXPORT lean_object *l_UInt8_decLt___boxed(lean_object *a, lean_object *b);
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do {                                   \
+        if (!(cond) && failures++ < 20) {                       \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                       \
+            fputc('\n', stderr);                                \
+        }                                                       \
+    } while (0)
+
+static uint64_t rand64(void) {
+    return ((uint64_t)rand() << 42) ^ ((uint64_t)rand() << 21) ^ (uint64_t)rand();
+}
+
+static uint64_t nat_val(b_lean_obj_arg n) {
+    return lean_is_scalar(n) ? lean_unbox(n) : lean_uint64_of_big_nat(n);
+}
+
+/* ── Comparators written as lambdas (always the closure path) ── */
+
+static size_t lambda_calls = 0;
+
+static lean_object *nat_lt(lean_object *a, lean_object *b) {
+    lambda_calls++;
+    uint8_t r = lean_nat_dec_lt(a, b);
+    lean_dec(a); lean_dec(b);
+    return lean_box(r);
+}
+
+static lean_object *string_lt(lean_object *a, lean_object *b) {
+    lambda_calls++;
+    uint8_t r = lean_string_lt(a, b);
+    lean_dec(a); lean_dec(b);
+    return lean_box(r);
+}
+
+static lean_object *random_lt(lean_object *a, lean_object *b) {
+    lean_dec(a); lean_dec(b);
+    return lean_box(rand() & 1);
+}
+
+static lean_object *always_lt(lean_object *a, lean_object *b) {
+    lean_dec(a); lean_dec(b);
+    return lean_box(1);
+}
+
+static lean_object *never_lt(lean_object *a, lean_object *b) {
+    lean_dec(a); lean_dec(b);
+    return lean_box(0);
+}
+
+static lean_object *closure2(void *fn) {
+    return lean_alloc_closure(fn, 2, 0);
+}
+
+/* Array.qsort as lt: one qpartition over [0, n-1], which must answer
+   mid = hi. Consumes a and lt. */
+static lean_object *array_qsort(lean_object *a, lean_object *lt) {
+    size_t n = lean_array_size(a);
+    if (n < 2) {
+        lean_dec(lt);
+        return a;
+    }
+    lean_object *r = l_Array_qpartition___redArg(a, lt, lean_box(0), lean_box(n - 1));
+    CHECK(lean_unbox(lean_ctor_get(r, 0)) == n - 1, "qpartition mid %zu, hi %zu",
+          lean_unbox(lean_ctor_get(r, 0)), n - 1);
+    lean_object *sorted = lean_ctor_get(r, 1);
+    lean_inc(sorted);
+    lean_dec(r);
+    return sorted;
+}
+
+static int cmp_ptr(const void *x, const void *y) {
+    size_t a = *(const size_t *)x, b = *(const size_t *)y;
+    return a < b ? -1 : a > b;
+}
+
+/* Same elements (as pointers), in any order */
+static int is_permutation(b_lean_obj_arg a, b_lean_obj_arg b) {
+    size_t n = lean_array_size(a);
+    if (lean_array_size(b) != n) return 0;
+    size_t *x = malloc(sizeof(size_t) * (n + 1)), *y = malloc(sizeof(size_t) * (n + 1));
+    for (size_t i = 0; i < n; i++) {
+        x[i] = (size_t)lean_array_get_core(a, i);
+        y[i] = (size_t)lean_array_get_core(b, i);
+    }
+    qsort(x, n, sizeof *x, cmp_ptr);
+    qsort(y, n, sizeof *y, cmp_ptr);
+    int ok = memcmp(x, y, sizeof(size_t) * n) == 0;
+    free(x);
+    free(y);
+    return ok;
+}
+
+/* Every non-scalar element has count `rc` */
+static int counts_are(b_lean_obj_arg a, int rc) {
+    for (size_t i = 0; i < lean_array_size(a); i++) {
+        lean_object *o = lean_array_get_core(a, i);
+        if (!lean_is_scalar(o) && o->m_rc != rc) return 0;
+    }
+    return 1;
+}
+
+static int nat_sorted(b_lean_obj_arg a) {
+    for (size_t i = 1; i < lean_array_size(a); i++)
+        if (nat_val(lean_array_get_core(a, i)) < nat_val(lean_array_get_core(a, i - 1))) return 0;
+    return 1;
+}
+
+static int string_sorted(b_lean_obj_arg a) {
+    for (size_t i = 1; i < lean_array_size(a); i++)
+        if (lean_string_lt(lean_array_get_core(a, i), lean_array_get_core(a, i - 1))) return 0;
+    return 1;
+}
+
+static int same_values(b_lean_obj_arg a, b_lean_obj_arg b) {
+    for (size_t i = 0; i < lean_array_size(a); i++)
+        if (nat_val(lean_array_get_core(a, i)) != nat_val(lean_array_get_core(b, i))) return 0;
+    return 1;
+}
+
+/* `keys` distinct values; big Nats above LEAN_MAX_SMALL_NAT when `big` */
+static lean_object *random_nats(size_t n, uint64_t keys, int big) {
+    lean_object *a = lean_alloc_array(n, n);
+    for (size_t i = 0; i < n; i++) {
+        uint64_t v = rand64() % keys;
+        if (big && (rand() & 1)) v = (uint64_t)LEAN_MAX_SMALL_NAT + 1 + v;
+        lean_array_cptr(a)[i] = lean_uint64_to_nat(v);
+    }
+    return a;
+}
+
+static lean_object *random_strings(size_t n) {
+    lean_object *a = lean_alloc_array(n, n);
+    static const char *const pieces[] = { "a", "b", "c", "\xc3\xa9" };
+    char buf[16];
+    for (size_t i = 0; i < n; i++) {
+        size_t len = rand() % 5;
+        buf[0] = 0;
+        for (size_t k = 0; k < len; k++) strcat(buf, pieces[rand() % 4]);
+        lean_array_cptr(a)[i] = lean_mk_string(buf);
+    }
+    return a;
+}
+
+static lean_object *copy_of(b_lean_obj_arg a) {
+    size_t n = lean_array_size(a);
+    lean_object *c = lean_alloc_array(n, n);
+    for (size_t i = 0; i < n; i++) {
+        lean_object *o = lean_array_get_core(a, i);
+        lean_inc(o);
+        lean_array_cptr(c)[i] = o;
+    }
+    return c;
+}
+
+/* Sort `a` (exclusive, then shared) with `lt`, check order, permutation
+   and counts. Consumes a. */
+static void check_sort(lean_object *a, void *lt, int (*sorted)(b_lean_obj_arg), const char *what) {
+    size_t n = lean_array_size(a);
+
+    /* Exclusive: sorted in place */
+    lean_object *before = copy_of(a);   /* holds a second reference */
+    lean_object *in = a;
+    lean_object *s = array_qsort(a, closure2(lt));
+    CHECK(s == in, "%s, n = %zu: exclusive array was copied", what, n);
+    CHECK(sorted(s), "%s, n = %zu: not sorted", what, n);
+    CHECK(is_permutation(s, before), "%s, n = %zu: not a permutation", what, n);
+    CHECK(counts_are(s, 2), "%s, n = %zu: element counts changed", what, n);
+    lean_dec(s);
+    CHECK(counts_are(before, 1), "%s, n = %zu: element counts after free", what, n);
+
+    /* Shared: the original is left alone */
+    lean_object *order = copy_of(before);
+    lean_inc(before);
+    s = array_qsort(before, closure2(lt));
+    for (size_t i = 0; i < n; i++)
+        CHECK(lean_array_get_core(before, i) == lean_array_get_core(order, i),
+              "%s, n = %zu: shared original changed at %zu", what, n, i);
+    lean_dec(order);
+    CHECK(n < 2 || s != before, "%s, n = %zu: shared array sorted in place", what, n);
+    CHECK(sorted(s), "%s, n = %zu: shared copy not sorted", what, n);
+    CHECK(is_permutation(s, before), "%s, n = %zu: shared copy not a permutation", what, n);
+    CHECK(counts_are(before, n < 2 ? 1 : 2), "%s, n = %zu: shared element counts", what, n);
+    lean_dec(s);
+    CHECK(before->m_rc == 1 && counts_are(before, 1), "%s, n = %zu: counts after shared sort", what, n);
+    lean_dec(before);
+}
+
+static int any_order(b_lean_obj_arg a) { (void)a; return 1; }
+
+int main(void) {
+    static const size_t big_sizes[] = { 100, 257, 1000, 5000 };
+    size_t sizes[41 + sizeof big_sizes / sizeof *big_sizes], nsizes = 0;
+    for (size_t n = 0; n <= 40; n++) sizes[nsizes++] = n;
+    for (size_t k = 0; k < sizeof big_sizes / sizeof *big_sizes; k++) sizes[nsizes++] = big_sizes[k];
+
+    srand(17);
+    for (size_t k = 0; k < nsizes; k++) {
+        size_t n = sizes[k];
+        check_sort(random_nats(n, 1000000, 0), nat_lt, nat_sorted, "scalar Nat, lambda");
+        check_sort(random_nats(n, 4, 0), nat_lt, nat_sorted, "4 keys, lambda");
+        check_sort(random_nats(n, 1000, 1), l_Nat_decLt___boxed, nat_sorted, "big Nat, Nat.decLt");
+        check_sort(random_strings(n), string_lt, string_sorted, "String, lambda");
+
+        /* Scalar path against the closure path on the same input */
+        static void *const fast[] = { l_Nat_decLt___boxed, l_Nat_blt___boxed, l_UInt8_decLt___boxed };
+        for (size_t f = 0; f < sizeof fast / sizeof *fast; f++) {
+            lean_object *a = random_nats(n, f == 2 ? 256 : 1000, 0);
+            lean_object *b = copy_of(a);
+            lambda_calls = 0;
+            lean_object *want = array_qsort(b, closure2(nat_lt));
+            CHECK(n < 2 || lambda_calls > 0, "lambda comparator was not called");
+            lean_object *got = array_qsort(a, closure2(fast[f]));
+            CHECK(same_values(got, want), "comparator %zu, n = %zu: scalar path differs", f, n);
+            lean_dec(got);
+            lean_dec(want);
+        }
+
+        /* One big Nat among scalars: Nat.decLt must use the closure */
+        if (n > 0) {
+            lean_object *a = random_nats(n, 1000, 0);
+            lean_dec(lean_array_cptr(a)[n / 2]);
+            lean_array_cptr(a)[n / 2] = lean_uint64_to_nat((uint64_t)LEAN_MAX_SMALL_NAT + 5);
+            check_sort(a, l_Nat_decLt___boxed, nat_sorted, "mixed Nat, Nat.decLt");
+        }
+
+        /* Not strict weak orders: any order, but the same elements */
+        check_sort(random_nats(n, 1000, 1), random_lt, any_order, "random comparator");
+        check_sort(random_strings(n), always_lt, any_order, "always-true comparator");
+        check_sort(random_nats(n, 1000, 1), never_lt, any_order, "always-false comparator");
+    }
+
+    /* qpartition on a sub-range leaves the rest alone */
+    lean_object *a = random_nats(50, 1000, 0);
+    lean_object *orig = copy_of(a);
+    lean_object *r = l_Array_qpartition___redArg(a, closure2(nat_lt), lean_box(10), lean_box(29));
+    lean_object *s = lean_ctor_get(r, 1);
+    CHECK(lean_unbox(lean_ctor_get(r, 0)) == 29, "sub-range mid %zu", lean_unbox(lean_ctor_get(r, 0)));
+    for (size_t i = 0; i < 50; i++) {
+        if (i < 10 || i > 29)
+            CHECK(lean_array_get_core(s, i) == lean_array_get_core(orig, i), "element %zu moved", i);
+        else if (i > 10)
+            CHECK(nat_val(lean_array_get_core(s, i - 1)) <= nat_val(lean_array_get_core(s, i)),
+                  "sub-range not sorted at %zu", i);
+    }
+    lean_dec(r);
+    lean_dec(orig);
+
+    if (failures) return 1;
+    puts("qsort_test: ok");
+    return 0;
+}
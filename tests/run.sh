@@ -0,0 +1,102 @@
+#!/usr/bin/env bash
+# ── tests/run.sh ──────────────────────────────────────────────
+# Builds and runs the runtime harnesses in tests/. Each one is a small C
+# program linked against wasm/lean_runtime_wasm.c (drbg_test includes it
+# instead) that exits non-zero when a check fails; *_bench.c programs only
+# print timings.
+#
+# Usage:
+#   tests/run.sh               every *_test.c, in each of its build variants
+#   tests/run.sh NAME...       the named harnesses (tests or benchmarks)
+#
+# Environment:
+#   TARGET=native  Host compiler (default)
+#   TARGET=m32     Host compiler with -m32: 32-bit size_t and pointers,
+#                  so LEAN_MAX_SMALL_NAT is 2^31-1 as on wasm32
+#   TARGET=wasm    emcc, run with node
+#   CC, CFLAGS     Compiler and extra flags (e.g. CFLAGS=-fsanitize=address)
+#   LDLIBS         Libraries to link (default: -lm, plus -lpthread natively)
+#   LEAN_INCLUDE   Directory containing lean/lean.h
+#                  (default: the include dir of `lean --print-prefix`)
+# ──────────────────────────────────────────────────────────────
+set -euo pipefail
+
+SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
+ROOT="$(dirname "${SCRIPT_DIR}")"
+LEAN_INCLUDE="${LEAN_INCLUDE:-$(lean --print-prefix)/include}"
+TARGET="${TARGET:-native}"
+BUILD="${SCRIPT_DIR}/build/${TARGET}"
+mkdir -p "${BUILD}"
+
+# Runtime flag sets a harness is built with, separated by '|'
+variants() {
+  case "$1:${TARGET}" in
+    utf8_*:native)
+      # SSE2 (x86-64 default) and the 64-bit word fallback
+      echo " |-U__SSE2__ -U__AVX2__" ;;
+    utf8_*:m32)
+      # i386 has no SSE2 by default: word fallback, then SSE2
+      echo " |-msse2" ;;
+    utf8_*:wasm)
+      echo " |-msimd128" ;;
+    apply_*:*)
+      echo " |-DLEAN_WASM_SLAB" ;;
+    x25519_*:*)
+      # dlmalloc and slab, each with and without deferred freeing
+      echo " |-DLEAN_WASM_DEFERRED_FREE|-DLEAN_WASM_SLAB|-DLEAN_WASM_SLAB -DLEAN_WASM_DEFERRED_FREE" ;;
+    dec_ref_test:*)
+      echo " |-DLEAN_WASM_SLAB|-DLEAN_WASM_DEFERRED_FREE|-DLEAN_WASM_ALLOC_STATS|-DLEAN_WASM_SLAB -DLEAN_WASM_ALLOC_STATS|-DLEAN_WASM_DEFERRED_FREE -DLEAN_WASM_ALLOC_STATS|-pthread -DLEAN_WASM_THREADS" ;;
+    task_*:*)
+      echo " |-pthread -DLEAN_WASM_THREADS" ;;
+    *)
+      echo " " ;;
+  esac
+}
+
+# Sources linked besides the harness and the runtime
+extra_sources() {
+  case "$1" in
+    split_on_*|qsort_*) echo "${ROOT}/wasm/init_stubs_wasm.c" ;;
+    *) echo "" ;;
+  esac
+}
+
+# Tests that #include the runtime to reach its static functions
+runtime_source() {
+  case "$1" in
+    drbg_*) echo "" ;;
+    *) echo "${ROOT}/wasm/lean_runtime_wasm.c" ;;
+  esac
+}
+
+build_and_run() {
+  local name="$1" flags="$2"
+  local src="${SCRIPT_DIR}/${name}.c"
+  local tag
+  tag="$(echo "${flags}" | tr -c 'A-Za-z0-9\n' '_' | sed 's/_LEAN_WASM//g')"
+  local out="${BUILD}/${name}${tag}"
+  local common=(-O2 -I "${ROOT}/wasm" -I "${LEAN_INCLUDE}" ${flags} ${CFLAGS:-}
+                "${src}" $(runtime_source "${name}") $(extra_sources "${name}"))
+  echo "▶ ${name} [${TARGET}${flags:+ ${flags}}]"
+  case "${TARGET}" in
+    native) "${CC:-cc}" -std=gnu11 "${common[@]}" -o "${out}" ${LDLIBS--lm -lpthread} && "${out}" ;;
+    m32)    "${CC:-cc}" -m32 -std=gnu11 "${common[@]}" -o "${out}" ${LDLIBS--lm} && "${out}" ;;
+    wasm)   emcc -DLEAN_EMSCRIPTEN -s ALLOW_MEMORY_GROWTH=1 -s ENVIRONMENT=node \
+              "${common[@]}" -o "${out}.js" && node "${out}.js" ;;
+    *)      echo "❌ Unknown TARGET='${TARGET}' (expected native, m32 or wasm)"; exit 1 ;;
+  esac
+}
+
+if [ $# -eq 0 ]; then
+  set -- $(cd "${SCRIPT_DIR}" && ls *_test.c | sed 's/\.c$//')
+fi
+
+failed=0
+for name in "$@"; do
+  IFS='|' read -ra flag_sets <<< "$(variants "${name}")"
+  for flags in "${flag_sets[@]}"; do
+    flags="$(echo "${flags}" | xargs)"
+    build_and_run "${name}" "${flags}" || failed=1
+  done
+done
+exit ${failed}
@@ -0,0 +1,71 @@
+/*
+ * split_on_bench.c — splitting an HTTP/1.1 header block
+ *
+ * Splits a 9-line request header block on "\r\n", then each line on
+ * ": ", with l_String_splitOnAux (memmem) and with the upstream
+ * character-at-a-time loop (split_on_ref.h). Reports ns per block.
+ *
+ *   tests/run.sh split_on_bench       (TARGET=wasm for the emcc build)
+ */
+#include <lean/lean.h>
+#include <stdio.h>
+#include <time.h>
+#include "split_on_ref.h"
+
+#define BLOCKS 100000
+
+static const char header_block[] =
+    "Host: example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Language: en-US,en;q=0.5\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Connection: keep-alive\r\n"
+    "Cookie: session=abcdef0123456789; theme=dark\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "Cache-Control: max-age=0\r\n";
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+typedef lean_object *(*split_fn)(lean_object *, lean_object *);
+
+static double ns_per_block(split_fn split, lean_object *block,
+                           lean_object *crlf, lean_object *colon) {
+    double t0 = now();
+    for (int r = 0; r < BLOCKS; r++) {
+        lean_object *lines = split(block, crlf);
+        for (lean_object *c = lines; !lean_is_scalar(c); c = lean_ctor_get(c, 1))
+            lean_dec(split(lean_ctor_get(c, 0), colon));
+        lean_dec(lines);
+    }
+    return (now() - t0) / BLOCKS * 1e9;
+}
+
+int main(void) {
+    lean_object *block = lean_mk_string(header_block);
+    lean_object *crlf = lean_mk_string("\r\n"), *colon = lean_mk_string(": ");
+
+    lean_object *a = split_on_runtime(block, crlf), *b = split_on_upstream(block, crlf);
+    if (!string_list_eq(a, b)) {
+        fprintf(stderr, "FAIL: runtime and upstream split the header block differently\n");
+        return 1;
+    }
+    lean_dec(a);
+    lean_dec(b);
+
+    ns_per_block(split_on_runtime, block, crlf, colon);   /* warm-up */
+    double upstream = ns_per_block(split_on_upstream, block, crlf, colon);
+    double runtime = ns_per_block(split_on_runtime, block, crlf, colon);
+    printf("header block (%zu bytes, 9 lines), %d blocks:\n", sizeof header_block - 1, BLOCKS);
+    printf("  upstream splitOnAux  %8.1f ns/block\n", upstream);
+    printf("  runtime (memmem)     %8.1f ns/block\n", runtime);
+
+    lean_dec(colon);
+    lean_dec(crlf);
+    lean_dec(block);
+    return 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * split_on_ref.h — upstream String.splitOnAux, transliterated to C
+ *
+ * The reference that l_String_splitOnAux (wasm/init_stubs_wasm.c) is
+ * checked and timed against: Init.Data.String's splitOnAux for the
+ * toolchain in lean-toolchain (v4.27.0), written out with the runtime
+ * calls the Lean compiler emits for String.get, String.next,
+ * String.atEnd and String.extract. Tail calls become the loop.
+ *
+ *   splitOnAux s sep b i j r =
+ *     if s.atEnd i then (s.extract b i :: r).reverse
+ *     else if s.get i == sep.get j then
+ *       let i := s.next i; let j := sep.next j
+ *       if sep.atEnd j then splitOnAux s sep i i 0 (s.extract b (i - j) :: r)
+ *       else splitOnAux s sep b i j r
+ *     else splitOnAux s sep b (s.next (i - j)) 0 r
+ *
+ * s and sep are borrowed; the result is a fresh List String.
+ */
+#ifndef SPLIT_ON_REF_H
+#define SPLIT_ON_REF_H
+
+#include <lean/lean.h>
+
+lean_object *l_String_splitOnAux(lean_object *s, lean_object *sep, lean_object *b,
+                                 lean_object *i, lean_object *j, lean_object *r);
+lean_object *l_List_reverse___redArg(lean_object *xs);
+
+static lean_object *list_cons(lean_object *hd, lean_object *tl) {
+    lean_object *c = lean_alloc_ctor(1, 2, 0);
+    lean_ctor_set(c, 0, hd);
+    lean_ctor_set(c, 1, tl);
+    return c;
+}
+
+static lean_object *split_on_upstream(lean_object *s, lean_object *sep) {
+    lean_object *b = lean_box(0), *i = lean_box(0), *j = lean_box(0), *r = lean_box(0);
+    for (;;) {
+        if (lean_string_utf8_at_end(s, i))
+            return l_List_reverse___redArg(list_cons(lean_string_utf8_extract(s, b, i), r));
+        if (lean_string_utf8_get(s, i) == lean_string_utf8_get(sep, j)) {
+            i = lean_string_utf8_next(s, i);
+            j = lean_string_utf8_next(sep, j);
+            if (lean_string_utf8_at_end(sep, j)) {
+                lean_object *stop = lean_nat_sub(i, j);
+                r = list_cons(lean_string_utf8_extract(s, b, stop), r);
+                b = i;
+                j = lean_box(0);
+            }
+        } else {
+            lean_object *back = lean_nat_sub(i, j);
+            i = lean_string_utf8_next(s, back);
+            j = lean_box(0);
+        }
+    }
+}
+
+/* What String.splitOn compiles to for a non-empty separator */
+static lean_object *split_on_runtime(lean_object *s, lean_object *sep) {
+    return l_String_splitOnAux(s, sep, lean_box(0), lean_box(0), lean_box(0), lean_box(0));
+}
+
+static int string_list_eq(lean_object *a, lean_object *b) {
+    while (!lean_is_scalar(a) && !lean_is_scalar(b)) {
+        if (!lean_string_eq(lean_ctor_get(a, 0), lean_ctor_get(b, 0))) return 0;
+        a = lean_ctor_get(a, 1);
+        b = lean_ctor_get(b, 1);
+    }
+    return lean_is_scalar(a) && lean_is_scalar(b);
+}
+
+#endif
@@ -0,0 +1,55 @@
+/*
+ * split_on_test.c — l_String_splitOnAux against upstream splitOnAux
+ *
+ * The runtime version searches with memmem from i - j; upstream walks s
+ * a character at a time (split_on_ref.h). Both must give the same list
+ * for fixed cases (partial and overlapping matches, separators at either
+ * end, multi-byte characters) and for 20000 random strings over a small
+ * alphabet that makes partial matches common.
+ */
+#include <lean/lean.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "split_on_ref.h"
+
+#define RANDOM_CASES 20000
+
+static int failures = 0;
+
+static void check(const char *s_str, const char *sep_str) {
+    lean_object *s = lean_mk_string(s_str), *sep = lean_mk_string(sep_str);
+    lean_object *want = split_on_upstream(s, sep);
+    lean_object *got = split_on_runtime(s, sep);
+    if (!string_list_eq(got, want) && failures++ < 10)
+        fprintf(stderr, "FAIL: \"%s\".splitOn \"%s\" differs from upstream\n", s_str, sep_str);
+    lean_dec(got);
+    lean_dec(want);
+    lean_dec(sep);
+    lean_dec(s);
+}
+
+int main(void) {
+    static const char *fixed[][2] = {
+        { "", "," }, { ",", "," }, { "a,b,,c,", "," }, { "ababcab", "abc" },
+        { "aaab", "aab" }, { "aaaa", "aa" }, { "abab", "aba" }, { "a", "ab" },
+        { "Host: x\r\nAccept: */*\r\n", "\r\n" }, { "k: v: w", ": " },
+        { "h\xc3\xa9llo w\xc3\xa9rld", "\xc3\xa9" }, { "\xe2\x82\xac\xe2\x82\xac", "\xe2\x82\xac" },
+    };
+    for (size_t k = 0; k < sizeof fixed / sizeof *fixed; k++)
+        check(fixed[k][0], fixed[k][1]);
+
+    static const char *alphabet[] = { "a", "b", ",", " ", "\xc3\xa9", "\xe2\x82\xac", "ab" };
+    srand(7);
+    for (int it = 0; it < RANDOM_CASES; it++) {
+        char s[200] = "", sep[20] = "";
+        int n = rand() % 20, m = 1 + rand() % 3;
+        for (int k = 0; k < n; k++) strcat(s, alphabet[rand() % 7]);
+        for (int k = 0; k < m; k++) strcat(sep, alphabet[rand() % 7]);
+        check(s, sep);
+    }
+
+    if (failures) return 1;
+    puts("split_on_test: ok");
+    return 0;
+}
@@ -0,0 +1,273 @@
+/*
+ * task_test.c — Task and IO task primitives
+ *
+ * tests/run.sh builds it without threads, where a spawned task runs
+ * before lean_task_spawn_core returns, and with -pthread
+ * -DLEAN_WASM_THREADS, where tasks run on the work-stealing pool and
+ * everything they hold is marked multi-threaded. Checks:
+ *   - spawn/get, map, bind and chains of them;
+ *   - fib(27) through nested spawns, each task waiting on its children;
+ *   - IO.asTask and IO.mapTask results (Except.ok);
+ *   - IO.waitAny returns a finished task of the list;
+ *   - IO.cancel is seen by IO.checkCanceled inside the task (threads);
+ *   - a 10000-cell list shared by 8 tasks is released: afterwards each
+ *     payload is held only by the reference the test kept.
+ * CFLAGS=-fsanitize=address checks that nothing leaks. -fsanitize=thread
+ * only reports lean.h's plain reads of m_rc on the inline fast paths,
+ * which are benign: a multi-threaded count never changes sign.
+ */
+#include <lean/lean.h>
+#include <stdio.h>
+#include <time.h>
+
+LEAN_EXPORT void lean_io_cancel_core(b_lean_obj_arg t);
+LEAN_EXPORT bool lean_io_check_canceled_core(void);
+LEAN_EXPORT uint8_t lean_io_get_task_state_core(b_lean_obj_arg t);
+LEAN_EXPORT b_lean_obj_res lean_io_wait_any_core(b_lean_obj_arg task_list);
+LEAN_EXPORT lean_obj_res lean_io_map_task(lean_obj_arg f, lean_obj_arg t, lean_obj_arg prio,
+                                          uint8_t sync);
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do {                                   \
+        if (!(cond)) {                                          \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                       \
+            fputc('\n', stderr);                                \
+            failures++;                                         \
+        }                                                       \
+    } while (0)
+
+static lean_object *spawn(lean_object *c) {
+    return lean_task_spawn_core(c, 0, false);
+}
+
+/* Closure of fn with one fixed argument x */
+static lean_object *closure1(void *fn, unsigned arity, lean_object *x) {
+    lean_object *c = lean_alloc_closure(fn, arity, 1);
+    lean_closure_set(c, 0, x);
+    return c;
+}
+
+/* ── spawn / map / bind ───────────────────────────────────────── */
+
+static lean_object *const_fn(lean_object *x, lean_object *unit) {
+    (void)unit;
+    return x;
+}
+
+static lean_object *succ_fn(lean_object *x) {
+    return lean_box(lean_unbox(x) + 1);
+}
+
+/* x ↦ Task.spawn (fun _ => 2 * x) */
+static lean_object *double_task_fn(lean_object *x) {
+    return spawn(closure1((void *)const_fn, 2, lean_box(2 * lean_unbox(x))));
+}
+
+/* ── fib through nested spawns ────────────────────────────────── */
+
+static size_t fib_seq(size_t n) {
+    return n < 2 ? n : fib_seq(n - 1) + fib_seq(n - 2);
+}
+
+static lean_object *fib_fn(lean_object *n_obj, lean_object *unit) {
+    (void)unit;
+    size_t n = lean_unbox(n_obj);
+    if (n < 16) return lean_box(fib_seq(n));
+    lean_object *a = spawn(closure1((void *)fib_fn, 2, lean_box(n - 1)));
+    lean_object *b = spawn(closure1((void *)fib_fn, 2, lean_box(n - 2)));
+    size_t r = lean_unbox(lean_task_get(a)) + lean_unbox(lean_task_get(b));
+    lean_dec(a);
+    lean_dec(b);
+    return lean_box(r);
+}
+
+/* ── Shared list ──────────────────────────────────────────────── */
+
+/* Sum of the payloads of a List of one-field ctors holding a boxed Nat */
+static size_t list_sum(b_lean_obj_arg l) {
+    size_t s = 0;
+    for (; !lean_is_scalar(l); l = lean_ctor_get(l, 1))
+        s += lean_unbox(lean_ctor_get(lean_ctor_get(l, 0), 0));
+    return s;
+}
+
+static lean_object *sum_fn(lean_object *l, lean_object *unit) {
+    (void)unit;
+    size_t s = list_sum(l);
+    lean_dec(l);
+    return lean_box(s);
+}
+
+/* IO action: fun w => pure (sum l) */
+static lean_object *io_sum_fn(lean_object *l, lean_object *world) {
+    (void)world;
+    size_t s = list_sum(l);
+    lean_dec(l);
+    return lean_io_result_mk_ok(lean_box(s));
+}
+
+/* IO.mapTask f: fun x w => pure (x + 1), where x is Except IO.Error Nat */
+static lean_object *io_succ_fn(lean_object *e, lean_object *world) {
+    (void)world;
+    size_t v = lean_unbox(lean_ctor_get(e, 0));
+    lean_dec(e);
+    return lean_io_result_mk_ok(lean_box(v + 1));
+}
+
+/* ── Cancellation ─────────────────────────────────────────────── */
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* Spin until canceled or until `secs` pass; true if canceled */
+static lean_object *wait_cancel_fn(lean_object *secs, lean_object *unit) {
+    (void)unit;
+    double end = now() + (double)lean_unbox(secs);
+    while (now() < end)
+        if (lean_io_check_canceled_core()) return lean_box(1);
+    return lean_box(0);
+}
+
+static lean_object *check_canceled_fn(lean_object *unit) {
+    (void)unit;
+    return lean_box(lean_io_check_canceled_core());
+}
+
+static lean_object *sleep_fn(lean_object *ms, lean_object *unit) {
+    (void)unit;
+    double end = now() + lean_unbox(ms) / 1000.0;
+    while (now() < end) {}
+    return ms;
+}
+
+static lean_object *cons(lean_object *h, lean_object *t) {
+    lean_object *c = lean_alloc_ctor(1, 2, 0);
+    lean_ctor_set(c, 0, h);
+    lean_ctor_set(c, 1, t);
+    return c;
+}
+
+int main(void) {
+    /* spawn / get / map / bind */
+    lean_object *t = spawn(closure1((void *)const_fn, 2, lean_box(20)));
+    CHECK(lean_unbox(lean_task_get(t)) == 20, "spawn: %zu", lean_unbox(lean_task_get(t)));
+    lean_inc(t);
+    lean_object *m = lean_task_map_core(lean_alloc_closure((void *)succ_fn, 1, 0), t, 0, false, false);
+    CHECK(lean_unbox(lean_task_get(m)) == 21, "map: %zu", lean_unbox(lean_task_get(m)));
+    lean_object *b = lean_task_bind_core(t, lean_alloc_closure((void *)double_task_fn, 1, 0), 0, false, false);
+    CHECK(lean_unbox(lean_task_get(b)) == 40, "bind: %zu", lean_unbox(lean_task_get(b)));
+    CHECK(lean_io_get_task_state_core(b) == 2, "bind: state %u after get", lean_io_get_task_state_core(b));
+    lean_dec(m);
+    lean_dec(b);
+
+    lean_object *chain = lean_task_pure(lean_box(0));
+    for (int i = 0; i < 1000; i++)
+        chain = lean_task_map_core(lean_alloc_closure((void *)succ_fn, 1, 0), chain, 0, false, false);
+    CHECK(lean_unbox(lean_task_get(chain)) == 1000, "map chain: %zu", lean_unbox(lean_task_get(chain)));
+    lean_dec(chain);
+
+    /* Nested spawns */
+    t = spawn(closure1((void *)fib_fn, 2, lean_box(27)));
+    CHECK(lean_unbox(lean_task_get(t)) == 196418, "fib(27): %zu", lean_unbox(lean_task_get(t)));
+    lean_dec(t);
+
+    /* A shared list: 8 tasks and IO.asTask / IO.mapTask read it */
+    enum { CELLS = 10000, READERS = 8 };
+    static lean_object *payload[CELLS];
+    lean_object *list = lean_box(0);
+    size_t want = 0;
+    for (size_t i = 0; i < CELLS; i++) {
+        payload[i] = lean_alloc_ctor(0, 1, 0);
+        lean_ctor_set(payload[i], 0, lean_box(i));
+        lean_inc(payload[i]);               /* kept by the test */
+        list = cons(payload[i], list);
+        want += i;
+    }
+    lean_object *readers[READERS];
+    for (int k = 0; k < READERS; k++) {
+        lean_inc(list);
+        readers[k] = spawn(closure1((void *)sum_fn, 2, list));
+    }
+    lean_inc(list);
+    lean_object *r = lean_io_as_task(closure1((void *)io_sum_fn, 2, list), lean_box(0));
+    lean_object *io_t = lean_io_result_get_value(r);
+    lean_inc(io_t);
+    lean_dec(r);
+    lean_inc(io_t);
+    r = lean_io_map_task(lean_alloc_closure((void *)io_succ_fn, 2, 0), io_t, lean_box(0), 0);
+    lean_object *io_m = lean_io_result_get_value(r);
+    lean_inc(io_m);
+    lean_dec(r);
+
+    for (int k = 0; k < READERS; k++) {
+        CHECK(lean_unbox(lean_task_get(readers[k])) == want, "reader %d: %zu", k,
+              lean_unbox(lean_task_get(readers[k])));
+        lean_dec(readers[k]);
+    }
+    lean_object *e = lean_task_get(io_t);
+    CHECK(lean_ptr_tag(e) == 1 && lean_unbox(lean_ctor_get(e, 0)) == want, "IO.asTask: tag %u",
+          lean_ptr_tag(e));
+    e = lean_task_get(io_m);
+    CHECK(lean_ptr_tag(e) == 1 && lean_unbox(lean_ctor_get(e, 0)) == want + 1, "IO.mapTask: tag %u",
+          lean_ptr_tag(e));
+    lean_dec(io_t);
+    lean_dec(io_m);
+    lean_dec(list);
+
+    /* Only the test's reference to each payload is left: 1, or -1 once
+       marked multi-threaded */
+    size_t bad = 0;
+    for (size_t i = 0; i < CELLS; i++) {
+        if (payload[i]->m_rc != 1 && payload[i]->m_rc != -1) bad++;
+        lean_dec(payload[i]);
+    }
+    CHECK(bad == 0, "%zu payloads still referenced from the list", bad);
+
+    /* IO.waitAny: already finished, then racing */
+    lean_object *done = lean_task_pure(lean_box(7));
+    lean_inc(done);
+    lean_object *l = cons(done, cons(spawn(closure1((void *)sleep_fn, 2, lean_box(300))), lean_box(0)));
+    lean_object *w = lean_io_wait_any_core(l);
+    CHECK(w == done, "waitAny: not the finished task");
+    lean_dec(l);
+    lean_dec(done);
+
+    l = lean_box(0);
+    for (size_t ms = 5; ms <= 50; ms += 15)
+        l = cons(spawn(closure1((void *)sleep_fn, 2, lean_box(ms))), l);
+    w = lean_io_wait_any_core(l);
+    int member = 0;
+    for (lean_object *p = l; !lean_is_scalar(p); p = lean_ctor_get(p, 1))
+        member |= lean_ctor_get(p, 0) == w;
+    CHECK(member && lean_io_get_task_state_core(w) == 2, "waitAny: member %d, state %u", member,
+          lean_io_get_task_state_core(w));
+    size_t v = lean_unbox(lean_task_get(w));
+    CHECK(v >= 5 && v <= 50, "waitAny: value %zu", v);
+    lean_dec(l);
+
+    /* IO.cancel / IO.checkCanceled. Without threads the task has already
+       finished when it is canceled. */
+#ifdef LEAN_WASM_THREADS
+    t = spawn(closure1((void *)wait_cancel_fn, 2, lean_box(10)));
+    lean_io_cancel_core(t);
+    CHECK(lean_unbox(lean_task_get(t)) == 1, "canceled task did not see IO.checkCanceled");
+#else
+    t = spawn(closure1((void *)wait_cancel_fn, 2, lean_box(0)));
+    lean_io_cancel_core(t);
+    CHECK(lean_unbox(lean_task_get(t)) == 0, "IO.cancel changed a finished task");
+#endif
+    lean_dec(t);
+    t = spawn(lean_alloc_closure((void *)check_canceled_fn, 1, 0));
+    CHECK(lean_unbox(lean_task_get(t)) == 0, "task that was not canceled saw IO.checkCanceled");
+    lean_dec(t);
+    CHECK(!lean_io_check_canceled_core(), "IO.checkCanceled outside a task");
+
+    if (failures) return 1;
+    puts("task_test: ok");
+    return 0;
+}
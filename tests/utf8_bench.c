@@ -0,0 +1,63 @@
+/*
+ * utf8_bench.c — UTF-8 scanning of header-sized strings
+ *
+ * Times lean_mk_string_from_bytes (validate + count + copy) and
+ * lean_utf8_n_strlen on typical HTTP header names and values, next to
+ * the byte-at-a-time decoder in utf8_ref.h. tests/run.sh builds it once
+ * per scanner (SSE2 / word natively, word / SSE2 with -m32, scalar /
+ * simd128 with TARGET=wasm).
+ */
+#include <lean/lean.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "utf8_ref.h"
+
+LEAN_EXPORT size_t lean_utf8_n_strlen(const char *str, size_t n);
+
+#define ITERS 2000000
+
+static const char *const samples[] = {
+    "content-type",
+    "text/html; charset=utf-8",
+    "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36",
+    "session=0123456789abcdef0123456789abcdef; theme=dark; lang=pt-PT",
+    "attachment; filename=\"relat\xc3\xb3rio-an\xc3\xba" "al-2024.pdf\"",
+};
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int main(void) {
+    printf("bytes  mk_string_from_bytes  utf8_n_strlen  reference scan   (ns/string)\n");
+    for (size_t k = 0; k < sizeof samples / sizeof *samples; k++) {
+        const char *p = samples[k];
+        size_t n = strlen(p);
+        volatile size_t sink = 0;
+
+        double t0 = now();
+        for (size_t i = 0; i < ITERS; i++) {
+            lean_object *s = lean_mk_string_from_bytes(p, n);
+            sink += lean_string_len(s);
+            lean_dec(s);
+        }
+        double t1 = now();
+        for (size_t i = 0; i < ITERS; i++) {
+            sink += lean_utf8_n_strlen(p, n);
+            __asm__ volatile("" ::: "memory");
+        }
+        double t2 = now();
+        for (size_t i = 0; i < ITERS; i++) {
+            size_t len;
+            sink += ref_scan((const uint8_t *)p, n, &len) ? len : 0;
+            __asm__ volatile("" ::: "memory");
+        }
+        double t3 = now();
+        printf("%5zu %21.1f %14.1f %15.1f\n", n,
+               (t1 - t0) / ITERS * 1e9, (t2 - t1) / ITERS * 1e9, (t3 - t2) / ITERS * 1e9);
+    }
+    return 0;
+}
@@ -0,0 +1,73 @@
+/*
+ * utf8_ref.h — byte-at-a-time UTF-8 reference for the scanner harnesses
+ *
+ * Decodes one code point at a time and checks it against the
+ * well-formed byte sequences of Unicode Table 3-7, independently of the
+ * runtime's utf8_decode_len. Invalid input maps each byte that does not
+ * start a well-formed sequence to U+FFFD, as lean_mk_string_from_bytes
+ * does.
+ */
+#ifndef UTF8_REF_H
+#define UTF8_REF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Bytes of the well-formed sequence at p, or 0 */
+static size_t ref_seq_len(const uint8_t *p, size_t avail) {
+    static const struct { uint8_t lo0, hi0, lo1, hi1; uint8_t n; } rows[] = {
+        { 0x00, 0x7F, 0,    0,    1 },
+        { 0xC2, 0xDF, 0x80, 0xBF, 2 },
+        { 0xE0, 0xE0, 0xA0, 0xBF, 3 },
+        { 0xE1, 0xEC, 0x80, 0xBF, 3 },
+        { 0xED, 0xED, 0x80, 0x9F, 3 },
+        { 0xEE, 0xEF, 0x80, 0xBF, 3 },
+        { 0xF0, 0xF0, 0x90, 0xBF, 4 },
+        { 0xF1, 0xF3, 0x80, 0xBF, 4 },
+        { 0xF4, 0xF4, 0x80, 0x8F, 4 },
+    };
+    for (size_t r = 0; r < sizeof rows / sizeof *rows; r++) {
+        if (p[0] < rows[r].lo0 || p[0] > rows[r].hi0) continue;
+        size_t n = rows[r].n;
+        if (n == 1) return 1;
+        if (avail < n || p[1] < rows[r].lo1 || p[1] > rows[r].hi1) return 0;
+        for (size_t k = 2; k < n; k++)
+            if (p[k] < 0x80 || p[k] > 0xBF) return 0;
+        return n;
+    }
+    return 0;
+}
+
+/* Validity and code point count of n bytes */
+static int ref_scan(const uint8_t *p, size_t n, size_t *len) {
+    size_t cps = 0;
+    for (size_t i = 0; i < n; cps++) {
+        size_t k = ref_seq_len(p + i, n - i);
+        if (k == 0) return 0;
+        i += k;
+    }
+    *len = cps;
+    return 1;
+}
+
+/* Lossy decoding into out (room for 3 * n bytes); returns its size */
+static size_t ref_lossy(const uint8_t *p, size_t n, uint8_t *out, size_t *len) {
+    size_t o = 0, cps = 0;
+    for (size_t i = 0; i < n; cps++) {
+        size_t k = ref_seq_len(p + i, n - i);
+        if (k) {
+            memcpy(out + o, p + i, k);
+            o += k;
+            i += k;
+        } else {
+            memcpy(out + o, "\xEF\xBF\xBD", 3);
+            o += 3;
+            i++;
+        }
+    }
+    *len = cps;
+    return o;
+}
+
+#endif
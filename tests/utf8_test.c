@@ -0,0 +1,114 @@
+/*
+ * utf8_test.c — vector UTF-8 scanners against a byte-at-a-time decoder
+ *
+ * lean_string_validate_utf8, lean_mk_string_from_bytes and
+ * lean_utf8_n_strlen look at UTF8_BLOCK bytes per step: wasm simd128,
+ * SSE2 or a 64-bit word, depending on the build. Each must agree with
+ * utf8_ref.h on validity, code point count and the lossy U+FFFD output,
+ * for fixed edge cases (overlong forms, surrogates, past U+10FFFF,
+ * truncated sequences) and for random inputs of every length up to 100,
+ * placed at each offset so multi-byte characters straddle block
+ * boundaries. tests/run.sh builds it once per scanner the target has.
+ */
+#include <lean/lean.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utf8_ref.h"
+
+LEAN_EXPORT uint8_t lean_string_validate_utf8(b_lean_obj_arg a);
+LEAN_EXPORT size_t lean_utf8_n_strlen(const char *str, size_t n);
+
+#define MAX_LEN      100
+#define RANDOM_CASES 200
+
+static int failures = 0;
+
+static void fail(const char *what, const uint8_t *p, size_t n) {
+    if (failures++ >= 10) return;
+    fprintf(stderr, "FAIL %s:", what);
+    for (size_t i = 0; i < n; i++) fprintf(stderr, " %02x", p[i]);
+    fputc('\n', stderr);
+}
+
+static void check(const uint8_t *p, size_t n) {
+    size_t ref_len;
+    int valid = ref_scan(p, n, &ref_len);
+
+    lean_object *ba = lean_alloc_sarray(1, n, n);
+    memcpy(lean_sarray_cptr(ba), p, n);
+    if (lean_string_validate_utf8(ba) != valid) fail("validate_utf8", p, n);
+    lean_dec(ba);
+
+    if (valid && lean_utf8_n_strlen((const char *)p, n) != ref_len) fail("utf8_n_strlen", p, n);
+
+    static uint8_t want[3 * MAX_LEN + 64];
+    size_t want_len, want_size = ref_lossy(p, n, want, &want_len);
+    lean_object *s = lean_mk_string_from_bytes((const char *)p, n);
+    if (lean_string_size(s) != want_size + 1 || lean_string_len(s) != want_len ||
+        memcmp(lean_string_cstr(s), want, want_size) != 0)
+        fail("mk_string_from_bytes", p, n);
+    lean_dec(s);
+}
+
+/* Pieces random inputs are made of; the invalid ones are single bytes
+   or cut-off sequences. */
+static const char *const pieces[] = {
+    "a", "Z", " ", "~", "\x7f",
+    "\xc3\xa9", "\xc2\x80", "\xdf\xbf",                      /* 2 bytes */
+    "\xe2\x82\xac", "\xe0\xa0\x80", "\xed\x9f\xbf", "\xef\xbf\xbf",  /* 3 bytes */
+    "\xf0\x9f\x98\x80", "\xf0\x90\x80\x80", "\xf4\x8f\xbf\xbf",      /* 4 bytes */
+    "\x80", "\xbf", "\xc0", "\xc1", "\xf5", "\xff",           /* never valid */
+    "\xc3", "\xe2\x82", "\xf0\x9f\x98",                      /* truncated */
+    "\xe0\x80", "\xed\xa0", "\xf0\x80", "\xf4\x90",           /* bad second byte */
+};
+
+int main(void) {
+    static const char *const fixed[] = {
+        "", "ascii only, longer than one block of sixteen bytes",
+        "\xc0\x80", "\xc1\xbf", "\xe0\x80\x80", "\xe0\x9f\xbf", "\xed\xa0\x80",
+        "\xed\xbf\xbf", "\xf0\x80\x80\x80", "\xf0\x8f\xbf\xbf", "\xf4\x90\x80\x80",
+        "\xf5\x80\x80\x80", "\xc3", "\xe2\x82", "\xf0\x9f\x98", "\x80\x80\x80",
+        "0123456789abcde\xc3\xa9", "0123456789abcdef\xc3\xa9", "0123456\xe2\x82\xac",
+        "content-type: text/html; charset=utf-8",
+    };
+    for (size_t k = 0; k < sizeof fixed / sizeof *fixed; k++)
+        check((const uint8_t *)fixed[k], strlen(fixed[k]));
+
+    /* Strings with an embedded NUL are valid UTF-8 too */
+    check((const uint8_t *)"ab\0cd\xc3\xa9", 7);
+
+    static uint8_t buf[MAX_LEN + 8];
+    srand(15);
+    for (size_t n = 0; n <= MAX_LEN; n++) {
+        for (int c = 0; c < RANDOM_CASES; c++) {
+            /* Mostly ASCII, as headers are; every fourth case mostly multi-byte */
+            int ascii_pct = c % 4 == 3 ? 20 : 90;
+            size_t len = 0;
+            while (len < n) {
+                const char *pc = rand() % 100 < ascii_pct
+                    ? pieces[rand() % 5]
+                    : pieces[5 + rand() % (sizeof pieces / sizeof *pieces - 5)];
+                size_t k = strlen(pc);
+                if (len + k > n) k = n - len;
+                memcpy(buf + len, pc, k);
+                len += k;
+            }
+            check(buf, n);
+        }
+        /* All-valid input, shifted across a block boundary */
+        for (size_t off = 0; off < 8 && n + off <= MAX_LEN; off++) {
+            memset(buf, 'x', off);
+            size_t len = off;
+            while (len + 4 <= n + off) {
+                memcpy(buf + len, "\xf0\x9f\x98\x80", 4);
+                len += 4;
+            }
+            check(buf, len);
+        }
+    }
+
+    if (failures) return 1;
+    puts("utf8_test: ok");
+    return 0;
+}
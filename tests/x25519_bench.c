@@ -0,0 +1,204 @@
+/*
+ * x25519_bench.c — X25519 over the runtime's Nat arithmetic
+ *
+ * A Montgomery ladder (RFC 7748, section 5) on Lean Nats, written the way
+ * compiled Lean code uses them: every field operation is lean_nat_* on
+ * boxed operands followed by a reduction mod p, so each step allocates
+ * and frees a few mpz objects. lean_wasm_free_drain() runs after every
+ * call, as call_end() does in wasm_glue.c. The two workloads match the
+ * X25519 rows of dist/bench.html; the RFC 7748 test vectors are checked
+ * first.
+ *
+ *   tests/run.sh x25519_bench   (TARGET=wasm for the emcc build)
+ */
+#include <lean/lean.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "lean_runtime_wasm.h"
+
+#define CALLS  50
+#define ROUNDS 5
+
+static lean_object *P;      /* 2^255 - 19 */
+static lean_object *A24;    /* (486662 - 2) / 4 */
+
+static lean_object *fadd(b_lean_obj_arg a, b_lean_obj_arg b) {
+    lean_object *t = lean_nat_add(a, b);
+    lean_object *r = lean_nat_mod(t, P);
+    lean_dec(t);
+    return r;
+}
+
+/* (a + p - b) % p, since Nat subtraction truncates */
+static lean_object *fsub(b_lean_obj_arg a, b_lean_obj_arg b) {
+    lean_object *t = lean_nat_add(a, P);
+    lean_object *u = lean_nat_sub(t, b);
+    lean_object *r = lean_nat_mod(u, P);
+    lean_dec(t);
+    lean_dec(u);
+    return r;
+}
+
+static lean_object *fmul(b_lean_obj_arg a, b_lean_obj_arg b) {
+    lean_object *t = lean_nat_mul(a, b);
+    lean_object *r = lean_nat_mod(t, P);
+    lean_dec(t);
+    return r;
+}
+
+/* z^(p-2); p - 2 = 2^255 - 21 has every bit from 254 down to 5 set,
+   then 01011 */
+static lean_object *finv(b_lean_obj_arg z) {
+    lean_object *r = lean_box(1);
+    for (int t = 254; t >= 0; t--) {
+        lean_object *s = fmul(r, r);
+        lean_dec(r);
+        r = s;
+        if (t >= 5 || ((0x0B >> t) & 1)) {
+            s = fmul(r, z);
+            lean_dec(r);
+            r = s;
+        }
+    }
+    return r;
+}
+
+static lean_object *nat_of_le_bytes(const uint8_t b[32]) {
+    lean_object *n = lean_box(0);
+    for (int i = 31; i >= 0; i--) {
+        lean_object *t = lean_nat_mul(n, lean_box(256));
+        lean_dec(n);
+        n = lean_nat_add(t, lean_box(b[i]));
+        lean_dec(t);
+    }
+    return n;
+}
+
+static void le_bytes_of_nat(lean_obj_arg n, uint8_t out[32]) {
+    for (int i = 0; i < 32; i++) {
+        lean_object *q = lean_nat_div(n, lean_box(256));
+        lean_object *r = lean_nat_mod(n, lean_box(256));
+        out[i] = (uint8_t)lean_unbox(r);
+        lean_dec(n);
+        n = q;
+    }
+    lean_dec(n);
+}
+
+static void x25519(uint8_t out[32], const uint8_t scalar[32], const uint8_t point[32]) {
+    uint8_t k[32], u[32];
+    memcpy(k, scalar, 32);
+    k[0] &= 248;
+    k[31] = (k[31] & 127) | 64;
+    memcpy(u, point, 32);
+    u[31] &= 127;
+
+    lean_object *x1 = nat_of_le_bytes(u);
+    lean_object *x2 = lean_box(1), *z2 = lean_box(0);
+    lean_object *x3 = x1, *z3 = lean_box(1), *tmp;
+    lean_inc(x3);
+    int swap = 0;
+    for (int t = 254; t >= 0; t--) {
+        int kt = (k[t >> 3] >> (t & 7)) & 1;
+        if (swap ^ kt) {
+            tmp = x2; x2 = x3; x3 = tmp;
+            tmp = z2; z2 = z3; z3 = tmp;
+        }
+        swap = kt;
+
+        lean_object *a  = fadd(x2, z2);
+        lean_object *aa = fmul(a, a);
+        lean_object *b  = fsub(x2, z2);
+        lean_object *bb = fmul(b, b);
+        lean_object *e  = fsub(aa, bb);
+        lean_object *c  = fadd(x3, z3);
+        lean_object *d  = fsub(x3, z3);
+        lean_object *da = fmul(d, a);
+        lean_object *cb = fmul(c, b);
+        lean_dec(x2); lean_dec(z2); lean_dec(x3); lean_dec(z3);
+        lean_dec(a); lean_dec(b); lean_dec(c); lean_dec(d);
+
+        lean_object *s = fadd(da, cb);
+        x3 = fmul(s, s);
+        lean_dec(s);
+        s = fsub(da, cb);
+        tmp = fmul(s, s);
+        z3 = fmul(x1, tmp);
+        lean_dec(s); lean_dec(tmp);
+        lean_dec(da); lean_dec(cb);
+
+        x2 = fmul(aa, bb);
+        s = fmul(A24, e);
+        tmp = fadd(aa, s);
+        z2 = fmul(e, tmp);
+        lean_dec(s); lean_dec(tmp);
+        lean_dec(aa); lean_dec(bb); lean_dec(e);
+    }
+    if (swap) {
+        tmp = x2; x2 = x3; x3 = tmp;
+        tmp = z2; z2 = z3; z3 = tmp;
+    }
+    lean_object *zi = finv(z2);
+    le_bytes_of_nat(fmul(x2, zi), out);
+    lean_dec(zi);
+    lean_dec(x1); lean_dec(x2); lean_dec(z2); lean_dec(x3); lean_dec(z3);
+    lean_wasm_free_drain();
+}
+
+static void hex(uint8_t out[32], const char *s) {
+    for (int i = 0; i < 32; i++) sscanf(s + 2 * i, "%2hhx", &out[i]);
+}
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int main(void) {
+    lean_object *two255 = lean_nat_pow(lean_box(2), lean_box(255));
+    P = lean_nat_sub(two255, lean_box(19));
+    lean_dec(two255);
+    A24 = lean_box(121665);
+
+    /* RFC 7748, 5.2 and 6.1 */
+    static const char *const vectors[][3] = {
+        { "a546e36bf0527c9d3b16154b82465edd62144c0ac1fc5a18506a2244ba449ac4",
+          "e6db6867583030db3594c1a424b15f7c726624ec26b3353b10a903a6d0ab1c4c",
+          "c3da55379de9c6908e94ea4df28d084f32eccf03491c71f754b4075577a28552" },
+        { "77076d0a7318a57d3c16c17251b26645df4c2f87ebc0992ab177fba51db92c2a",
+          "0900000000000000000000000000000000000000000000000000000000000000",
+          "8520f0098930a754748b7ddcb43ef75a0dbf3a0d26381af4eba4a98eaa9b4e6a" },
+    };
+    uint8_t k[32], u[32], want[32], got[32];
+    for (size_t v = 0; v < sizeof vectors / sizeof *vectors; v++) {
+        hex(k, vectors[v][0]);
+        hex(u, vectors[v][1]);
+        hex(want, vectors[v][2]);
+        x25519(got, k, u);
+        if (memcmp(got, want, 32) != 0) {
+            fprintf(stderr, "FAIL RFC 7748 vector %zu\n", v + 1);
+            return 1;
+        }
+    }
+
+    /* Fixed scalar and peer point, as in dist/bench.html */
+    uint8_t scalar[32], base[32] = { 9 }, point[32];
+    for (int i = 0; i < 32; i++) scalar[i] = (uint8_t)(i * 7 + 1);
+    x25519(point, scalar, base);
+
+    double best_base = 1e9, best_shared = 1e9;
+    for (int r = 0; r < ROUNDS; r++) {
+        double t0 = now();
+        for (int i = 0; i < CALLS; i++) x25519(got, scalar, base);
+        double t1 = now();
+        for (int i = 0; i < CALLS; i++) x25519(got, scalar, point);
+        double t2 = now();
+        if (t1 - t0 < best_base) best_base = t1 - t0;
+        if (t2 - t1 < best_shared) best_shared = t2 - t1;
+    }
+    printf("X25519 base x%d     %7.2f ms\n", CALLS, best_base * 1e3);
+    printf("X25519 shared x%d   %7.2f ms\n", CALLS, best_shared * 1e3);
+    return 0;
+}
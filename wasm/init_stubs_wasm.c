@@ -23,7 +23,9 @@
  *  14. Range / Misc
  */
 
+#define _GNU_SOURCE /* memmem */
 #include <lean/lean.h>
+#include "lean_runtime_wasm.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -214,15 +216,131 @@ LEAN_EXPORT lean_object* l_Array_findIdx_x3f_loop___redArg(lean_object *p, lean_
     return lean_box(0); /* none */
 }
 
-/* Array.qpartition (quicksort partition) */
-LEAN_EXPORT lean_object* l_Array_qpartition___redArg(lean_object *lt, lean_object *a, lean_object *lo_obj, lean_object *hi_obj) {
-    /* Simplified: just return (a, lo) — partition not meaningful without full qsort */
-    (void)lt;
-    lean_object *r = lean_alloc_ctor(0, 2, 0);
-    lean_ctor_set(r, 0, a);
-    lean_ctor_set(r, 1, lo_obj);
-    lean_dec(hi_obj);
+/* Nat.decLt, Nat.blt, UInt8.decLt, UInt16.decLt (boxed).
+   A closure over one of these is "<" on boxed scalars; see sort_lt. */
+LEAN_EXPORT lean_object* l_Nat_decLt___boxed(lean_object *a, lean_object *b) {
+    uint8_t r = lean_nat_dec_lt(a, b);
+    lean_dec(a); lean_dec(b);
+    return lean_box(r);
+}
+
+LEAN_EXPORT lean_object* l_Nat_blt___boxed(lean_object *a, lean_object *b) {
+    uint8_t r = lean_nat_dec_lt(a, b);
+    lean_dec(a); lean_dec(b);
+    return lean_box(r);
+}
+
+LEAN_EXPORT lean_object* l_UInt8_decLt___boxed(lean_object *a, lean_object *b) {
+    return lean_box(lean_unbox(a) < lean_unbox(b));
+}
+
+LEAN_EXPORT lean_object* l_UInt16_decLt___boxed(lean_object *a, lean_object *b) {
+    return lean_box(lean_unbox(a) < lean_unbox(b));
+}
+
+/* lt == NULL means every element is a boxed scalar and the comparator is
+   one of the "<" above. lean_box is monotone, so comparing the boxed
+   words orders the values without calling the closure. */
+static inline int sort_lt(lean_object *lt, lean_object *x, lean_object *y) {
+    if (!lt) return (size_t)x < (size_t)y;
+    lean_inc(lt); lean_inc(x); lean_inc(y);
+    return lean_unbox(lean_apply_2(lt, x, y));
+}
+
+static inline void sort_swap(lean_object **v, size_t i, size_t j) {
+    lean_object *t = v[i]; v[i] = v[j]; v[j] = t;
+}
+
+static void sort_insertion(lean_object *lt, lean_object **v, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        lean_object *x = v[i];
+        size_t j = i;
+        while (j > 0 && sort_lt(lt, x, v[j - 1])) { v[j] = v[j - 1]; j--; }
+        v[j] = x;
+    }
+}
+
+static void sort_sift_down(lean_object *lt, lean_object **v, size_t i, size_t n) {
+    lean_object *x = v[i];
+    for (;;) {
+        size_t c = 2 * i + 1;
+        if (c >= n) break;
+        if (c + 1 < n && sort_lt(lt, v[c], v[c + 1])) c++;
+        if (!sort_lt(lt, x, v[c])) break;
+        v[i] = v[c];
+        i = c;
+    }
+    v[i] = x;
+}
+
+static void sort_heap(lean_object *lt, lean_object **v, size_t n) {
+    for (size_t i = n / 2; i-- > 0;) sort_sift_down(lt, v, i, n);
+    for (size_t k = n - 1; k > 0; k--) {
+        sort_swap(v, 0, k);
+        sort_sift_down(lt, v, 0, k);
+    }
+}
+
+#define SORT_INSERTION_MAX 16
+
+/* Introsort: median-of-three quicksort, heapsort once the depth budget
+   is spent, insertion sort for short runs. Scans are bounds-checked so a
+   closure that is not a strict weak order only gives an unsorted result. */
+static void sort_intro(lean_object *lt, lean_object **v, size_t n, unsigned depth) {
+    while (n > SORT_INSERTION_MAX) {
+        if (depth == 0) { sort_heap(lt, v, n); return; }
+        depth--;
+        size_t mid = n / 2;
+        if (sort_lt(lt, v[mid], v[0])) sort_swap(v, 0, mid);
+        if (sort_lt(lt, v[n - 1], v[0])) sort_swap(v, 0, n - 1);
+        if (sort_lt(lt, v[n - 1], v[mid])) sort_swap(v, mid, n - 1);
+        lean_object *pivot = v[mid];
+        size_t i = 0, j = n - 1;
+        for (;;) {
+            do i++; while (i < n - 1 && sort_lt(lt, v[i], pivot));
+            do j--; while (j > 0 && sort_lt(lt, pivot, v[j]));
+            if (i >= j) break;
+            sort_swap(v, i, j);
+        }
+        /* v[0, i) is not above the pivot, v[i, n) not below; recurse into
+           the smaller side so the stack stays O(log n) */
+        if (i < n - i) { sort_intro(lt, v, i, depth); v += i; n -= i; }
+        else { sort_intro(lt, v + i, n - i, depth); n = i; }
+    }
+    sort_insertion(lt, v, n);
+}
+
+/* Array.qpartition as lt lo hi
+   Upstream returns (mid, as) where as[lo..hi] is partitioned around
+   as[mid], and qsort.sort stops as soon as mid ≥ hi. Sorting the whole
+   range here and answering mid = hi is a valid partition that ends the
+   recursion after one call. */
+LEAN_EXPORT lean_object* l_Array_qpartition___redArg(lean_object *a, lean_object *lt, lean_object *lo_obj, lean_object *hi_obj) {
+    size_t lo = lean_unbox(lo_obj), hi = lean_unbox(hi_obj);
+    size_t sz = lean_array_size(a);
+    if (hi >= sz) hi = sz - 1;
+    if (sz > 0 && lo < hi) {
+        a = lean_ensure_exclusive_array(a);
+        lean_object **v = lean_array_cptr(a) + lo;
+        size_t n = hi - lo + 1;
+        lean_object *cmp = lt;
+        void *fn = lean_to_closure(lt)->m_fun;
+        if (lean_to_closure(lt)->m_num_fixed == 0 &&
+            (fn == (void *)l_Nat_decLt___boxed || fn == (void *)l_Nat_blt___boxed ||
+             fn == (void *)l_UInt8_decLt___boxed || fn == (void *)l_UInt16_decLt___boxed)) {
+            cmp = NULL;
+            for (size_t i = 0; i < n; i++)
+                if (!lean_is_scalar(v[i])) { cmp = lt; break; }
+        }
+        unsigned depth = 0;
+        for (size_t k = n; k > 1; k >>= 1) depth += 2;
+        sort_intro(cmp, v, n, depth);
+        lo = hi;
+    }
     lean_dec(lt);
+    lean_object *r = lean_alloc_ctor(0, 2, 0);
+    lean_ctor_set(r, 0, lean_box(lo));
+    lean_ctor_set(r, 1, a);
     return r;
 }
 
@@ -237,6 +355,7 @@ LEAN_EXPORT lean_object* l___private_Init_Data_Array_Basic_0__Array_mapMUnsafe_m
         if (lean_is_exclusive(arr)) {
             o->m_data[i] = nv;
         } else {
+            LEAN_WASM_COW(LEAN_WASM_COW_ARRAY_MAP, o->m_size * sizeof(void *));
             lean_object *new_arr = lean_alloc_array(o->m_size, o->m_size);
             lean_array_object *no = lean_to_array(new_arr);
             no->m_size = o->m_size;
@@ -436,18 +555,37 @@ LEAN_EXPORT lean_object* l_String_intercalate(lean_object *sep, lean_object *xs)
     return r;
 }
 
-/* String.splitOnAux s sep start pos result */
+/* String.splitOnAux s sep b i j r
+   Upstream walks s one character at a time, resetting j on a mismatch and
+   restarting at i - j. That finds the leftmost non-overlapping matches, so
+   a plain substring search from i - j gives the same pieces. `r` holds the
+   pieces found so far in reverse and is consumed; s and sep are borrowed. */
 LEAN_EXPORT lean_object* l_String_splitOnAux(lean_object *s, lean_object *sep,
                                               lean_object *start, lean_object *pos,
                                               lean_object *sep_pos, lean_object *result) {
-    /* Simplified: just return List.cons(s, result) */
-    (void)sep; (void)start; (void)pos; (void)sep_pos;
-    lean_inc(s);
-    lean_object *cons = lean_alloc_ctor(1, 2, 0);
-    lean_ctor_set(cons, 0, s);
+    const char *d = lean_string_cstr(s);
+    size_t n = lean_string_size(s) - 1;
+    const char *p = lean_string_cstr(sep);
+    size_t m = lean_string_size(sep) - 1;
+    size_t b = lean_unbox(start);
+    size_t i = lean_unbox(pos) - lean_unbox(sep_pos);
+    lean_object *cons;
+    if (m > 0) {
+        /* memmem is two-way in musl and glibc: linear, no table to allocate */
+        const char *hit;
+        while (i < n && (hit = memmem(d + i, n - i, p, m)) != NULL) {
+            size_t at = (size_t)(hit - d);
+            cons = lean_alloc_ctor(1, 2, 0);
+            lean_ctor_set(cons, 0, lean_mk_string_from_bytes_unchecked(d + b, at - b));
+            lean_ctor_set(cons, 1, result);
+            result = cons;
+            b = i = at + m;
+        }
+    }
+    cons = lean_alloc_ctor(1, 2, 0);
+    lean_ctor_set(cons, 0, lean_mk_string_from_bytes_unchecked(d + b, n - b));
     lean_ctor_set(cons, 1, result);
-    lean_dec(s); lean_dec(sep);
-    return cons;
+    return l_List_reverse___redArg(cons);
 }
 
 /* String.quote s = "\"" ++ escape(s) ++ "\"" */
@@ -461,24 +599,49 @@ LEAN_EXPORT lean_object* l_String_quote(lean_object *s) {
     return r;
 }
 
+/* A String.Slice is a constructor with 3 fields (str : String,
+   startInclusive : Pos, endExclusive : Pos); the bounds are byte offsets
+   into str. Positions within a slice (Slice.Pos) are relative to the start. */
+static inline const uint8_t *slice_bytes(lean_object *slice, size_t *len) {
+    size_t start = lean_unbox(lean_ctor_get(slice, 1));
+    *len = lean_unbox(lean_ctor_get(slice, 2)) - start;
+    return (const uint8_t *)lean_string_cstr(lean_ctor_get(slice, 0)) + start;
+}
+
+/* New slice of str[start, stop); consumes str, no bytes are copied */
+static lean_object *mk_slice(lean_object *str, size_t start, size_t stop) {
+    lean_object *r = lean_alloc_ctor(0, 3, 0);
+    lean_ctor_set(r, 0, str);
+    lean_ctor_set(r, 1, lean_box(start));
+    lean_ctor_set(r, 2, lean_box(stop));
+    return r;
+}
+
+static inline int is_utf8_first_byte(uint8_t c) { return (c & 0xC0) != 0x80; }
+
 /* String.Slice.toString */
 LEAN_EXPORT lean_object* l_String_Slice_toString(lean_object *slice) {
-    /* A Slice is a struct with (str : String, start : Pos, stop : Pos)
-       represented as a constructor with 3 fields */
     if (lean_is_scalar(slice)) return lean_mk_string("");
     lean_object *str = lean_ctor_get(slice, 0);
     lean_object *start = lean_ctor_get(slice, 1);
     lean_object *stop = lean_ctor_get(slice, 2);
-    lean_inc(str);
-    lean_object *r = lean_string_utf8_extract(str, start, stop);
-    return r;
+    return lean_string_utf8_extract(str, start, stop);
 }
 
-/* String.Slice.trimAscii */
+/* String.Slice.trimAscii: drop ' ', '\t', '\r', '\n' at both ends */
 LEAN_EXPORT lean_object* l_String_Slice_trimAscii(lean_object *slice) {
-    /* Simplified: just return slice as-is */
-    lean_inc(slice);
-    return slice;
+    size_t start = lean_unbox(lean_ctor_get(slice, 1));
+    size_t stop = lean_unbox(lean_ctor_get(slice, 2));
+    lean_object *str = lean_ctor_get(slice, 0);
+    const char *d = lean_string_cstr(str);
+    size_t b = start, e = stop;
+#define IS_ASCII_WS(c) ((c) == ' ' || (c) == '\t' || (c) == '\r' || (c) == '\n')
+    while (b < e && IS_ASCII_WS(d[b])) b++;
+    while (e > b && IS_ASCII_WS(d[e - 1])) e--;
+#undef IS_ASCII_WS
+    if (b == start && e == stop) { lean_inc(slice); return slice; }
+    lean_inc(str);
+    return mk_slice(str, b, e);
 }
 
 /* String.Slice.toNat? */
@@ -496,41 +659,72 @@ LEAN_EXPORT lean_object* l_String_Slice_toNat_x3f(lean_object *slice) {
     return some;
 }
 
+/* Slice.Pos n is valid if it is within the slice and not inside a character */
+static int slice_is_valid_pos(lean_object *slice, lean_object *n) {
+    size_t len;
+    const uint8_t *d = slice_bytes(slice, &len);
+    if (!lean_is_scalar(n)) return 0;
+    size_t off = lean_unbox(n);
+    return off == len || (off < len && is_utf8_first_byte(d[off]));
+}
+
 /* String.Slice.pos! */
 LEAN_EXPORT lean_object* l_String_Slice_pos_x21(lean_object *slice, lean_object *n) {
-    (void)slice;
-    return n; /* simplified */
+    if (!slice_is_valid_pos(slice, n)) {
+        lean_dec(n);
+        return lean_panic_fn(lean_box(0), lean_mk_string("String.Slice.pos!: not a valid position"));
+    }
+    return n;
 }
 
 /* String.Slice.pos? */
 LEAN_EXPORT lean_object* l_String_Slice_pos_x3f(lean_object *slice, lean_object *n) {
-    (void)slice;
+    if (!slice_is_valid_pos(slice, n)) { lean_dec(n); return lean_box(0); }
     lean_object *some = lean_alloc_ctor(1, 1, 0);
     lean_ctor_set(some, 0, n);
     return some;
 }
 
-/* String.Slice.slice! */
+/* String.Slice.slice! s newStart newEnd: same string, narrower bounds */
 LEAN_EXPORT lean_object* l_String_Slice_slice_x21(lean_object *slice, lean_object *start, lean_object *stop) {
-    /* Return a new slice with adjusted bounds */
-    lean_inc(slice);
-    (void)start; (void)stop;
-    return slice;
+    lean_object *str = lean_ctor_get(slice, 0);
+    size_t base = lean_unbox(lean_ctor_get(slice, 1));
+    size_t b = lean_unbox(start), e = lean_unbox(stop);
+    lean_inc(str);
+    if (b > e) {
+        lean_object *r = mk_slice(str, base + b, base + b);
+        return lean_panic_fn(r, lean_mk_string("String.Slice.slice!: start is after end"));
+    }
+    return mk_slice(str, base + b, base + e);
 }
 
-/* String.Slice.Pattern.ForwardSliceSearcher.buildTable */
+/* String.Slice.Pattern.ForwardSliceSearcher.buildTable: KMP failure table.
+   Entry i is the length of the longest proper prefix of pat[0..i] that is
+   also a suffix of it. */
 LEAN_EXPORT lean_object* l_String_Slice_Pattern_ForwardSliceSearcher_buildTable(lean_object *pat) {
-    /* Return an empty array as the failure table */
-    (void)pat;
-    return lean_alloc_array(0, 0);
+    size_t n;
+    const uint8_t *p = slice_bytes(pat, &n);
+    lean_object *table = lean_alloc_array(n, n);
+    lean_object **t = lean_array_cptr(table);
+    size_t k = 0;
+    if (n > 0) t[0] = lean_box(0);
+    for (size_t i = 1; i < n; i++) {
+        while (k > 0 && p[i] != p[k]) k = lean_unbox(t[k - 1]);
+        if (p[i] == p[k]) k++;
+        t[i] = lean_box(k);
+    }
+    return table;
 }
 
-/* String.Slice.findNextPos.go */
+/* String.Slice.findNextPos.go: first character boundary at or after pos,
+   or the end of the slice */
 LEAN_EXPORT lean_object* l___private_Init_Data_String_Basic_0__String_Slice_findNextPos_go(
     lean_object *s, lean_object *pos) {
-    /* Just return pos */
-    (void)s;
-    return pos;
+    size_t n;
+    const uint8_t *d = slice_bytes(s, &n);
+    size_t off = lean_unbox(pos);
+    while (off < n && !is_utf8_first_byte(d[off])) off++;
+    return lean_box(off < n ? off : n);
 }
 
 /* String.mapAux for URI escape */
@@ -5,7 +5,30 @@
  * inline functions in lean.h to call mi_malloc_small (not available in
  * Emscripten). This wrapper includes the real config.h via #include_next
  * then undefines LEAN_MIMALLOC so the plain malloc path is used instead.
+ *
+ * Builds with a runtime-side allocator (LEAN_WASM_ARENA, LEAN_WASM_SLAB,
+ * LEAN_WASM_DEFERRED_FREE, see lean_runtime_wasm.c) or with allocation
+ * statistics (LEAN_WASM_ALLOC_STATS) define LEAN_SMALL_ALLOCATOR instead, so the inline
+ * ctor/closure allocation in lean.h calls lean_alloc_small/lean_free_small
+ * and lands in the runtime rather than going straight to malloc.
+ *
+ * Builds linked against Emscripten's mimalloc (-sMALLOC=mimalloc, which
+ * build_wasm.sh pairs with LEAN_WASM_MIMALLOC) keep LEAN_MIMALLOC, so
+ * lean.h's own mi_malloc_small / mi_free fast path is used unchanged.
+ * LEAN_SMALL_ALLOCATOR still takes precedence when the arena is enabled.
  */
 #pragma once
 #include_next <lean/config.h>
+#if defined(LEAN_WASM_MIMALLOC)
+#ifndef LEAN_MIMALLOC
+#define LEAN_MIMALLOC
+#endif
+#else
 #undef LEAN_MIMALLOC
+#endif
+#undef LEAN_SMALL_ALLOCATOR
+
+#if defined(LEAN_WASM_ARENA) || defined(LEAN_WASM_SLAB) || \
+    defined(LEAN_WASM_DEFERRED_FREE) || defined(LEAN_WASM_ALLOC_STATS)
+#define LEAN_SMALL_ALLOCATOR
+#endif
@@ -6,17 +6,53 @@
  *
  * Design decisions:
  *   • Memory: plain malloc/free with size prefix (matching lean.h's
- *     non-LEAN_SMALL_ALLOCATOR, non-LEAN_MIMALLOC path)
- *   • Single-threaded: no atomic ops (WASM is single-threaded)
- *   • Big Nats: abort (crypto code uses only small nats)
+ *     non-LEAN_SMALL_ALLOCATOR, non-LEAN_MIMALLOC path); optional per-call
+ *     bump arena with -DLEAN_WASM_ARENA and size-class slab allocator for
+ *     small objects with -DLEAN_WASM_SLAB; mimalloc without prefix (lean.h's
+ *     LEAN_MIMALLOC path) with -DLEAN_WASM_MIMALLOC; batched, per-call
+ *     freeing with -DLEAN_WASM_DEFERRED_FREE; allocation counters with
+ *     -DLEAN_WASM_ALLOC_STATS; copy-on-write counters with
+ *     -DLEAN_WASM_COW_STATS
+ *   • Threads: single-threaded by default, with tasks run to completion
+ *     when they are spawned; -DLEAN_WASM_THREADS (built with -pthread)
+ *     adds atomic reference counts for objects marked multi-threaded and
+ *     a work-stealing pool of worker threads that runs tasks
+ *   • Big Nats/Ints: small limb-based bignum (32-bit digits, no GMP)
  *   • IO/filesystem: stubbed (pure computation only)
+ *   • Random bytes: HMAC_DRBG (SHA-256) seeded from host entropy
+ *   • SHA-256 of many messages: multi-buffer, 4 lanes with wasm simd128
+ *     (-msimd128) or SSE2, 8 with AVX2
  *   • GMP: not required
  */
 
 #include <lean/lean.h>
+#include "lean_runtime_wasm.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#if defined(__EMSCRIPTEN__) || defined(__wasi__)
+#include <unistd.h>     /* getentropy */
+#else
+#include <errno.h>
+#include <sys/random.h> /* getrandom */
+#endif
+#if defined(__EMSCRIPTEN__)
+#include <emscripten/emscripten.h> /* emscripten_get_now */
+#else
+#include <time.h>       /* clock_gettime */
+#endif
+#include <stdatomic.h>
+#ifdef LEAN_WASM_THREADS
+#include <pthread.h>
+#include <unistd.h>     /* sysconf */
+#endif
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 /* ================================================================
  *  1. Panic / Assertions
@@ -69,43 +105,611 @@ LEAN_EXPORT void lean_panic(const char *msg, bool force_stderr) {
  *                ^-- returned pointer
  *
  * lean_small_object_size(o) = *((size_t*)o - 1) is already inline in lean.h.
+ *
+ * With LEAN_WASM_MIMALLOC, objects are plain mi_malloc blocks with no
+ * prefix and their size comes from mi_usable_size, as in upstream Lean.
  */
 
+#if defined(LEAN_WASM_MIMALLOC) && defined(LEAN_WASM_SLAB)
+#error "LEAN_WASM_MIMALLOC and LEAN_WASM_SLAB are alternative allocators"
+#endif
+
+/* The arena, slab, deferred-free and statistics state is per process and
+   unsynchronized, so the threaded runtime uses malloc (or mimalloc) only. */
+#if defined(LEAN_WASM_THREADS) && \
+    (defined(LEAN_WASM_ARENA) || defined(LEAN_WASM_SLAB) || defined(LEAN_WASM_DEFERRED_FREE) || \
+     defined(LEAN_WASM_ALLOC_STATS) || defined(LEAN_WASM_COW_STATS))
+#error "LEAN_WASM_THREADS cannot be combined with the arena, slab, deferred-free or statistics options"
+#endif
+
+#ifdef LEAN_WASM_THREADS
+#define WASM_THREAD_LOCAL _Thread_local
+#else
+#define WASM_THREAD_LOCAL
+#endif
+
 LEAN_EXPORT void lean_inc_heartbeat(void) {
     /* no-op in WASM */
 }
 
-LEAN_EXPORT lean_object *lean_alloc_object(size_t sz) {
-    lean_inc_heartbeat();
+static inline void *prefix_alloc(size_t sz) {
     void *mem = malloc(sizeof(size_t) + sz);
     if (!mem) lean_internal_panic_out_of_memory();
     *(size_t *)mem = sz;
-    return (lean_object *)((size_t *)mem + 1);
+    return (size_t *)mem + 1;
+}
+
+static inline void prefix_free(void *p) {
+    free((size_t *)p - 1);
+}
+
+/* Heap Nat/Int (section 8). The fields are those of the upstream
+   runtime's non-GMP mpz; the digits are stored inline after the object,
+   so m_digits always points at m_data. */
+typedef struct {
+    lean_object m_header;
+    bool        m_sign;     /* true if negative */
+    size_t      m_size;     /* number of digits, top digit nonzero */
+    uint32_t   *m_digits;   /* little-endian */
+    uint32_t    m_data[];
+} lean_mpz_object;
+
+/* Allocation size of a variable-size object (Array, ScalarArray, String,
+   MPZ), derived from its capacity. 0 for the fixed-size kinds (ctors,
+   closures, refs, ...), which are always small objects. */
+static inline size_t var_object_size(lean_object *o) {
+    switch (o->m_tag) {
+    case LeanArray:
+        return sizeof(lean_array_object) + sizeof(void *) * ((lean_array_object *)o)->m_capacity;
+    case LeanScalarArray:
+        return sizeof(lean_sarray_object) + o->m_other * ((lean_sarray_object *)o)->m_capacity;
+    case LeanString:
+        return sizeof(lean_string_object) + ((lean_string_object *)o)->m_capacity;
+    case LeanMPZ:
+        return sizeof(lean_mpz_object) + sizeof(uint32_t) * ((lean_mpz_object *)o)->m_size;
+    default:
+        return 0;
+    }
+}
+
+#ifdef LEAN_WASM_SLAB
+/*
+ * Segregated size-class allocator for small objects.
+ *
+ * Objects of at most SLAB_MAX_OBJECT_SIZE bytes are carved from SLAB_SIZE
+ * slabs. Slabs are aligned to their size, so the slab owning a cell is
+ * found by masking the cell's address. Each slab serves one size class and
+ * keeps an intrusive free list of its cells. Cells carry no size prefix;
+ * lean_small_mem_size reads the class size from the slab header. Classes
+ * step by 8 bytes up to 256, by 32 up to 1024 and by 128 up to 4096.
+ *
+ * lean_free_object is not given a size, so slab cells are told apart from
+ * malloc'd objects by tag (var_object_size), as the upstream runtime does.
+ * Larger objects keep the malloc + size prefix layout.
+ *
+ * Slabs with a free cell sit on their class's avail list. A slab that
+ * becomes empty goes to a spare pool that any class can draw from, unless
+ * it is the last slab of its class; past SLAB_SPARE_MAX it is freed.
+ */
+#define SLAB_SIZE            ((size_t)64 << 10)
+#define SLAB_MAX_OBJECT_SIZE 4096
+#define SLAB_NUM_CLASSES     80
+#define SLAB_SPARE_MAX       16
+
+typedef struct slab {
+    struct slab *next;      /* avail list / spare pool */
+    struct slab *prev;
+    void        *free;      /* freed cells, linked through their first word */
+    char        *bump;      /* first cell never handed out */
+    unsigned     obj_size;
+    unsigned     used;
+    unsigned     cls;
+    bool         listed;    /* on slab_avail[cls] */
+} slab;
+
+#define SLAB_HEADER_SIZE lean_align(sizeof(slab), 16)
+
+static slab    *slab_avail[SLAB_NUM_CLASSES];
+static slab    *slab_spare = NULL;
+static unsigned slab_spare_count = 0;
+
+static inline unsigned slab_class(size_t sz) {
+    if (sz <= 256)  return sz <= 8 ? 0 : (unsigned)((sz + 7) / 8) - 1;
+    if (sz <= 1024) return 31 + (unsigned)((sz - 256 + 31) / 32);
+    return 55 + (unsigned)((sz - 1024 + 127) / 128);
+}
+
+static inline unsigned slab_class_size(unsigned cls) {
+    if (cls < 32) return (cls + 1) * 8;
+    if (cls < 56) return 256 + (cls - 31) * 32;
+    return 1024 + (cls - 55) * 128;
+}
+
+static inline slab *slab_of(void *p) {
+    return (slab *)((uintptr_t)p & ~(uintptr_t)(SLAB_SIZE - 1));
+}
+
+static inline bool slab_full(slab *s) {
+    return !s->free && (size_t)((char *)s + SLAB_SIZE - s->bump) < s->obj_size;
+}
+
+static void slab_link(slab *s) {
+    s->prev = NULL;
+    s->next = slab_avail[s->cls];
+    if (s->next) s->next->prev = s;
+    slab_avail[s->cls] = s;
+    s->listed = true;
+}
+
+static void slab_unlink(slab *s) {
+    if (s->prev) s->prev->next = s->next;
+    else slab_avail[s->cls] = s->next;
+    if (s->next) s->next->prev = s->prev;
+    s->listed = false;
+}
+
+static slab *slab_new(unsigned cls) {
+    slab *s = slab_spare;
+    if (s) {
+        slab_spare = s->next;
+        slab_spare_count--;
+    } else {
+        s = (slab *)aligned_alloc(SLAB_SIZE, SLAB_SIZE);
+        if (!s) lean_internal_panic_out_of_memory();
+    }
+    s->free = NULL;
+    s->bump = (char *)s + SLAB_HEADER_SIZE;
+    s->obj_size = slab_class_size(cls);
+    s->used = 0;
+    s->cls = cls;
+    slab_link(s);
+    return s;
+}
+
+static inline void *slab_alloc(size_t sz) {
+    unsigned cls = slab_class(sz);
+    slab *s = slab_avail[cls];
+    if (!s) s = slab_new(cls);
+    void *p = s->free;
+    if (p) {
+        s->free = *(void **)p;
+    } else {
+        p = s->bump;
+        s->bump += s->obj_size;
+    }
+    s->used++;
+    if (slab_full(s)) slab_unlink(s);
+    return p;
+}
+
+static inline void slab_free(void *p) {
+    slab *s = slab_of(p);
+    *(void **)p = s->free;
+    s->free = p;
+    s->used--;
+    if (!s->listed) slab_link(s);
+    if (s->used > 0 || (!s->next && !s->prev)) return;
+    /* Empty and not the last slab of its class: release it. */
+    slab_unlink(s);
+    if (slab_spare_count < SLAB_SPARE_MAX) {
+        s->next = slab_spare;
+        slab_spare = s;
+        slab_spare_count++;
+    } else {
+        free(s);
+    }
+}
+#endif
+
+/* Allocation outside the per-call arena. */
+static inline void *heap_alloc(size_t sz) {
+#if defined(LEAN_WASM_MIMALLOC)
+    void *mem = mi_malloc(sz);
+    if (!mem) lean_internal_panic_out_of_memory();
+    return mem;
+#else
+#ifdef LEAN_WASM_SLAB
+    if (sz <= SLAB_MAX_OBJECT_SIZE) return slab_alloc(sz);
+#endif
+    return prefix_alloc(sz);
+#endif
+}
+
+static inline void heap_free(lean_object *o) {
+#if defined(LEAN_WASM_MIMALLOC)
+    mi_free(o);
+#else
+#ifdef LEAN_WASM_SLAB
+    if (var_object_size(o) <= SLAB_MAX_OBJECT_SIZE) {
+        slab_free(o);
+        return;
+    }
+#endif
+    prefix_free(o);
+#endif
+}
+
+#ifdef LEAN_WASM_DEFERRED_FREE
+/*
+ * Deferred freeing.
+ *
+ * lean_free_object does not hand objects back to the allocator straight
+ * away. Objects of up to FREE_BIN_MAX_SIZE bytes first go to a per-size
+ * bin (FREE_BIN_DEPTH deep), which lean_alloc_object pops from, so the
+ * ctor cells a routine frees are reused right away. Anything else is
+ * pushed onto a ring that is released in one batch when it fills up, or
+ * when wasm_glue.c ends an exported call (lean_wasm_free_drain). That
+ * keeps free() calls out of the hot loop. Bins are kept across calls.
+ */
+#define FREE_RING_SIZE    1024
+#define FREE_BIN_MAX_SIZE 256
+#define FREE_BIN_DEPTH    64
+
+static lean_object *free_ring[FREE_RING_SIZE];
+static unsigned     free_ring_len = 0;
+static void        *free_bins[FREE_BIN_MAX_SIZE / 8][FREE_BIN_DEPTH];
+static unsigned     free_bin_len[FREE_BIN_MAX_SIZE / 8];
+
+/* Usable size of a heap (non-arena) object, or 0 if it is not binnable. */
+static inline size_t heap_size(lean_object *o) {
+#if defined(LEAN_WASM_MIMALLOC)
+    return mi_usable_size(o) & ~(size_t)7;
+#else
+#ifdef LEAN_WASM_SLAB
+    if (var_object_size(o) <= SLAB_MAX_OBJECT_SIZE) return slab_of(o)->obj_size;
+#endif
+    size_t sz = *((size_t *)o - 1);
+    return sz % 8 == 0 ? sz : 0;
+#endif
+}
+
+static void free_ring_drain(void) {
+    for (unsigned i = 0; i < free_ring_len; i++)
+        heap_free(free_ring[i]);
+    free_ring_len = 0;
+}
+
+static inline void *free_bin_pop(size_t sz) {
+    if (sz > FREE_BIN_MAX_SIZE) return NULL;
+    unsigned b = sz <= 8 ? 0 : (unsigned)((sz + 7) / 8) - 1;
+    if (free_bin_len[b] == 0) return NULL;
+    return free_bins[b][--free_bin_len[b]];
+}
+
+static inline void deferred_free(lean_object *o) {
+    size_t sz = heap_size(o);
+    if (sz > 0 && sz <= FREE_BIN_MAX_SIZE) {
+        unsigned b = (unsigned)(sz / 8) - 1;
+        if (free_bin_len[b] < FREE_BIN_DEPTH) {
+            free_bins[b][free_bin_len[b]++] = o;
+            return;
+        }
+    }
+    if (free_ring_len == FREE_RING_SIZE) free_ring_drain();
+    free_ring[free_ring_len++] = o;
+}
+#endif
+
+#ifdef LEAN_WASM_ARENA
+/*
+ * Per-call bump arena.
+ *
+ * wasm_glue.c brackets every exported call with lean_wasm_arena_begin/end.
+ * While the arena is open, objects of at most LEAN_MAX_SMALL_OBJECT_SIZE
+ * bytes are bump-allocated from one contiguous region. They keep the usual
+ * size prefix, so the rest of the runtime treats them like malloc'd objects.
+ * Freeing an arena object only decrements a live count. The region is
+ * rewound at the end of a call once that count is zero. An object that
+ * escapes (and is not promoted) therefore delays the reset instead of
+ * dangling.
+ *
+ * If a call runs out of room, the remaining allocations fall back to
+ * malloc, and the region doubles (up to ARENA_MAX_SIZE) at the next reset.
+ */
+#define ARENA_INITIAL_SIZE ((size_t)1 << 20)
+#define ARENA_MAX_SIZE     ((size_t)16 << 20)
+
+static char    *arena_base = NULL;
+static char    *arena_cur  = NULL;
+static char    *arena_end  = NULL;
+static size_t   arena_size = ARENA_INITIAL_SIZE;
+static size_t   arena_live = 0;
+static unsigned arena_depth = 0;
+static bool     arena_overflowed = false;
+
+static inline bool arena_contains(void *p) {
+    return (char *)p >= arena_base && (char *)p < arena_end;
+}
+
+static inline void *arena_alloc(size_t sz) {
+    size_t total = lean_align(sizeof(size_t) + sz, 8);
+    if ((size_t)(arena_end - arena_cur) < total) {
+        arena_overflowed = true;
+        return NULL;
+    }
+    size_t *mem = (size_t *)arena_cur;
+    arena_cur += total;
+    arena_live++;
+    *mem = sz;
+    return mem + 1;
+}
+
+static void arena_map(size_t size) {
+    arena_base = (char *)malloc(size);
+    arena_size = arena_base ? size : 0;
+    arena_cur = arena_base;
+    arena_end = arena_base + arena_size;
+}
+#else
+static inline bool arena_contains(void *p) {
+    (void)p;
+    return false;
+}
+#endif
+
+void lean_wasm_arena_begin(void) {
+#ifdef LEAN_WASM_ARENA
+    if (arena_depth++ > 0) return;
+    if (!arena_base) arena_map(arena_size ? arena_size : ARENA_INITIAL_SIZE);
+#endif
+}
+
+void lean_wasm_arena_end(void) {
+#ifdef LEAN_WASM_ARENA
+    if (--arena_depth > 0 || arena_live > 0) return;
+    if (arena_overflowed && arena_size < ARENA_MAX_SIZE) {
+        free(arena_base);
+        arena_map(arena_size * 2);
+    }
+    arena_overflowed = false;
+    arena_cur = arena_base;
+#endif
+}
+
+void lean_wasm_free_drain(void) {
+#ifdef LEAN_WASM_DEFERRED_FREE
+    free_ring_drain();
+#endif
+}
+
+lean_obj_res lean_wasm_arena_promote(lean_obj_arg o) {
+#ifdef LEAN_WASM_ARENA
+    if (lean_is_scalar(o) || !arena_contains(o)) return o;
+    if (!lean_is_sarray(o) && !lean_is_string(o))
+        lean_internal_panic("lean_wasm_arena_promote: only leaf objects can be promoted");
+    size_t sz = *((size_t *)o - 1);
+    lean_object *r = (lean_object *)heap_alloc(sz);
+    memcpy(r, o, sz);
+    r->m_rc = 1;
+    lean_dec(o);
+    return r;
+#else
+    return o;
+#endif
+}
+
+#ifdef LEAN_WASM_ALLOC_STATS
+/*
+ * Allocation statistics.
+ *
+ * The tag of a new object is only written by the caller after
+ * lean_alloc_object returns, so each allocation is attributed lazily. It
+ * stays pending until the next allocation, its own free, or a stats read,
+ * and is then counted by tag and size class. Sizes are
+ * lean_object_byte_size, which is also what the free path subtracts, so
+ * live/peak bytes match whichever allocator the build uses.
+ */
+static lean_wasm_alloc_stats alloc_stats;
+static lean_object          *stats_pending = NULL;
+
+static unsigned stats_tag_bucket(lean_object *o) {
+    uint8_t tag = o->m_tag;
+    if (tag <= LeanMaxCtorTag) return 0;
+    switch (tag) {
+    case LeanClosure:     return 1;
+    case LeanArray:       return 2;
+    case LeanScalarArray: return 3;
+    case LeanString:      return 4;
+    default:              return 5;
+    }
+}
+
+static unsigned stats_size_bucket(size_t sz) {
+    static const size_t limits[LEAN_WASM_STAT_SIZES - 1] = {
+        16, 32, 64, 128, 256, 512, 1024, LEAN_MAX_SMALL_OBJECT_SIZE
+    };
+    unsigned b = 0;
+    while (b < LEAN_WASM_STAT_SIZES - 1 && sz > limits[b]) b++;
+    return b;
+}
+
+static void stats_flush(void) {
+    lean_object *o = stats_pending;
+    if (!o) return;
+    stats_pending = NULL;
+    size_t sz = lean_object_byte_size(o);
+    unsigned t = stats_tag_bucket(o);
+    alloc_stats.allocs[t]++;
+    alloc_stats.bytes[t] += sz;
+    alloc_stats.size_allocs[stats_size_bucket(sz)]++;
+    alloc_stats.live_bytes += sz;
+    if (alloc_stats.live_bytes > alloc_stats.peak_bytes)
+        alloc_stats.peak_bytes = alloc_stats.live_bytes;
+}
+
+static inline void stats_on_alloc(lean_object *o) {
+    stats_flush();
+    stats_pending = o;
+}
+
+static inline void stats_on_free(lean_object *o) {
+    if (o == stats_pending) stats_flush();
+    size_t sz = lean_object_byte_size(o);
+    alloc_stats.frees++;
+    alloc_stats.live_bytes = alloc_stats.live_bytes > sz ? alloc_stats.live_bytes - sz : 0;
+}
+#endif
+
+void lean_wasm_alloc_stats_get(lean_wasm_alloc_stats *out) {
+#ifdef LEAN_WASM_ALLOC_STATS
+    stats_flush();
+    *out = alloc_stats;
+#else
+    memset(out, 0, sizeof(*out));
+#endif
+}
+
+void lean_wasm_alloc_stats_reset(void) {
+#ifdef LEAN_WASM_ALLOC_STATS
+    stats_flush();
+    uint64_t live = alloc_stats.live_bytes;
+    memset(&alloc_stats, 0, sizeof(alloc_stats));
+    alloc_stats.live_bytes = live;
+    alloc_stats.peak_bytes = live;
+#endif
+}
+
+/*
+ * Copy-on-write counters.
+ *
+ * Runtime paths that copy an array, byte array or string because it is
+ * shared call LEAN_WASM_COW(). Copies made only to grow an exclusive
+ * object are not counted. Native builds also keep a small table of the
+ * call sites that copied, so accidental sharing can be traced to the Lean
+ * function that caused it.
+ */
+#ifdef LEAN_WASM_COW_STATS
+#define COW_SITES_MAX 128
+
+typedef struct {
+    void    *site;
+    unsigned kind;
+    uint64_t copies;
+    uint64_t bytes;
+} cow_site;
+
+static lean_wasm_cow_stats cow_stats;
+static cow_site            cow_sites[COW_SITES_MAX];
+static unsigned            cow_num_sites = 0;
+
+static const char *const cow_kind_names[LEAN_WASM_COW_KINDS] = {
+    "array", "array_map", "byte_array", "byte_array_slice",
+    "string_push", "string_append", "string_set"
+};
+#endif
+
+void lean_wasm_cow_note(unsigned kind, size_t bytes, void *site) {
+#ifdef LEAN_WASM_COW_STATS
+    cow_stats.copies[kind]++;
+    cow_stats.bytes[kind] += bytes;
+    if (!site) return;
+    for (unsigned i = 0; i < cow_num_sites; i++) {
+        cow_site *cs = &cow_sites[i];
+        if (cs->site == site && cs->kind == kind) {
+            cs->copies++;
+            cs->bytes += bytes;
+            return;
+        }
+    }
+    if (cow_num_sites < COW_SITES_MAX)
+        cow_sites[cow_num_sites++] = (cow_site){ site, kind, 1, bytes };
+#else
+    (void)kind;
+    (void)bytes;
+    (void)site;
+#endif
+}
+
+void lean_wasm_cow_stats_get(lean_wasm_cow_stats *out) {
+#ifdef LEAN_WASM_COW_STATS
+    *out = cow_stats;
+#else
+    memset(out, 0, sizeof(*out));
+#endif
+}
+
+void lean_wasm_cow_stats_reset(void) {
+#ifdef LEAN_WASM_COW_STATS
+    memset(&cow_stats, 0, sizeof(cow_stats));
+    cow_num_sites = 0;
+#endif
+}
+
+void lean_wasm_cow_dump(void) {
+#ifdef LEAN_WASM_COW_STATS
+    for (unsigned k = 0; k < LEAN_WASM_COW_KINDS; k++)
+        fprintf(stderr, "cow %-17s %10llu copies %14llu bytes\n", cow_kind_names[k],
+                (unsigned long long)cow_stats.copies[k], (unsigned long long)cow_stats.bytes[k]);
+    for (unsigned i = 0; i < cow_num_sites; i++) {
+        cow_site *cs = &cow_sites[i];
+        fprintf(stderr, "cow   %p %-17s %10llu copies %14llu bytes\n", cs->site,
+                cow_kind_names[cs->kind], (unsigned long long)cs->copies,
+                (unsigned long long)cs->bytes);
+    }
+#endif
+}
+
+LEAN_EXPORT lean_object *lean_alloc_object(size_t sz) {
+    lean_inc_heartbeat();
+    void *mem = NULL;
+#ifdef LEAN_WASM_ARENA
+    if (arena_depth > 0 && sz <= LEAN_MAX_SMALL_OBJECT_SIZE)
+        mem = arena_alloc(sz);
+#endif
+#ifdef LEAN_WASM_DEFERRED_FREE
+    if (!mem) mem = free_bin_pop(sz);
+#endif
+    if (!mem) mem = heap_alloc(sz);
+#ifdef LEAN_WASM_ALLOC_STATS
+    stats_on_alloc((lean_object *)mem);
+#endif
+    return (lean_object *)mem;
 }
 
 LEAN_EXPORT void lean_free_object(lean_object *o) {
-    size_t *ptr = (size_t *)o - 1;
-    free(ptr);
+#ifdef LEAN_WASM_ALLOC_STATS
+    stats_on_free(o);
+#endif
+#ifdef LEAN_WASM_ARENA
+    if (arena_contains(o)) {
+        arena_live--;
+        return;
+    }
+#endif
+#ifdef LEAN_WASM_DEFERRED_FREE
+    deferred_free(o);
+#else
+    heap_free(o);
+#endif
 }
 
-/* Called from lean_alloc_ctor_memory when LEAN_SMALL_ALLOCATOR is defined.
-   In WASM it is NOT called (the header inlines lean_alloc_small_object instead),
-   but we provide a stub for link-time safety. */
+/* Called from lean_alloc_small_object / lean_alloc_ctor_memory when
+   LEAN_SMALL_ALLOCATOR is defined, which wasm/lean/config.h does only for
+   builds with a runtime-side allocator (LEAN_WASM_ARENA, LEAN_WASM_SLAB,
+   LEAN_WASM_DEFERRED_FREE) or allocation statistics (LEAN_WASM_ALLOC_STATS).
+   Otherwise the header inlines malloc (or mi_malloc_small) and these are
+   kept for link-time safety. */
 LEAN_EXPORT void *lean_alloc_small(unsigned sz, unsigned slot_idx) {
     (void)slot_idx;
-    lean_inc_heartbeat();
-    void *mem = malloc(sizeof(size_t) + sz);
-    if (!mem) lean_internal_panic_out_of_memory();
-    *(size_t *)mem = sz;
-    return (size_t *)mem + 1;
+    return lean_alloc_object(sz);
 }
 
 LEAN_EXPORT void lean_free_small(void *p) {
-    size_t *ptr = (size_t *)p - 1;
-    free(ptr);
+#if defined(LEAN_WASM_SLAB) && !defined(LEAN_WASM_DEFERRED_FREE) && !defined(LEAN_WASM_ALLOC_STATS)
+    if (!arena_contains(p)) {
+        slab_free(p);
+        return;
+    }
+#endif
+    lean_free_object((lean_object *)p);
 }
 
 LEAN_EXPORT unsigned lean_small_mem_size(void *p) {
+#if defined(LEAN_WASM_SLAB)
+    if (!arena_contains(p)) return slab_of(p)->obj_size;
+#elif defined(LEAN_WASM_MIMALLOC)
+    if (!arena_contains(p)) return (unsigned)mi_usable_size(p);
+#endif
     return (unsigned)(*((size_t *)p - 1));
 }
 
@@ -122,16 +726,9 @@ void free_sized(void *ptr, size_t sz) {
  * ================================================================ */
 
 LEAN_EXPORT size_t lean_object_byte_size(lean_object *o) {
-    uint8_t tag = o->m_tag;
-    if (tag == LeanScalarArray) {
-        unsigned elem_sz = o->m_other;
-        return sizeof(lean_sarray_object) + elem_sz * ((lean_sarray_object *)o)->m_capacity;
-    } else if (tag == LeanString) {
-        return sizeof(lean_string_object) + ((lean_string_object *)o)->m_capacity;
-    } else {
-        /* Constructors, closures, arrays, refs: stored size */
-        return *((size_t *)o - 1);
-    }
+    size_t sz = var_object_size(o);
+    /* Constructors, closures, refs: size recorded by the allocator */
+    return sz ? sz : lean_small_object_size(o);
 }
 
 LEAN_EXPORT size_t lean_object_data_byte_size(lean_object *o) {
@@ -146,40 +743,194 @@ LEAN_EXPORT size_t lean_object_data_byte_size(lean_object *o) {
     }
 }
 
-/* Recursive deallocation when m_rc reaches 1 */
+/*
+ * Deallocation when m_rc reaches 1.
+ *
+ * Iterative, so freeing a long List or a deep tree costs constant C stack.
+ * Children whose count drops to zero go on a small work stack that is
+ * reused across calls. When it is full they are chained through their own
+ * headers instead: a dead object's m_rc (and, on 64-bit hosts, m_cs_sz) is
+ * free to hold the link, while m_other and m_tag are still needed to free
+ * it. The scheme and the header trick follow the upstream runtime.
+ */
+#define DEC_STACK_SIZE 256
+
+static WASM_THREAD_LOCAL lean_object *dec_stack[DEC_STACK_SIZE];
+
+static inline void dead_set_next(lean_object *o, lean_object *next) {
+#if UINTPTR_MAX <= 0xFFFFFFFFu
+    o->m_rc = (int)(uintptr_t)next;
+#else
+    /* Native hosts only: user-space pointers fit in 48 bits. */
+    o->m_rc = (int)(uint32_t)(uintptr_t)next;
+    o->m_cs_sz = (unsigned)((uintptr_t)next >> 32);
+#endif
+}
+
+static inline lean_object *dead_get_next(lean_object *o) {
+#if UINTPTR_MAX <= 0xFFFFFFFFu
+    return (lean_object *)(uintptr_t)(unsigned)o->m_rc;
+#else
+    return (lean_object *)(((uintptr_t)o->m_cs_sz << 32) | (uint32_t)o->m_rc);
+#endif
+}
+
+/*
+ * Objects reachable from more than one thread are marked multi-threaded
+ * (lean_mark_mt) by negating their count, so -1 is one reference and -2
+ * two. lean.h updates positive counts inline and sends negative ones
+ * here. Nothing is ever marked without LEAN_WASM_THREADS.
+ */
+LEAN_EXPORT void lean_inc_ref_cold(lean_object *o) {
+#ifdef LEAN_WASM_THREADS
+    __atomic_fetch_sub(&o->m_rc, 1, __ATOMIC_RELAXED);
+#else
+    o->m_rc--;
+#endif
+}
+
+LEAN_EXPORT void lean_inc_ref_n_cold(lean_object *o, unsigned n) {
+#ifdef LEAN_WASM_THREADS
+    __atomic_fetch_sub(&o->m_rc, (int)n, __ATOMIC_RELAXED);
+#else
+    o->m_rc -= (int)n;
+#endif
+}
+
+/* Drop one reference to an object whose m_rc is not positive; true if
+   it was the last one of a multi-threaded object. */
+static inline bool mt_dec_last(lean_object *o) {
+#ifdef LEAN_WASM_THREADS
+    return __atomic_load_n(&o->m_rc, __ATOMIC_RELAXED) < 0 &&
+           __atomic_add_fetch(&o->m_rc, 1, __ATOMIC_ACQ_REL) == 0;
+#else
+    (void)o;
+    return false;
+#endif
+}
+
 LEAN_EXPORT void lean_dec_ref_cold(lean_object *o) {
-    if (o->m_rc == 1) {
+    if (o->m_rc != 1 && !mt_dec_last(o)) return;
+
+    size_t top = 0;
+    lean_object *spill = NULL;
+
+#define DEC_CHILD(c) do {                                       \
+        lean_object *c_ = (c);                                  \
+        if (lean_is_scalar(c_)) break;                          \
+        if (c_->m_rc > 1) { c_->m_rc--; break; }                \
+        if (c_->m_rc != 1 && !mt_dec_last(c_)) break;           \
+        if (top < DEC_STACK_SIZE) { dec_stack[top++] = c_; }    \
+        else { dead_set_next(c_, spill); spill = c_; }          \
+    } while (0)
+
+    for (;;) {
         uint8_t tag = o->m_tag;
         if (tag <= LeanMaxCtorTag) {
             unsigned n = o->m_other;
             lean_ctor_object *c = (lean_ctor_object *)o;
             for (unsigned i = 0; i < n; i++)
-                lean_dec(c->m_objs[i]);
+                DEC_CHILD(c->m_objs[i]);
         } else if (tag == LeanClosure) {
             lean_closure_object *c = (lean_closure_object *)o;
             for (unsigned i = 0; i < c->m_num_fixed; i++)
-                lean_dec(c->m_objs[i]);
+                DEC_CHILD(c->m_objs[i]);
         } else if (tag == LeanArray) {
             lean_array_object *a = (lean_array_object *)o;
             for (size_t i = 0; i < a->m_size; i++)
-                lean_dec(a->m_data[i]);
+                DEC_CHILD(a->m_data[i]);
         } else if (tag == LeanRef) {
             lean_ref_object *r = (lean_ref_object *)o;
-            if (r->m_value) lean_dec(r->m_value);
+            if (r->m_value) DEC_CHILD(r->m_value);
+        } else if (tag == LeanTask) {
+            lean_task_object *t = (lean_task_object *)o;
+            lean_object *v = atomic_load_explicit(&t->m_value, memory_order_acquire);
+            if (v) DEC_CHILD(v);
+            if (t->m_imp) {
+                if (t->m_imp->m_closure) DEC_CHILD(t->m_imp->m_closure);
+                free(t->m_imp);
+            }
         }
         /* ScalarArray, String, MPZ: no children */
         lean_free_object(o);
+
+        if (top > 0) {
+            o = dec_stack[--top];
+        } else if (spill) {
+            o = spill;
+            spill = dead_get_next(o);
+        } else {
+            break;
+        }
     }
-    /* m_rc < 0 (multi-threaded): ignore in WASM */
+#undef DEC_CHILD
 }
 
 LEAN_EXPORT void lean_mark_persistent(lean_object *o) {
-    if (!lean_is_scalar(o))
+    if (!lean_is_scalar(o)) {
+#ifdef LEAN_WASM_ARENA
+        /* A persistent object would pin the per-call arena forever. */
+        if (arena_contains(o))
+            lean_internal_panic("lean_mark_persistent: object lives in the per-call arena");
+#endif
         o->m_rc = 0;
+    }
+}
+
+/*
+ * Mark everything reachable from `o` multi-threaded before it is handed
+ * to another thread. Objects that are already multi-threaded or
+ * persistent are not entered, so shared subgraphs are visited once.
+ */
+#ifdef LEAN_WASM_THREADS
+static void mt_mark_push(lean_object *c, lean_object ***stack, size_t *top, size_t *cap,
+                         lean_object **local) {
+    if (lean_is_scalar(c) || !lean_is_st(c)) return;
+    c->m_rc = -c->m_rc;
+    if (*top == *cap) {
+        size_t ncap = *cap * 2;
+        lean_object **ns = (lean_object **)malloc(sizeof(lean_object *) * ncap);
+        if (!ns) lean_internal_panic_out_of_memory();
+        memcpy(ns, *stack, sizeof(lean_object *) * *top);
+        if (*stack != local) free(*stack);
+        *stack = ns;
+        *cap = ncap;
+    }
+    (*stack)[(*top)++] = c;
 }
+#endif
 
 LEAN_EXPORT void lean_mark_mt(lean_object *o) {
+#ifdef LEAN_WASM_THREADS
+    lean_object *local[DEC_STACK_SIZE];
+    lean_object **stack = local;
+    size_t top = 0, cap = DEC_STACK_SIZE;
+    mt_mark_push(o, &stack, &top, &cap, local);
+    while (top > 0) {
+        o = stack[--top];
+        uint8_t tag = o->m_tag;
+        if (tag <= LeanMaxCtorTag) {
+            lean_ctor_object *c = (lean_ctor_object *)o;
+            for (unsigned i = 0; i < o->m_other; i++)
+                mt_mark_push(c->m_objs[i], &stack, &top, &cap, local);
+        } else if (tag == LeanClosure) {
+            lean_closure_object *c = (lean_closure_object *)o;
+            for (unsigned i = 0; i < c->m_num_fixed; i++)
+                mt_mark_push(c->m_objs[i], &stack, &top, &cap, local);
+        } else if (tag == LeanArray) {
+            lean_array_object *a = (lean_array_object *)o;
+            for (size_t i = 0; i < a->m_size; i++)
+                mt_mark_push(a->m_data[i], &stack, &top, &cap, local);
+        } else if (tag == LeanRef) {
+            lean_ref_object *r = (lean_ref_object *)o;
+            if (r->m_value) mt_mark_push(r->m_value, &stack, &top, &cap, local);
+        }
+        /* Tasks are created multi-threaded, with multi-threaded values */
+    }
+    if (stack != local) free(stack);
+#else
     (void)o;
+#endif
 }
 
 /* ================================================================
@@ -225,35 +976,61 @@ static lean_object *lean_call_with_args(void *fn, unsigned arity, lean_object **
     }
 }
 
+/*
+ * Take the fixed arguments of closure `f` (owned) into `x` and release
+ * `f`. An exclusive closure's arguments are moved out and its cell freed
+ * without touching their reference counts; a shared closure's arguments
+ * are inc'd.
+ */
+static inline void closure_take_fixed(lean_object *f, lean_object **x) {
+    lean_closure_object *c = lean_to_closure(f);
+    unsigned fixed = c->m_num_fixed;
+    for (unsigned i = 0; i < fixed; i++)
+        x[i] = c->m_objs[i];
+    if (lean_is_exclusive(f)) {
+        lean_free_object(f);
+    } else {
+        for (unsigned i = 0; i < fixed; i++)
+            lean_inc(x[i]);
+        lean_dec_ref(f);
+    }
+}
+
 LEAN_EXPORT lean_object *lean_apply_m(lean_object *f, unsigned n, lean_object **args) {
     lean_closure_object *c = lean_to_closure(f);
-    unsigned remaining = c->m_arity - c->m_num_fixed;
+    unsigned fixed = c->m_num_fixed;
+    unsigned remaining = c->m_arity - fixed;
 
     if (n < remaining) {
         /* Under-application: add args to closure */
-        lean_object *nc = lean_alloc_closure(c->m_fun, c->m_arity, c->m_num_fixed + n);
-        lean_closure_object *nco = lean_to_closure(nc);
-        for (unsigned i = 0; i < c->m_num_fixed; i++) {
-            lean_inc(c->m_objs[i]);
-            nco->m_objs[i] = c->m_objs[i];
+        unsigned new_fixed = fixed + n;
+        if (lean_is_exclusive(f) &&
+            lean_small_object_size(f) >= sizeof(lean_closure_object) + sizeof(void *) * new_fixed) {
+            /* The cell has room: extend it in place */
+            for (unsigned i = 0; i < n; i++)
+                c->m_objs[fixed + i] = args[i];
+            c->m_num_fixed = new_fixed;
+            return f;
         }
+        void *fn = c->m_fun;
+        unsigned arity = c->m_arity;
+        lean_object *nc = lean_alloc_closure(fn, arity, new_fixed);
+        lean_closure_object *nco = lean_to_closure(nc);
+        closure_take_fixed(f, nco->m_objs);
         for (unsigned i = 0; i < n; i++)
-            nco->m_objs[c->m_num_fixed + i] = args[i];
-        lean_dec(f);
+            nco->m_objs[fixed + i] = args[i];
         return nc;
     }
 
     /* Exact or over-application: collect all args for the call */
+    void *fn = c->m_fun;
+    unsigned arity = c->m_arity;
     lean_object *all_args[16];
-    for (unsigned i = 0; i < c->m_num_fixed; i++) {
-        lean_inc(c->m_objs[i]);
-        all_args[i] = c->m_objs[i];
-    }
+    closure_take_fixed(f, all_args);
     for (unsigned i = 0; i < remaining; i++)
-        all_args[c->m_num_fixed + i] = args[i];
+        all_args[fixed + i] = args[i];
 
-    lean_object *res = lean_call_with_args(c->m_fun, c->m_arity, all_args);
-    lean_dec(f);
+    lean_object *res = lean_call_with_args(fn, arity, all_args);
 
     if (n > remaining) {
         /* Over-application: apply result to remaining args */
@@ -266,22 +1043,86 @@ LEAN_EXPORT lean_object *lean_apply_n(lean_object *f, unsigned n, lean_object **
     return lean_apply_m(f, n, args);
 }
 
+/*
+ * lean_apply_1..4 call the closure's function directly when the call
+ * saturates it and it has at most APPLY_FAST_MAX_FIXED fixed arguments,
+ * the common case for the function arguments of List.all, List.find?,
+ * Array.mapMUnsafe and friends. Everything else goes through lean_apply_m.
+ */
+#define APPLY_FAST_MAX_FIXED 4
+
 LEAN_EXPORT lean_object *lean_apply_1(lean_object *f, lean_object *a1) {
+    lean_closure_object *c = lean_to_closure(f);
+    unsigned fixed = c->m_num_fixed;
+    if (c->m_arity == fixed + 1 && fixed <= APPLY_FAST_MAX_FIXED) {
+        void *fn = c->m_fun;
+        lean_object *x[APPLY_FAST_MAX_FIXED];
+        closure_take_fixed(f, x);
+        switch (fixed) {
+        case 0: return ((lean_cfun1)fn)(a1);
+        case 1: return ((lean_cfun2)fn)(x[0], a1);
+        case 2: return ((lean_cfun3)fn)(x[0], x[1], a1);
+        case 3: return ((lean_cfun4)fn)(x[0], x[1], x[2], a1);
+        default: return ((lean_cfun5)fn)(x[0], x[1], x[2], x[3], a1);
+        }
+    }
     lean_object *args[1] = {a1};
     return lean_apply_m(f, 1, args);
 }
 
 LEAN_EXPORT lean_object *lean_apply_2(lean_object *f, lean_object *a1, lean_object *a2) {
+    lean_closure_object *c = lean_to_closure(f);
+    unsigned fixed = c->m_num_fixed;
+    if (c->m_arity == fixed + 2 && fixed <= APPLY_FAST_MAX_FIXED) {
+        void *fn = c->m_fun;
+        lean_object *x[APPLY_FAST_MAX_FIXED];
+        closure_take_fixed(f, x);
+        switch (fixed) {
+        case 0: return ((lean_cfun2)fn)(a1, a2);
+        case 1: return ((lean_cfun3)fn)(x[0], a1, a2);
+        case 2: return ((lean_cfun4)fn)(x[0], x[1], a1, a2);
+        case 3: return ((lean_cfun5)fn)(x[0], x[1], x[2], a1, a2);
+        default: return ((lean_cfun6)fn)(x[0], x[1], x[2], x[3], a1, a2);
+        }
+    }
     lean_object *args[2] = {a1, a2};
     return lean_apply_m(f, 2, args);
 }
 
 LEAN_EXPORT lean_object *lean_apply_3(lean_object *f, lean_object *a1, lean_object *a2, lean_object *a3) {
+    lean_closure_object *c = lean_to_closure(f);
+    unsigned fixed = c->m_num_fixed;
+    if (c->m_arity == fixed + 3 && fixed <= APPLY_FAST_MAX_FIXED) {
+        void *fn = c->m_fun;
+        lean_object *x[APPLY_FAST_MAX_FIXED];
+        closure_take_fixed(f, x);
+        switch (fixed) {
+        case 0: return ((lean_cfun3)fn)(a1, a2, a3);
+        case 1: return ((lean_cfun4)fn)(x[0], a1, a2, a3);
+        case 2: return ((lean_cfun5)fn)(x[0], x[1], a1, a2, a3);
+        case 3: return ((lean_cfun6)fn)(x[0], x[1], x[2], a1, a2, a3);
+        default: return ((lean_cfun7)fn)(x[0], x[1], x[2], x[3], a1, a2, a3);
+        }
+    }
     lean_object *args[3] = {a1, a2, a3};
     return lean_apply_m(f, 3, args);
 }
 
 LEAN_EXPORT lean_object *lean_apply_4(lean_object *f, lean_object *a1, lean_object *a2, lean_object *a3, lean_object *a4) {
+    lean_closure_object *c = lean_to_closure(f);
+    unsigned fixed = c->m_num_fixed;
+    if (c->m_arity == fixed + 4 && fixed <= APPLY_FAST_MAX_FIXED) {
+        void *fn = c->m_fun;
+        lean_object *x[APPLY_FAST_MAX_FIXED];
+        closure_take_fixed(f, x);
+        switch (fixed) {
+        case 0: return ((lean_cfun4)fn)(a1, a2, a3, a4);
+        case 1: return ((lean_cfun5)fn)(x[0], a1, a2, a3, a4);
+        case 2: return ((lean_cfun6)fn)(x[0], x[1], a1, a2, a3, a4);
+        case 3: return ((lean_cfun7)fn)(x[0], x[1], x[2], a1, a2, a3, a4);
+        default: return ((lean_cfun8)fn)(x[0], x[1], x[2], x[3], a1, a2, a3, a4);
+        }
+    }
     lean_object *args[4] = {a1, a2, a3, a4};
     return lean_apply_m(f, 4, args);
 }
@@ -398,7 +1239,7 @@ LEAN_EXPORT lean_object *lean_mk_array(lean_obj_arg n, lean_obj_arg v) {
     return arr;
 }
 
-LEAN_EXPORT lean_obj_res lean_copy_expand_array(lean_obj_arg a, bool expand) {
+static lean_obj_res copy_expand_array(lean_obj_arg a, bool expand) {
     lean_array_object *src = lean_to_array(a);
     size_t sz = src->m_size;
     size_t cap = expand ? (sz < 4 ? 4 : sz * 2) : sz;
@@ -413,16 +1254,24 @@ LEAN_EXPORT lean_obj_res lean_copy_expand_array(lean_obj_arg a, bool expand) {
     return dst;
 }
 
+LEAN_EXPORT lean_obj_res lean_copy_expand_array(lean_obj_arg a, bool expand) {
+    if (!lean_is_exclusive(a))
+        LEAN_WASM_COW(LEAN_WASM_COW_ARRAY, lean_to_array(a)->m_size * sizeof(void *));
+    return copy_expand_array(a, expand);
+}
+
 LEAN_EXPORT lean_object *lean_array_push(lean_obj_arg a, lean_obj_arg v) {
     lean_array_object *o = lean_to_array(a);
     if (lean_is_exclusive(a) && o->m_size < o->m_capacity) {
         o->m_data[o->m_size++] = v;
         return a;
     }
-    lean_object *r = lean_copy_expand_array(a, 1);
+    if (!lean_is_exclusive(a))
+        LEAN_WASM_COW(LEAN_WASM_COW_ARRAY, o->m_size * sizeof(void *));
+    lean_object *r = copy_expand_array(a, 1);
     lean_array_object *ro = lean_to_array(r);
     if (ro->m_size >= ro->m_capacity) {
-        r = lean_copy_expand_array(r, 1);
+        r = copy_expand_array(r, 1);
         ro = lean_to_array(r);
     }
     ro->m_data[ro->m_size++] = v;
@@ -477,6 +1326,7 @@ LEAN_EXPORT lean_obj_res lean_byte_array_data(lean_obj_arg a) {
 LEAN_EXPORT lean_obj_res lean_copy_byte_array(lean_obj_arg a) {
     lean_sarray_object *src = lean_to_sarray(a);
     size_t sz = src->m_size;
+    if (!lean_is_exclusive(a)) LEAN_WASM_COW(LEAN_WASM_COW_BYTE_ARRAY, sz);
     lean_object *dst = lean_alloc_sarray(1, sz, sz);
     memcpy(lean_sarray_cptr(dst), src->m_data, sz);
     lean_dec(a);
@@ -490,6 +1340,7 @@ LEAN_EXPORT lean_obj_res lean_byte_array_push(lean_obj_arg a, uint8_t b) {
         return a;
     }
     size_t sz = o->m_size;
+    if (!lean_is_exclusive(a)) LEAN_WASM_COW(LEAN_WASM_COW_BYTE_ARRAY, sz);
     size_t cap = sz < 4 ? 8 : sz * 2;
     lean_object *dst = lean_alloc_sarray(1, sz + 1, cap);
     lean_sarray_object *d = lean_to_sarray(dst);
@@ -519,6 +1370,7 @@ LEAN_EXPORT lean_obj_res lean_byte_array_copy_slice(b_lean_obj_arg src, b_lean_o
     if (new_sz < dst_sz) new_sz = dst_sz;
 
     if (!lean_is_exclusive(dst) || new_sz > d->m_capacity) {
+        if (!lean_is_exclusive(dst)) LEAN_WASM_COW(LEAN_WASM_COW_BYTE_ARRAY_SLICE, new_sz);
         size_t cap = exact ? new_sz : (new_sz < 8 ? 8 : new_sz * 2);
         lean_object *new_dst = lean_alloc_sarray(1, new_sz, cap);
         lean_sarray_object *nd = lean_to_sarray(new_dst);
@@ -535,46 +1387,202 @@ LEAN_EXPORT lean_obj_res lean_byte_array_copy_slice(b_lean_obj_arg src, b_lean_o
     return dst;
 }
 
-LEAN_EXPORT uint64_t lean_byte_array_hash(b_lean_obj_arg a) {
+/*
+ * Byte-string hash shared by ByteArray, String and String.Slice: wyhash,
+ * reading 8 bytes at a time with three independent lanes for inputs over
+ * 48 bytes. The seed and final mixing follow wyhash final version 4; the
+ * secret is wyhash final3's _wyp, so values differ from final4's default
+ * secret. The 64×64-bit multiply is the 32-bit variant
+ * (WYHASH_32BIT_MUM) built from four 32×32→64 products, which wasm32 has
+ * natively; a 128-bit product would go through a libcall. wasm-simd128
+ * has no 64-bit widening multiply, so there is no vector path.
+ */
+#define HASH_SEED 11
+
+static const uint64_t wyp[4] = {
+    0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull
+};
+
+static inline uint64_t wyrot(uint64_t x) { return (x >> 32) | (x << 32); }
+
+static inline void wymum(uint64_t *a, uint64_t *b) {
+    uint64_t hh = (*a >> 32) * (*b >> 32), hl = (*a >> 32) * (uint32_t)*b;
+    uint64_t lh = (uint32_t)*a * (*b >> 32), ll = (uint64_t)(uint32_t)*a * (uint32_t)*b;
+    *a = wyrot(hl) ^ hh;
+    *b = wyrot(lh) ^ ll;
+}
+
+static inline uint64_t wymix(uint64_t a, uint64_t b) { wymum(&a, &b); return a ^ b; }
+
+/* Little-endian loads; wasm and the native hosts we test on are LE. */
+static inline uint64_t wyr8(const uint8_t *p) { uint64_t v; memcpy(&v, p, 8); return v; }
+static inline uint64_t wyr4(const uint8_t *p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static inline uint64_t wyr3(const uint8_t *p, size_t k) {
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
+static uint64_t hash_bytes(const uint8_t *p, size_t len) {
+    uint64_t seed = HASH_SEED, a, b;
+    seed ^= wymix(seed ^ wyp[0], wyp[1]);
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t m = (len >> 3) << 2;
+            a = (wyr4(p) << 32) | wyr4(p + m);
+            b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - m);
+        } else if (len > 0) {
+            a = wyr3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+                see1 = wymix(wyr8(p + 16) ^ wyp[2], wyr8(p + 24) ^ see1);
+                see2 = wymix(wyr8(p + 32) ^ wyp[3], wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = wyr8(p + i - 16);
+        b = wyr8(p + i - 8);
+    }
+    a ^= wyp[1];
+    b ^= seed;
+    wymum(&a, &b);
+    return wymix(a ^ wyp[0] ^ len, b ^ wyp[1]);
+}
+
+LEAN_EXPORT uint64_t lean_byte_array_hash(b_lean_obj_arg a) {
     lean_sarray_object *o = lean_to_sarray(a);
-    uint64_t h = 7;
-    for (size_t i = 0; i < o->m_size; i++)
-        h = h * 31 + o->m_data[i];
-    return h;
+    return hash_bytes(o->m_data, o->m_size);
 }
 
 /* ================================================================
  *  7. String Operations
  * ================================================================ */
 
-LEAN_EXPORT size_t lean_utf8_strlen(const char *str) {
-    size_t len = 0;
-    while (*str) {
-        unsigned char c = (unsigned char)*str;
-        if (c < 0x80)      str += 1;
-        else if (c < 0xE0) str += 2;
-        else if (c < 0xF0) str += 3;
-        else                str += 4;
-        len++;
+/*
+ * UTF-8 scanning.
+ *
+ * Strings built from bytes are mostly ASCII (header names and values,
+ * hex, base64), so the scanners look at UTF8_BLOCK bytes per step: 16
+ * with wasm simd128 (build with -msimd128) or SSE2, 8 as a plain word
+ * otherwise. An all-ASCII block is UTF8_BLOCK code points. A block with a
+ * high bit set is handed to the scalar decoder, which then carries on to
+ * the end of that block before the next vector step.
+ */
+#if defined(__wasm_simd128__)
+#define UTF8_BLOCK 16
+static inline bool utf8_block_ascii(const uint8_t *p) {
+    return wasm_i8x16_bitmask(wasm_v128_load(p)) == 0;
+}
+/* Bytes that start a code point, i.e. are not 10xxxxxx. */
+static inline size_t utf8_block_starts(const uint8_t *p) {
+    v128_t cont = wasm_i8x16_lt(wasm_v128_load(p), wasm_i8x16_splat(-64));
+    return UTF8_BLOCK - (size_t)__builtin_popcount(wasm_i8x16_bitmask(cont));
+}
+#elif defined(__SSE2__)
+#define UTF8_BLOCK 16
+static inline bool utf8_block_ascii(const uint8_t *p) {
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)p)) == 0;
+}
+static inline size_t utf8_block_starts(const uint8_t *p) {
+    __m128i cont = _mm_cmplt_epi8(_mm_loadu_si128((const __m128i *)p), _mm_set1_epi8(-64));
+    return UTF8_BLOCK - (size_t)__builtin_popcount((unsigned)_mm_movemask_epi8(cont));
+}
+#else
+#define UTF8_BLOCK 8
+static inline bool utf8_block_ascii(const uint8_t *p) {
+    uint64_t w;
+    memcpy(&w, p, 8);
+    return (w & 0x8080808080808080ull) == 0;
+}
+static inline size_t utf8_block_starts(const uint8_t *p) {
+    uint64_t w;
+    memcpy(&w, p, 8);
+    uint64_t cont = w & ~(w << 1) & 0x8080808080808080ull;
+    return UTF8_BLOCK - (size_t)__builtin_popcountll(cont);
+}
+#endif
+
+/* Length of the well-formed sequence at p, or 0. Overlong forms,
+   surrogates and code points past U+10FFFF are rejected. */
+static inline size_t utf8_decode_len(const uint8_t *p, size_t avail) {
+    uint8_t c = p[0];
+    if (c < 0x80) return 1;
+    if (c < 0xC2) return 0;
+    if (c < 0xE0)
+        return avail >= 2 && (p[1] & 0xC0) == 0x80 ? 2 : 0;
+    if (c < 0xF0) {
+        if (avail < 3 || (p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80) return 0;
+        if (c == 0xE0 && p[1] < 0xA0) return 0;
+        if (c == 0xED && p[1] >= 0xA0) return 0;
+        return 3;
     }
-    return len;
+    if (c < 0xF5) {
+        if (avail < 4 || (p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80 || (p[3] & 0xC0) != 0x80) return 0;
+        if (c == 0xF0 && p[1] < 0x90) return 0;
+        if (c == 0xF4 && p[1] >= 0x90) return 0;
+        return 4;
+    }
+    return 0;
 }
 
-LEAN_EXPORT size_t lean_utf8_n_strlen(const char *str, size_t n) {
-    size_t len = 0;
-    const char *end = str + n;
-    while (str < end) {
-        unsigned char c = (unsigned char)*str;
-        if (c < 0x80)      str += 1;
-        else if (c < 0xE0) str += 2;
-        else if (c < 0xF0) str += 3;
-        else                str += 4;
-        len++;
+/* Validate n bytes and count their code points in one pass. */
+static bool utf8_scan(const uint8_t *p, size_t n, size_t *len) {
+    size_t i = 0, cps = 0;
+    while (i < n) {
+        size_t stop = n;
+        if (n - i >= UTF8_BLOCK) {
+            if (utf8_block_ascii(p + i)) {
+                i += UTF8_BLOCK;
+                cps += UTF8_BLOCK;
+                continue;
+            }
+            stop = i + UTF8_BLOCK;
+        }
+        while (i < stop) {
+            if (p[i] < 0x80) {
+                i++;
+                cps++;
+                continue;
+            }
+            size_t k = utf8_decode_len(p + i, n - i);
+            if (k == 0) return false;
+            i += k;
+            cps++;
+        }
     }
+    *len = cps;
+    return true;
+}
+
+/* Code points of valid UTF-8: the bytes that are not continuation bytes. */
+LEAN_EXPORT size_t lean_utf8_n_strlen(const char *str, size_t n) {
+    const uint8_t *p = (const uint8_t *)str;
+    size_t len = 0, i = 0;
+    for (; i + UTF8_BLOCK <= n; i += UTF8_BLOCK)
+        len += utf8_block_starts(p + i);
+    for (; i < n; i++)
+        len += (p[i] & 0xC0) != 0x80;
     return len;
 }
 
-LEAN_EXPORT lean_obj_res lean_mk_string_unchecked(const char *s, size_t sz, size_t len) {
+LEAN_EXPORT size_t lean_utf8_strlen(const char *str) {
+    return lean_utf8_n_strlen(str, strlen(str));
+}
+
+static lean_object *alloc_string(size_t sz, size_t len) {
     size_t rsz = sz + 1;
     lean_object *o = lean_alloc_object(sizeof(lean_string_object) + rsz);
     lean_set_st_header(o, LeanString, 0);
@@ -582,13 +1590,47 @@ LEAN_EXPORT lean_obj_res lean_mk_string_unchecked(const char *s, size_t sz, size
     so->m_size = rsz;
     so->m_capacity = rsz;
     so->m_length = len;
-    memcpy(so->m_data, s, sz);
     so->m_data[sz] = '\0';
     return o;
 }
 
+LEAN_EXPORT lean_obj_res lean_mk_string_unchecked(const char *s, size_t sz, size_t len) {
+    lean_object *o = alloc_string(sz, len);
+    memcpy(lean_to_string(o)->m_data, s, sz);
+    return o;
+}
+
+/* Invalid input: each byte that does not start a well-formed sequence
+   becomes U+FFFD, as in the upstream runtime. */
+static lean_obj_res mk_string_lossy(const uint8_t *p, size_t sz) {
+    size_t out = 0, len = 0;
+    for (size_t i = 0; i < sz; len++) {
+        size_t k = utf8_decode_len(p + i, sz - i);
+        out += k ? k : 3;
+        i += k ? k : 1;
+    }
+    lean_object *o = alloc_string(out, len);
+    char *d = lean_to_string(o)->m_data;
+    for (size_t i = 0; i < sz;) {
+        size_t k = utf8_decode_len(p + i, sz - i);
+        if (k) {
+            memcpy(d, p + i, k);
+            d += k;
+            i += k;
+        } else {
+            memcpy(d, "\xEF\xBF\xBD", 3);
+            d += 3;
+            i++;
+        }
+    }
+    return o;
+}
+
 LEAN_EXPORT lean_obj_res lean_mk_string_from_bytes(const char *s, size_t sz) {
-    return lean_mk_string_unchecked(s, sz, lean_utf8_n_strlen(s, sz));
+    size_t len;
+    if (utf8_scan((const uint8_t *)s, sz, &len))
+        return lean_mk_string_unchecked(s, sz, len);
+    return mk_string_lossy((const uint8_t *)s, sz);
 }
 
 LEAN_EXPORT lean_obj_res lean_mk_string(const char *s) {
@@ -605,27 +1647,40 @@ LEAN_EXPORT lean_obj_res lean_mk_string_from_bytes_unchecked(const char *s, size
     return lean_mk_string_unchecked(s, sz, lean_utf8_n_strlen(s, sz));
 }
 
+static inline unsigned utf8_char_size(uint32_t c) {
+    return c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+}
+
+/* Write the UTF-8 encoding of c to d; returns its length */
+static inline unsigned utf8_encode(char *d, uint32_t c) {
+    if (c < 0x80) { d[0] = (char)c; return 1; }
+    if (c < 0x800) {
+        d[0] = (char)(0xC0 | (c >> 6));
+        d[1] = (char)(0x80 | (c & 0x3F));
+        return 2;
+    }
+    if (c < 0x10000) {
+        d[0] = (char)(0xE0 | (c >> 12));
+        d[1] = (char)(0x80 | ((c >> 6) & 0x3F));
+        d[2] = (char)(0x80 | (c & 0x3F));
+        return 3;
+    }
+    d[0] = (char)(0xF0 | (c >> 18));
+    d[1] = (char)(0x80 | ((c >> 12) & 0x3F));
+    d[2] = (char)(0x80 | ((c >> 6) & 0x3F));
+    d[3] = (char)(0x80 | (c & 0x3F));
+    return 4;
+}
+
+/* Width of the character whose first byte is c (1 for a stray byte) */
+static inline unsigned utf8_first_byte_size(unsigned char c) {
+    return c < 0xC0 ? 1 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+}
+
 LEAN_EXPORT lean_obj_res lean_string_push(lean_obj_arg s, uint32_t c) {
     lean_string_object *so = lean_to_string(s);
     char buf[4];
-    unsigned char_sz;
-    if (c < 0x80) { buf[0] = (char)c; char_sz = 1; }
-    else if (c < 0x800) {
-        buf[0] = (char)(0xC0 | (c >> 6));
-        buf[1] = (char)(0x80 | (c & 0x3F));
-        char_sz = 2;
-    } else if (c < 0x10000) {
-        buf[0] = (char)(0xE0 | (c >> 12));
-        buf[1] = (char)(0x80 | ((c >> 6) & 0x3F));
-        buf[2] = (char)(0x80 | (c & 0x3F));
-        char_sz = 3;
-    } else {
-        buf[0] = (char)(0xF0 | (c >> 18));
-        buf[1] = (char)(0x80 | ((c >> 12) & 0x3F));
-        buf[2] = (char)(0x80 | ((c >> 6) & 0x3F));
-        buf[3] = (char)(0x80 | (c & 0x3F));
-        char_sz = 4;
-    }
+    unsigned char_sz = utf8_encode(buf, c);
 
     size_t old_bsz = so->m_size; /* includes NUL */
     size_t new_bsz = old_bsz + char_sz;
@@ -638,6 +1693,7 @@ LEAN_EXPORT lean_obj_res lean_string_push(lean_obj_arg s, uint32_t c) {
         return s;
     }
 
+    if (!lean_is_exclusive(s)) LEAN_WASM_COW(LEAN_WASM_COW_STRING_PUSH, old_bsz);
     size_t new_cap = new_bsz < 16 ? 16 : new_bsz * 2;
     lean_object *r = lean_alloc_object(sizeof(lean_string_object) + new_cap);
     lean_set_st_header(r, LeanString, 0);
@@ -666,6 +1722,7 @@ LEAN_EXPORT lean_obj_res lean_string_append(lean_obj_arg s1, b_lean_obj_arg s2)
         return s1;
     }
 
+    if (!lean_is_exclusive(s1)) LEAN_WASM_COW(LEAN_WASM_COW_STRING_APPEND, new_bsz);
     size_t cap = new_bsz < 16 ? 16 : new_bsz * 2;
     lean_object *r = lean_alloc_object(sizeof(lean_string_object) + cap);
     lean_set_st_header(r, LeanString, 0);
@@ -679,56 +1736,44 @@ LEAN_EXPORT lean_obj_res lean_string_append(lean_obj_arg s1, b_lean_obj_arg s2)
     return r;
 }
 
+/* Chars in a List are boxed with lean_box_uint32, which allocates on
+   32-bit targets. */
 LEAN_EXPORT lean_obj_res lean_string_mk(lean_obj_arg cs) {
-    /* Convert List Char to String */
-    size_t cap = 64;
-    lean_object *r = lean_alloc_object(sizeof(lean_string_object) + cap);
-    lean_set_st_header(r, LeanString, 0);
-    lean_string_object *ro = lean_to_string(r);
-    ro->m_size = 1;
-    ro->m_capacity = cap;
-    ro->m_length = 0;
-    ro->m_data[0] = '\0';
-
-    lean_object *p = cs;
-    while (!lean_is_scalar(p)) {
-        uint32_t ch = lean_unbox(lean_ctor_get(p, 0));
-        r = lean_string_push(r, ch);
-        ro = lean_to_string(r);
-        p = lean_ctor_get(p, 1);
+    /* Convert List Char to String: size the buffer, then encode */
+    size_t sz = 0, len = 0;
+    for (lean_object *p = cs; !lean_is_scalar(p); p = lean_ctor_get(p, 1)) {
+        sz += utf8_char_size(lean_unbox_uint32(lean_ctor_get(p, 0)));
+        len++;
     }
+    lean_object *r = alloc_string(sz, len);
+    char *d = lean_to_string(r)->m_data;
+    for (lean_object *p = cs; !lean_is_scalar(p); p = lean_ctor_get(p, 1))
+        d += utf8_encode(d, lean_unbox_uint32(lean_ctor_get(p, 0)));
     lean_dec(cs);
     return r;
 }
 
 LEAN_EXPORT lean_obj_res lean_string_data(lean_obj_arg s) {
-    /* Convert String to List Char */
+    /* Convert String to List Char, appending cells at the tail */
     lean_string_object *so = lean_to_string(s);
     lean_object *r = lean_box(0);
-    const char *p = so->m_data;
-    const char *end = p + so->m_size - 1;
-
-    /* Build in reverse, then reverse */
-    size_t len = so->m_length;
-    uint32_t *chars = (uint32_t *)malloc(len * sizeof(uint32_t));
-    size_t idx = 0;
-    while (p < end && idx < len) {
-        unsigned char c = (unsigned char)*p;
+    lean_object *last = NULL;
+    const unsigned char *p = (const unsigned char *)so->m_data;
+    const unsigned char *end = p + so->m_size - 1;
+    while (p < end) {
+        unsigned char c = *p;
         uint32_t ch;
         if (c < 0x80) { ch = c; p += 1; }
         else if (c < 0xE0) { ch = (c & 0x1F) << 6 | (p[1] & 0x3F); p += 2; }
         else if (c < 0xF0) { ch = (c & 0x0F) << 12 | (p[1] & 0x3F) << 6 | (p[2] & 0x3F); p += 3; }
         else { ch = (c & 0x07) << 18 | (p[1] & 0x3F) << 12 | (p[2] & 0x3F) << 6 | (p[3] & 0x3F); p += 4; }
-        chars[idx++] = ch;
-    }
-
-    for (size_t i = idx; i > 0; i--) {
         lean_object *cons = lean_alloc_ctor(1, 2, 0);
-        lean_ctor_set(cons, 0, lean_box(chars[i - 1]));
-        lean_ctor_set(cons, 1, r);
-        r = cons;
+        lean_ctor_set(cons, 0, lean_box_uint32(ch));
+        lean_ctor_set(cons, 1, lean_box(0));
+        if (last) lean_ctor_set(last, 1, cons);
+        else r = cons;
+        last = cons;
     }
-    free(chars);
     lean_dec(s);
     return r;
 }
@@ -744,10 +1789,36 @@ LEAN_EXPORT lean_obj_res lean_string_utf8_extract(b_lean_obj_arg s, b_lean_obj_a
     return lean_mk_string_from_bytes(so->m_data + bv, ev - bv);
 }
 
+/* String.set: replace the character starting at byte i. Positions that
+   are out of range or inside a character leave s unchanged. */
 LEAN_EXPORT lean_obj_res lean_string_utf8_set(lean_obj_arg s, b_lean_obj_arg i, uint32_t c) {
-    /* Simplified: just return the string unchanged for now */
-    (void)i; (void)c;
-    return s;
+    if (!lean_is_scalar(i)) return s;
+    lean_string_object *so = lean_to_string(s);
+    size_t pos = lean_unbox(i);
+    size_t sz = so->m_size - 1;
+    if (pos >= sz || (so->m_data[pos] & 0xC0) == 0x80) return s;
+    size_t old_w = utf8_first_byte_size((unsigned char)so->m_data[pos]);
+    if (old_w > sz - pos) old_w = sz - pos;
+    char buf[4];
+    size_t new_w = utf8_encode(buf, c);
+    size_t new_bsz = so->m_size - old_w + new_w;
+
+    if (lean_is_exclusive(s) && new_bsz <= so->m_capacity) {
+        if (new_w != old_w)
+            memmove(so->m_data + pos + new_w, so->m_data + pos + old_w, sz - pos - old_w + 1);
+        memcpy(so->m_data + pos, buf, new_w);
+        so->m_size = new_bsz;
+        return s;
+    }
+
+    if (!lean_is_exclusive(s)) LEAN_WASM_COW(LEAN_WASM_COW_STRING_SET, new_bsz);
+    lean_object *r = alloc_string(new_bsz - 1, so->m_length);
+    char *d = lean_to_string(r)->m_data;
+    memcpy(d, so->m_data, pos);
+    memcpy(d + pos, buf, new_w);
+    memcpy(d + pos + new_w, so->m_data + pos + old_w, sz - pos - old_w);
+    lean_dec(s);
+    return r;
 }
 
 LEAN_EXPORT uint32_t lean_string_utf8_get(b_lean_obj_arg s, b_lean_obj_arg i) {
@@ -819,10 +1890,7 @@ LEAN_EXPORT bool lean_string_lt(b_lean_obj_arg s1, b_lean_obj_arg s2) {
 
 LEAN_EXPORT uint64_t lean_string_hash(b_lean_obj_arg s) {
     lean_string_object *o = lean_to_string(s);
-    uint64_t h = 7;
-    for (size_t i = 0; i < o->m_size - 1; i++)
-        h = h * 31 + (unsigned char)o->m_data[i];
-    return h;
+    return hash_bytes((const uint8_t *)o->m_data, o->m_size - 1);
 }
 
 LEAN_EXPORT uint8_t lean_string_memcmp(b_lean_obj_arg s1, b_lean_obj_arg s2,
@@ -839,24 +1907,17 @@ LEAN_EXPORT uint8_t lean_string_memcmp(b_lean_obj_arg s1, b_lean_obj_arg s2,
     return memcmp(o1->m_data + ls, o2->m_data + rs, n) == 0;
 }
 
-LEAN_EXPORT uint8_t lean_string_validate_utf8(b_lean_obj_arg s) {
-    lean_string_object *o = lean_to_string(s);
-    const unsigned char *p = (const unsigned char *)o->m_data;
-    const unsigned char *end = p + o->m_size - 1;
-    while (p < end) {
-        if (*p < 0x80) { p++; continue; }
-        if (*p < 0xC2) return 0;
-        if (*p < 0xE0) { if (end - p < 2 || (p[1] & 0xC0) != 0x80) return 0; p += 2; continue; }
-        if (*p < 0xF0) { if (end - p < 3 || (p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80) return 0; p += 3; continue; }
-        if (*p < 0xF5) { if (end - p < 4 || (p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80 || (p[3] & 0xC0) != 0x80) return 0; p += 4; continue; }
-        return 0;
-    }
-    return 1;
+/* String.validateUTF8 takes the ByteArray to be checked. */
+LEAN_EXPORT uint8_t lean_string_validate_utf8(b_lean_obj_arg a) {
+    lean_sarray_object *o = lean_to_sarray(a);
+    size_t len;
+    return utf8_scan(o->m_data, o->m_size, &len);
 }
 
 LEAN_EXPORT lean_obj_res lean_string_from_utf8_unchecked(lean_obj_arg ba) {
     lean_sarray_object *o = lean_to_sarray(ba);
-    lean_obj_res s = lean_mk_string_from_bytes((const char *)o->m_data, o->m_size);
+    const char *p = (const char *)o->m_data;
+    lean_obj_res s = lean_mk_string_unchecked(p, o->m_size, lean_utf8_n_strlen(p, o->m_size));
     lean_dec(ba);
     return s;
 }
@@ -870,44 +1931,439 @@ LEAN_EXPORT lean_obj_res lean_string_to_utf8(lean_obj_arg s) {
     return ba;
 }
 
+/* String.Slice is a ctor {str, startInclusive, endExclusive}; the
+   positions are byte offsets into str. A slice hashes like the string
+   made of its bytes. */
+static const char *slice_bytes(b_lean_obj_arg s, size_t *len) {
+    const char *str = lean_string_cstr(lean_ctor_get(s, 0));
+    size_t start = lean_unbox(lean_ctor_get(s, 1));
+    size_t end = lean_unbox(lean_ctor_get(s, 2));
+    *len = end > start ? end - start : 0;
+    return str + start;
+}
+
 LEAN_EXPORT uint64_t lean_slice_hash(b_lean_obj_arg s) {
-    return lean_string_hash(s); /* simplified */
+    size_t n;
+    const char *p = slice_bytes(s, &n);
+    return hash_bytes((const uint8_t *)p, n);
 }
 
 LEAN_EXPORT uint8_t lean_slice_dec_lt(b_lean_obj_arg s1, b_lean_obj_arg s2) {
-    return lean_string_lt(s1, s2);
+    size_t n1, n2;
+    const char *p1 = slice_bytes(s1, &n1);
+    const char *p2 = slice_bytes(s2, &n2);
+    int c = memcmp(p1, p2, n1 < n2 ? n1 : n2);
+    return c < 0 || (c == 0 && n1 < n2);
 }
 
 /* ================================================================
- *  8. Nat / Int Big Number Stubs
+ *  8. Nat / Int Big Numbers
  * ================================================================ */
 
-/* Our crypto code uses only small nats. Big nat operations abort. */
+/*
+ * Arbitrary-precision Nat and Int.
+ *
+ * Values outside the scalar range are LeanMPZ objects (lean_mpz_object,
+ * section 2): sign and magnitude, with 32-bit digits so that products fit
+ * a uint64_t on wasm32. Results are always normalized: a value that fits a
+ * scalar is boxed, so a big Nat is above LEAN_MAX_SMALL_NAT and a big Int
+ * lies outside [LEAN_MIN_SMALL_INT, LEAN_MAX_SMALL_INT]. lean_nat_to_int
+ * passes a big Nat through unchanged, so every big Nat is also a valid Int.
+ *
+ * Operands are read through a big_view, which also covers scalars, and
+ * results are computed into a scratch buffer that stays on the stack up to
+ * BIG_STACK_DIGITS digits, then copied into an exactly sized object. The
+ * 256- and 512-bit values of field arithmetic therefore cost one
+ * allocation per operation, and 256-bit products use an unrolled 8×8
+ * digit multiply.
+ */
+#define BIG_STACK_DIGITS 48
+#define BIG_FIXED_DIGITS 8
 
-static lean_object *big_nat_panic(const char *fn) {
-    fprintf(stderr, "WASM: big nat operation not supported: %s\n", fn);
-    abort();
-    return NULL;
+typedef struct {
+    const uint32_t *d;
+    size_t          n;      /* digits, top digit nonzero; 0 for zero */
+    bool            neg;
+    uint32_t        buf[2]; /* digits of a scalar */
+} big_view;
+
+typedef struct {
+    uint32_t *d;
+    uint32_t  stack[BIG_STACK_DIGITS];
+} big_scratch;
+
+static inline size_t big_trim(const uint32_t *d, size_t n) {
+    while (n > 0 && d[n - 1] == 0) n--;
+    return n;
+}
+
+static void big_view_u64(big_view *v, uint64_t m, bool neg) {
+    v->buf[0] = (uint32_t)m;
+    v->buf[1] = (uint32_t)(m >> 32);
+    v->d = v->buf;
+    v->n = big_trim(v->buf, 2);
+    v->neg = neg && v->n > 0;
+}
+
+static void big_view_nat(big_view *v, b_lean_obj_arg a) {
+    if (lean_is_scalar(a)) {
+        big_view_u64(v, lean_unbox(a), false);
+    } else {
+        lean_mpz_object *m = (lean_mpz_object *)a;
+        v->d = m->m_digits;
+        v->n = m->m_size;
+        v->neg = false;
+    }
+}
+
+static void big_view_int(big_view *v, b_lean_obj_arg a) {
+    if (lean_is_scalar(a)) {
+        int64_t i = lean_scalar_to_int64(a);
+        big_view_u64(v, i < 0 ? -(uint64_t)i : (uint64_t)i, i < 0);
+    } else {
+        lean_mpz_object *m = (lean_mpz_object *)a;
+        v->d = m->m_digits;
+        v->n = m->m_size;
+        v->neg = m->m_sign;
+    }
+}
+
+static uint32_t *big_scratch_get(big_scratch *s, size_t n) {
+    if (n <= BIG_STACK_DIGITS) {
+        s->d = s->stack;
+    } else {
+        s->d = (uint32_t *)malloc(sizeof(uint32_t) * n);
+        if (!s->d) lean_internal_panic_out_of_memory();
+    }
+    return s->d;
+}
+
+static inline void big_scratch_done(big_scratch *s) {
+    if (s->d != s->stack) free(s->d);
+}
+
+/* Box the value if it fits a scalar, otherwise copy it into a new
+   LeanMPZ object. Only Ints can be negative. */
+static lean_object *big_make(const uint32_t *d, size_t n, bool neg, bool is_int) {
+    n = big_trim(d, n);
+    if (n == 0) return lean_box(0);
+    if (n <= 2) {
+        uint64_t m = d[0] | (n > 1 ? (uint64_t)d[1] << 32 : 0);
+        if (!is_int) {
+            if (m <= LEAN_MAX_SMALL_NAT) return lean_box((size_t)m);
+        } else if (neg ? m <= (uint64_t)-(int64_t)LEAN_MIN_SMALL_INT
+                       : m <= (uint64_t)LEAN_MAX_SMALL_INT) {
+            return lean_int64_to_int(neg ? -(int64_t)m : (int64_t)m);
+        }
+    }
+    lean_mpz_object *o = (lean_mpz_object *)lean_alloc_object(sizeof(lean_mpz_object) + sizeof(uint32_t) * n);
+    lean_set_st_header((lean_object *)o, LeanMPZ, 0);
+    o->m_sign = is_int && neg;
+    o->m_size = n;
+    o->m_digits = o->m_data;
+    memcpy(o->m_data, d, sizeof(uint32_t) * n);
+    return (lean_object *)o;
 }
 
-LEAN_EXPORT lean_object *lean_nat_big_succ(lean_object *a) { return big_nat_panic("lean_nat_big_succ"); (void)a; }
-LEAN_EXPORT lean_object *lean_nat_big_add(lean_object *a1, lean_object *a2) { (void)a1; (void)a2; return big_nat_panic("lean_nat_big_add"); }
-LEAN_EXPORT lean_object *lean_nat_big_sub(lean_object *a1, lean_object *a2) { (void)a1; (void)a2; return big_nat_panic("lean_nat_big_sub"); }
-LEAN_EXPORT lean_object *lean_nat_big_mul(lean_object *a1, lean_object *a2) { (void)a1; (void)a2; return big_nat_panic("lean_nat_big_mul"); }
-LEAN_EXPORT lean_object *lean_nat_overflow_mul(size_t a1, size_t a2) { (void)a1; (void)a2; return big_nat_panic("lean_nat_overflow_mul"); }
-LEAN_EXPORT lean_object *lean_nat_big_div(lean_object *a1, lean_object *a2) { (void)a1; (void)a2; return big_nat_panic("lean_nat_big_div"); }
-LEAN_EXPORT lean_object *lean_nat_big_div_exact(lean_object *a1, lean_object *a2) { (void)a1; (void)a2; return big_nat_panic("lean_nat_big_div_exact"); }
-LEAN_EXPORT lean_object *lean_nat_big_mod(lean_object *a1, lean_object *a2) { (void)a1; (void)a2; return big_nat_panic("lean_nat_big_mod"); }
-LEAN_EXPORT bool lean_nat_big_eq(lean_object *a1, lean_object *a2) { (void)a1; (void)a2; big_nat_panic("lean_nat_big_eq"); return 0; }
-LEAN_EXPORT bool lean_nat_big_le(lean_object *a1, lean_object *a2) { (void)a1; (void)a2; big_nat_panic("lean_nat_big_le"); return 0; }
-LEAN_EXPORT bool lean_nat_big_lt(lean_object *a1, lean_object *a2) { (void)a1; (void)a2; big_nat_panic("lean_nat_big_lt"); return 0; }
-LEAN_EXPORT lean_object *lean_nat_big_land(lean_object *a1, lean_object *a2) { (void)a1; (void)a2; return big_nat_panic("lean_nat_big_land"); }
-LEAN_EXPORT lean_object *lean_nat_big_lor(lean_object *a1, lean_object *a2) { (void)a1; (void)a2; return big_nat_panic("lean_nat_big_lor"); }
-LEAN_EXPORT lean_object *lean_nat_big_xor(lean_object *a1, lean_object *a2) { (void)a1; (void)a2; return big_nat_panic("lean_nat_big_xor"); }
-LEAN_EXPORT lean_obj_res lean_nat_big_shiftr(b_lean_obj_arg a1, b_lean_obj_arg a2) { (void)a1; (void)a2; return big_nat_panic("lean_nat_big_shiftr"); }
-
-LEAN_EXPORT lean_obj_res lean_big_usize_to_nat(size_t n) { (void)n; return big_nat_panic("lean_big_usize_to_nat"); }
-LEAN_EXPORT lean_obj_res lean_big_uint64_to_nat(uint64_t n) { (void)n; return big_nat_panic("lean_big_uint64_to_nat"); }
+static inline lean_object *big_make_view(const big_view *v, bool neg, bool is_int) {
+    return big_make(v->d, v->n, neg, is_int);
+}
+
+/* ── Digit-vector primitives (magnitudes only) ───────────────── */
+
+static int big_cmp(const uint32_t *a, size_t an, const uint32_t *b, size_t bn) {
+    if (an != bn) return an < bn ? -1 : 1;
+    while (an-- > 0)
+        if (a[an] != b[an]) return a[an] < b[an] ? -1 : 1;
+    return 0;
+}
+
+/* r = a + b. r has room for max(an, bn) + 1 digits and may alias a or b. */
+static size_t big_add(uint32_t *r, const uint32_t *a, size_t an, const uint32_t *b, size_t bn) {
+    if (an < bn) {
+        const uint32_t *t = a; a = b; b = t;
+        size_t tn = an; an = bn; bn = tn;
+    }
+    uint64_t c = 0;
+    size_t i = 0;
+    for (; i < bn; i++) { c += (uint64_t)a[i] + b[i]; r[i] = (uint32_t)c; c >>= 32; }
+    for (; i < an; i++) { c += a[i]; r[i] = (uint32_t)c; c >>= 32; }
+    r[an] = (uint32_t)c;
+    return an + 1;
+}
+
+/* r = a - b for a >= b. r has room for an digits and may alias a or b. */
+static size_t big_sub(uint32_t *r, const uint32_t *a, size_t an, const uint32_t *b, size_t bn) {
+    uint64_t borrow = 0;
+    size_t i = 0;
+    for (; i < bn; i++) { uint64_t t = (uint64_t)a[i] - b[i] - borrow; r[i] = (uint32_t)t; borrow = t >> 63; }
+    for (; i < an; i++) { uint64_t t = (uint64_t)a[i] - borrow; r[i] = (uint32_t)t; borrow = t >> 63; }
+    return an;
+}
+
+/* 256 × 256 → 512 bits, with constant bounds so the compiler unrolls it. */
+static void big_mul_fixed(uint32_t *r, const uint32_t *a, const uint32_t *b) {
+    memset(r, 0, sizeof(uint32_t) * 2 * BIG_FIXED_DIGITS);
+    for (size_t i = 0; i < BIG_FIXED_DIGITS; i++) {
+        uint64_t c = 0, ai = a[i];
+        for (size_t j = 0; j < BIG_FIXED_DIGITS; j++) {
+            c += ai * b[j] + r[i + j];
+            r[i + j] = (uint32_t)c;
+            c >>= 32;
+        }
+        r[i + BIG_FIXED_DIGITS] = (uint32_t)c;
+    }
+}
+
+/* r = a * b (schoolbook). r has room for an + bn digits and must not
+   alias a or b. */
+static size_t big_mul(uint32_t *r, const uint32_t *a, size_t an, const uint32_t *b, size_t bn) {
+    if (an > BIG_FIXED_DIGITS / 2 && bn > BIG_FIXED_DIGITS / 2 &&
+        an <= BIG_FIXED_DIGITS && bn <= BIG_FIXED_DIGITS) {
+        uint32_t x[BIG_FIXED_DIGITS] = {0}, y[BIG_FIXED_DIGITS] = {0};
+        uint32_t p[2 * BIG_FIXED_DIGITS];
+        memcpy(x, a, sizeof(uint32_t) * an);
+        memcpy(y, b, sizeof(uint32_t) * bn);
+        big_mul_fixed(p, x, y);
+        memcpy(r, p, sizeof(uint32_t) * (an + bn));
+        return an + bn;
+    }
+    memset(r, 0, sizeof(uint32_t) * (an + bn));
+    for (size_t i = 0; i < an; i++) {
+        uint64_t c = 0, ai = a[i];
+        if (ai == 0) continue;
+        for (size_t j = 0; j < bn; j++) {
+            c += ai * b[j] + r[i + j];
+            r[i + j] = (uint32_t)c;
+            c >>= 32;
+        }
+        r[i + bn] = (uint32_t)c;
+    }
+    return an + bn;
+}
+
+/*
+ * q = a / b and r = a % b for an >= bn >= 1 (Knuth's algorithm D, as in
+ * Hacker's Delight). q has room for an - bn + 1 digits, r for bn.
+ */
+static void big_divmod(uint32_t *q, uint32_t *r, const uint32_t *a, size_t an,
+                       const uint32_t *b, size_t bn) {
+    if (bn == 1) {
+        uint64_t rem = 0;
+        for (size_t i = an; i-- > 0;) {
+            rem = (rem << 32) | a[i];
+            q[i] = (uint32_t)(rem / b[0]);
+            rem %= b[0];
+        }
+        r[0] = (uint32_t)rem;
+        return;
+    }
+    /* Normalize so the divisor's top bit is set. */
+    big_scratch s;
+    uint32_t *un = big_scratch_get(&s, an + 1 + bn);
+    uint32_t *vn = un + an + 1;
+    unsigned sh = (unsigned)__builtin_clz(b[bn - 1]);
+    for (size_t i = bn - 1; i > 0; i--)
+        vn[i] = (b[i] << sh) | (sh ? b[i - 1] >> (32 - sh) : 0);
+    vn[0] = b[0] << sh;
+    un[an] = sh ? a[an - 1] >> (32 - sh) : 0;
+    for (size_t i = an - 1; i > 0; i--)
+        un[i] = (a[i] << sh) | (sh ? a[i - 1] >> (32 - sh) : 0);
+    un[0] = a[0] << sh;
+
+    for (size_t j = an - bn + 1; j-- > 0;) {
+        uint64_t num = ((uint64_t)un[j + bn] << 32) | un[j + bn - 1];
+        uint64_t qhat = num / vn[bn - 1];
+        uint64_t rhat = num % vn[bn - 1];
+        while ((qhat >> 32) || qhat * vn[bn - 2] > ((rhat << 32) | un[j + bn - 2])) {
+            qhat--;
+            rhat += vn[bn - 1];
+            if (rhat >> 32) break;
+        }
+        /* un[j .. j+bn] -= qhat * vn */
+        int64_t k = 0, t;
+        for (size_t i = 0; i < bn; i++) {
+            uint64_t p = qhat * vn[i];
+            t = (int64_t)un[i + j] - k - (int64_t)(p & 0xFFFFFFFFu);
+            un[i + j] = (uint32_t)t;
+            k = (int64_t)(p >> 32) - (t >> 32);
+        }
+        t = (int64_t)un[j + bn] - k;
+        un[j + bn] = (uint32_t)t;
+        q[j] = (uint32_t)qhat;
+        if (t < 0) {
+            /* qhat was one too large: add the divisor back. */
+            q[j]--;
+            uint64_t c = 0;
+            for (size_t i = 0; i < bn; i++) {
+                c += (uint64_t)un[i + j] + vn[i];
+                un[i + j] = (uint32_t)c;
+                c >>= 32;
+            }
+            un[j + bn] += (uint32_t)c;
+        }
+    }
+    for (size_t i = 0; i < bn; i++)
+        r[i] = (un[i] >> sh) | (sh ? un[i + 1] << (32 - sh) : 0);
+    big_scratch_done(&s);
+}
+
+/* Quotient and remainder of |x| / |y| for y != 0. q has room for
+   x->n + 1 digits, r for y->n. */
+static void big_divmod_view(const big_view *x, const big_view *y,
+                            uint32_t *q, size_t *qn, uint32_t *r, size_t *rn) {
+    if (big_cmp(x->d, x->n, y->d, y->n) < 0) {
+        *qn = 0;
+        if (x->n) memcpy(r, x->d, sizeof(uint32_t) * x->n);
+        *rn = x->n;
+        return;
+    }
+    big_divmod(q, r, x->d, x->n, y->d, y->n);
+    *qn = big_trim(q, x->n - y->n + 1);
+    *rn = big_trim(r, y->n);
+}
+
+static inline size_t big_bit_length(const big_view *v) {
+    return v->n ? (v->n - 1) * 32 + (32 - (size_t)__builtin_clz(v->d[v->n - 1])) : 0;
+}
+
+/* ── Nat ─────────────────────────────────────────────────────── */
+
+LEAN_EXPORT lean_object *lean_nat_big_succ(lean_object *a) {
+    return lean_nat_big_add(a, lean_box(1));
+}
+
+LEAN_EXPORT lean_object *lean_nat_big_add(lean_object *a1, lean_object *a2) {
+    big_view x, y;
+    big_view_nat(&x, a1);
+    big_view_nat(&y, a2);
+    big_scratch s;
+    uint32_t *r = big_scratch_get(&s, (x.n > y.n ? x.n : y.n) + 1);
+    lean_object *res = big_make(r, big_add(r, x.d, x.n, y.d, y.n), false, false);
+    big_scratch_done(&s);
+    return res;
+}
+
+LEAN_EXPORT lean_object *lean_nat_big_sub(lean_object *a1, lean_object *a2) {
+    big_view x, y;
+    big_view_nat(&x, a1);
+    big_view_nat(&y, a2);
+    if (big_cmp(x.d, x.n, y.d, y.n) <= 0) return lean_box(0);
+    big_scratch s;
+    uint32_t *r = big_scratch_get(&s, x.n);
+    lean_object *res = big_make(r, big_sub(r, x.d, x.n, y.d, y.n), false, false);
+    big_scratch_done(&s);
+    return res;
+}
+
+LEAN_EXPORT lean_object *lean_nat_big_mul(lean_object *a1, lean_object *a2) {
+    big_view x, y;
+    big_view_nat(&x, a1);
+    big_view_nat(&y, a2);
+    if (x.n == 0 || y.n == 0) return lean_box(0);
+    big_scratch s;
+    uint32_t *r = big_scratch_get(&s, x.n + y.n);
+    lean_object *res = big_make(r, big_mul(r, x.d, x.n, y.d, y.n), false, false);
+    big_scratch_done(&s);
+    return res;
+}
+
+/* Scalar product that overflowed LEAN_MAX_SMALL_NAT (or size_t). */
+LEAN_EXPORT lean_object *lean_nat_overflow_mul(size_t a1, size_t a2) {
+    big_view x, y;
+    big_view_u64(&x, a1, false);
+    big_view_u64(&y, a2, false);
+    uint32_t r[4];
+    return big_make(r, big_mul(r, x.d, x.n, y.d, y.n), false, false);
+}
+
+/* n / 0 = 0 and n % 0 = n, as for scalars. */
+static lean_object *nat_big_divmod(lean_object *a1, lean_object *a2, bool want_mod) {
+    big_view x, y;
+    big_view_nat(&x, a1);
+    big_view_nat(&y, a2);
+    if (y.n == 0) {
+        if (!want_mod) return lean_box(0);
+        lean_inc(a1);
+        return a1;
+    }
+    big_scratch s;
+    uint32_t *q = big_scratch_get(&s, x.n + 1 + y.n);
+    uint32_t *r = q + x.n + 1;
+    size_t qn, rn;
+    big_divmod_view(&x, &y, q, &qn, r, &rn);
+    lean_object *res = want_mod ? big_make(r, rn, false, false) : big_make(q, qn, false, false);
+    big_scratch_done(&s);
+    return res;
+}
+
+LEAN_EXPORT lean_object *lean_nat_big_div(lean_object *a1, lean_object *a2) { return nat_big_divmod(a1, a2, false); }
+LEAN_EXPORT lean_object *lean_nat_big_div_exact(lean_object *a1, lean_object *a2) { return nat_big_divmod(a1, a2, false); }
+LEAN_EXPORT lean_object *lean_nat_big_mod(lean_object *a1, lean_object *a2) { return nat_big_divmod(a1, a2, true); }
+
+static int nat_big_cmp(lean_object *a1, lean_object *a2) {
+    big_view x, y;
+    big_view_nat(&x, a1);
+    big_view_nat(&y, a2);
+    return big_cmp(x.d, x.n, y.d, y.n);
+}
+
+LEAN_EXPORT bool lean_nat_big_eq(lean_object *a1, lean_object *a2) { return nat_big_cmp(a1, a2) == 0; }
+LEAN_EXPORT bool lean_nat_big_le(lean_object *a1, lean_object *a2) { return nat_big_cmp(a1, a2) <= 0; }
+LEAN_EXPORT bool lean_nat_big_lt(lean_object *a1, lean_object *a2) { return nat_big_cmp(a1, a2) < 0; }
+
+enum { BIG_AND, BIG_OR, BIG_XOR };
+
+static lean_object *nat_big_bitwise(lean_object *a1, lean_object *a2, int op) {
+    big_view x, y;
+    big_view_nat(&x, a1);
+    big_view_nat(&y, a2);
+    size_t n = op == BIG_AND ? (x.n < y.n ? x.n : y.n) : (x.n > y.n ? x.n : y.n);
+    big_scratch s = {0};
+    uint32_t *r = big_scratch_get(&s, n);
+    for (size_t i = 0; i < n; i++) {
+        uint32_t u = i < x.n ? x.d[i] : 0, v = i < y.n ? y.d[i] : 0;
+        r[i] = op == BIG_AND ? (u & v) : op == BIG_OR ? (u | v) : (u ^ v);
+    }
+    lean_object *res = big_make(r, n, false, false);
+    big_scratch_done(&s);
+    return res;
+}
+
+LEAN_EXPORT lean_object *lean_nat_big_land(lean_object *a1, lean_object *a2) { return nat_big_bitwise(a1, a2, BIG_AND); }
+LEAN_EXPORT lean_object *lean_nat_big_lor(lean_object *a1, lean_object *a2) { return nat_big_bitwise(a1, a2, BIG_OR); }
+LEAN_EXPORT lean_object *lean_nat_big_xor(lean_object *a1, lean_object *a2) { return nat_big_bitwise(a1, a2, BIG_XOR); }
+
+LEAN_EXPORT lean_obj_res lean_nat_big_shiftr(b_lean_obj_arg a1, b_lean_obj_arg a2) {
+    if (!lean_is_scalar(a2)) return lean_box(0);
+    big_view x;
+    big_view_nat(&x, a1);
+    size_t sh = lean_unbox(a2), ds = sh / 32;
+    unsigned bs = (unsigned)(sh % 32);
+    if (ds >= x.n) return lean_box(0);
+    size_t n = x.n - ds;
+    big_scratch s;
+    uint32_t *r = big_scratch_get(&s, n);
+    for (size_t i = 0; i < n; i++) {
+        uint32_t hi = i + 1 < n ? x.d[ds + i + 1] : 0;
+        r[i] = (x.d[ds + i] >> bs) | (bs ? hi << (32 - bs) : 0);
+    }
+    lean_object *res = big_make(r, n, false, false);
+    big_scratch_done(&s);
+    return res;
+}
+
+/* Above LEAN_MAX_SMALL_NAT, which on wasm32 is only 2^31 - 1: sizes,
+   lengths and counters past 2 GiB end up here. */
+LEAN_EXPORT lean_obj_res lean_big_usize_to_nat(size_t n) {
+    return lean_big_uint64_to_nat(n);
+}
+
+LEAN_EXPORT lean_obj_res lean_big_uint64_to_nat(uint64_t n) {
+    big_view x;
+    big_view_u64(&x, n, false);
+    return big_make_view(&x, false, false);
+}
 
 LEAN_EXPORT lean_obj_res lean_nat_shiftl(b_lean_obj_arg a1, b_lean_obj_arg a2) {
     if (lean_is_scalar(a1) && lean_is_scalar(a2)) {
@@ -919,69 +2375,123 @@ LEAN_EXPORT lean_obj_res lean_nat_shiftl(b_lean_obj_arg a1, b_lean_obj_arg a2) {
                 return lean_box(r);
         }
     }
-    return big_nat_panic("lean_nat_shiftl (overflow)");
+    big_view x;
+    big_view_nat(&x, a1);
+    if (x.n == 0) return lean_box(0);
+    if (!lean_is_scalar(a2)) lean_internal_panic_out_of_memory();
+    size_t sh = lean_unbox(a2), ds = sh / 32;
+    unsigned bs = (unsigned)(sh % 32);
+    if (ds > SIZE_MAX / (3 * sizeof(uint32_t)) - x.n) lean_internal_panic_out_of_memory();
+    size_t n = x.n + ds + 1;
+    big_scratch s;
+    uint32_t *r = big_scratch_get(&s, n);
+    memset(r, 0, sizeof(uint32_t) * ds);
+    uint32_t carry = 0;
+    for (size_t i = 0; i < x.n; i++) {
+        r[ds + i] = (x.d[i] << bs) | carry;
+        carry = bs ? x.d[i] >> (32 - bs) : 0;
+    }
+    r[ds + x.n] = carry;
+    lean_object *res = big_make(r, n, false, false);
+    big_scratch_done(&s);
+    return res;
 }
 
+/* Square-and-multiply; stays in size_t while the result fits a scalar. */
 LEAN_EXPORT lean_obj_res lean_nat_pow(b_lean_obj_arg a1, b_lean_obj_arg a2) {
-    if (lean_is_scalar(a1) && lean_is_scalar(a2)) {
-        size_t base = lean_unbox(a1);
-        size_t exp = lean_unbox(a2);
-        size_t result = 1;
-        for (size_t i = 0; i < exp; i++) {
-            result *= base;
-            if (result > LEAN_MAX_SMALL_NAT)
-                return big_nat_panic("lean_nat_pow (overflow)");
+    big_view x;
+    big_view_nat(&x, a1);
+    if (!lean_is_scalar(a2)) {
+        /* Only 0 and 1 have a representable power this large. */
+        if (x.n == 0 || (x.n == 1 && x.d[0] == 1)) { lean_inc(a1); return a1; }
+        lean_internal_panic_out_of_memory();
+    }
+    size_t e = lean_unbox(a2);
+    if (lean_is_scalar(a1)) {
+        size_t base = lean_unbox(a1), result = 1, k = e;
+        bool fits = true;
+        while (k) {
+            if ((k & 1) && (__builtin_mul_overflow(result, base, &result) || result > LEAN_MAX_SMALL_NAT)) {
+                fits = false;
+                break;
+            }
+            k >>= 1;
+            if (k && (__builtin_mul_overflow(base, base, &base) || base > LEAN_MAX_SMALL_NAT)) {
+                fits = false;
+                break;
+            }
         }
-        return lean_box(result);
+        if (fits) return lean_box(result);
     }
-    return big_nat_panic("lean_nat_pow (big)");
+    /* Every intermediate is at most x^e, which has at most e * bits(x) bits. */
+    size_t bits;
+    if (__builtin_mul_overflow(e, big_bit_length(&x), &bits) || bits / 32 > SIZE_MAX / 12)
+        lean_internal_panic_out_of_memory();
+    size_t cap = bits / 32 + 2;
+    big_scratch s;
+    uint32_t *res = big_scratch_get(&s, 3 * cap), *base = res + cap, *tmp = base + cap;
+    size_t rn = 1, bn = x.n;
+    res[0] = 1;
+    memcpy(base, x.d, sizeof(uint32_t) * x.n);
+    while (e) {
+        if (e & 1) {
+            size_t n = big_trim(tmp, big_mul(tmp, res, rn, base, bn));
+            uint32_t *t = res; res = tmp; tmp = t; rn = n;
+        }
+        e >>= 1;
+        if (e) {
+            size_t n = big_trim(tmp, big_mul(tmp, base, bn, base, bn));
+            uint32_t *t = base; base = tmp; tmp = t; bn = n;
+        }
+    }
+    lean_object *r = big_make(res, rn, false, false);
+    big_scratch_done(&s);
+    return r;
 }
 
 LEAN_EXPORT lean_obj_res lean_nat_log2(b_lean_obj_arg a) {
-    if (lean_is_scalar(a)) {
-        size_t v = lean_unbox(a);
-        if (v == 0) return lean_box(0);
-        size_t r = 0;
-        while (v > 1) { v >>= 1; r++; }
-        return lean_box(r);
-    }
-    return big_nat_panic("lean_nat_log2 (big)");
+    big_view x;
+    big_view_nat(&x, a);
+    size_t bits = big_bit_length(&x);
+    return lean_usize_to_nat(bits ? bits - 1 : 0);
 }
 
+/* Decimal digits are consumed nine at a time: r = r * 10^k + chunk. */
 LEAN_EXPORT lean_obj_res lean_cstr_to_nat(const char *n) {
-    size_t val = 0;
-    while (*n >= '0' && *n <= '9') {
-        size_t d = (size_t)(*n - '0');
-        val = val * 10 + d;
-        n++;
+    size_t len = 0;
+    while (n[len] >= '0' && n[len] <= '9') len++;
+    big_scratch s = {0};
+    uint32_t *r = big_scratch_get(&s, len / 9 + 2);
+    size_t rn = 0;
+    for (size_t i = 0; i < len;) {
+        uint32_t chunk = 0, scale = 1;
+        for (unsigned k = 0; k < 9 && i < len; k++, i++) {
+            chunk = chunk * 10 + (uint32_t)(n[i] - '0');
+            scale *= 10;
+        }
+        uint64_t c = chunk;
+        for (size_t j = 0; j < rn; j++) {
+            c += (uint64_t)r[j] * scale;
+            r[j] = (uint32_t)c;
+            c >>= 32;
+        }
+        if (c) r[rn++] = (uint32_t)c;
     }
-    return lean_box(val);
+    lean_object *res = big_make(r, rn, false, false);
+    big_scratch_done(&s);
+    return res;
 }
 
-LEAN_EXPORT size_t lean_usize_of_big_nat(b_lean_obj_arg a) {
-    (void)a;
-    big_nat_panic("lean_usize_of_big_nat");
-    return 0;
+/* Conversions to fixed-width integers keep the low bits (n mod 2^w). */
+static uint64_t big_low_u64(b_lean_obj_arg a) {
+    big_view x;
+    big_view_nat(&x, a);
+    return (x.n > 0 ? x.d[0] : 0) | (x.n > 1 ? (uint64_t)x.d[1] << 32 : 0);
 }
 
-/* Int big number stubs */
-LEAN_EXPORT lean_object *lean_int_big_neg(lean_object *a) { (void)a; return big_nat_panic("lean_int_big_neg"); }
-LEAN_EXPORT lean_object *lean_int_big_add(lean_object *a1, lean_object *a2) { (void)a1; (void)a2; return big_nat_panic("lean_int_big_add"); }
-LEAN_EXPORT lean_object *lean_int_big_sub(lean_object *a1, lean_object *a2) { (void)a1; (void)a2; return big_nat_panic("lean_int_big_sub"); }
-LEAN_EXPORT lean_object *lean_int_big_mul(lean_object *a1, lean_object *a2) { (void)a1; (void)a2; return big_nat_panic("lean_int_big_mul"); }
-LEAN_EXPORT lean_object *lean_int_big_div(lean_object *a1, lean_object *a2) { (void)a1; (void)a2; return big_nat_panic("lean_int_big_div"); }
-LEAN_EXPORT lean_object *lean_int_big_div_exact(lean_object *a1, lean_object *a2) { (void)a1; (void)a2; return big_nat_panic("lean_int_big_div_exact"); }
-LEAN_EXPORT lean_object *lean_int_big_mod(lean_object *a1, lean_object *a2) { (void)a1; (void)a2; return big_nat_panic("lean_int_big_mod"); }
-LEAN_EXPORT lean_object *lean_int_big_ediv(lean_object *a1, lean_object *a2) { (void)a1; (void)a2; return big_nat_panic("lean_int_big_ediv"); }
-LEAN_EXPORT lean_object *lean_int_big_emod(lean_object *a1, lean_object *a2) { (void)a1; (void)a2; return big_nat_panic("lean_int_big_emod"); }
-LEAN_EXPORT bool lean_int_big_eq(lean_object *a1, lean_object *a2) { (void)a1; (void)a2; big_nat_panic("lean_int_big_eq"); return 0; }
-LEAN_EXPORT bool lean_int_big_le(lean_object *a1, lean_object *a2) { (void)a1; (void)a2; big_nat_panic("lean_int_big_le"); return 0; }
-LEAN_EXPORT bool lean_int_big_lt(lean_object *a1, lean_object *a2) { (void)a1; (void)a2; big_nat_panic("lean_int_big_lt"); return 0; }
-LEAN_EXPORT bool lean_int_big_nonneg(lean_object *a) { (void)a; big_nat_panic("lean_int_big_nonneg"); return 0; }
-LEAN_EXPORT lean_object *lean_big_int_to_int(int n) { (void)n; return big_nat_panic("lean_big_int_to_int"); }
-LEAN_EXPORT lean_object *lean_big_size_t_to_int(size_t n) { (void)n; return big_nat_panic("lean_big_size_t_to_int"); }
-LEAN_EXPORT lean_object *lean_big_int64_to_int(int64_t n) { (void)n; return big_nat_panic("lean_big_int64_to_int"); }
-LEAN_EXPORT lean_obj_res lean_big_int_to_nat(lean_obj_arg a) { (void)a; return big_nat_panic("lean_big_int_to_nat"); }
+LEAN_EXPORT size_t lean_usize_of_big_nat(b_lean_obj_arg a) {
+    return (size_t)big_low_u64(a);
+}
 
 LEAN_EXPORT lean_obj_res lean_nat_gcd(b_lean_obj_arg a1, b_lean_obj_arg a2) {
     if (lean_is_scalar(a1) && lean_is_scalar(a2)) {
@@ -989,7 +2499,151 @@ LEAN_EXPORT lean_obj_res lean_nat_gcd(b_lean_obj_arg a1, b_lean_obj_arg a2) {
         while (y) { size_t t = y; y = x % y; x = t; }
         return lean_box(x);
     }
-    return big_nat_panic("lean_nat_gcd (big)");
+    big_view x, y;
+    big_view_nat(&x, a1);
+    big_view_nat(&y, a2);
+    size_t cap = (x.n > y.n ? x.n : y.n) + 1;
+    big_scratch s;
+    uint32_t *a = big_scratch_get(&s, 4 * cap), *b = a + cap, *t = b + cap, *q = t + cap;
+    size_t an = x.n, bn = y.n;
+    if (an) memcpy(a, x.d, sizeof(uint32_t) * an);
+    if (bn) memcpy(b, y.d, sizeof(uint32_t) * bn);
+    while (bn > 0) {
+        big_view va = { a, an, false, {0, 0} }, vb = { b, bn, false, {0, 0} };
+        size_t qn, tn;
+        big_divmod_view(&va, &vb, q, &qn, t, &tn);
+        uint32_t *old = a;
+        a = b; an = bn;
+        b = t; bn = tn;
+        t = old;
+    }
+    lean_object *res = big_make(a, an, false, false);
+    big_scratch_done(&s);
+    return res;
+}
+
+/* ── Int ─────────────────────────────────────────────────────── */
+
+LEAN_EXPORT lean_object *lean_int_big_neg(lean_object *a) {
+    big_view x;
+    big_view_int(&x, a);
+    return big_make_view(&x, !x.neg, true);
+}
+
+/* x + (-1)^yneg |y| in sign-magnitude form. */
+static lean_object *int_big_add_signed(lean_object *a1, lean_object *a2, bool negate) {
+    big_view x, y;
+    big_view_int(&x, a1);
+    big_view_int(&y, a2);
+    bool yneg = y.neg != negate;
+    big_scratch s;
+    uint32_t *r = big_scratch_get(&s, (x.n > y.n ? x.n : y.n) + 1);
+    lean_object *res;
+    if (x.neg == yneg) {
+        res = big_make(r, big_add(r, x.d, x.n, y.d, y.n), x.neg, true);
+    } else if (big_cmp(x.d, x.n, y.d, y.n) >= 0) {
+        res = big_make(r, big_sub(r, x.d, x.n, y.d, y.n), x.neg, true);
+    } else {
+        res = big_make(r, big_sub(r, y.d, y.n, x.d, x.n), yneg, true);
+    }
+    big_scratch_done(&s);
+    return res;
+}
+
+LEAN_EXPORT lean_object *lean_int_big_add(lean_object *a1, lean_object *a2) { return int_big_add_signed(a1, a2, false); }
+LEAN_EXPORT lean_object *lean_int_big_sub(lean_object *a1, lean_object *a2) { return int_big_add_signed(a1, a2, true); }
+
+LEAN_EXPORT lean_object *lean_int_big_mul(lean_object *a1, lean_object *a2) {
+    big_view x, y;
+    big_view_int(&x, a1);
+    big_view_int(&y, a2);
+    if (x.n == 0 || y.n == 0) return lean_box(0);
+    big_scratch s;
+    uint32_t *r = big_scratch_get(&s, x.n + y.n);
+    lean_object *res = big_make(r, big_mul(r, x.d, x.n, y.d, y.n), x.neg != y.neg, true);
+    big_scratch_done(&s);
+    return res;
+}
+
+/*
+ * div/mod round toward zero (the remainder takes the dividend's sign);
+ * ediv/emod are Euclidean (the remainder is never negative). Division by
+ * zero gives 0 and leaves the dividend as the remainder.
+ */
+static lean_object *int_big_divmod(lean_object *a1, lean_object *a2, bool euclid, bool want_mod) {
+    big_view x, y;
+    big_view_int(&x, a1);
+    big_view_int(&y, a2);
+    if (y.n == 0) {
+        if (!want_mod) return lean_box(0);
+        lean_inc(a1);
+        return a1;
+    }
+    big_scratch s;
+    uint32_t *q = big_scratch_get(&s, x.n + 2 + y.n);
+    uint32_t *r = q + x.n + 2;
+    size_t qn, rn;
+    big_divmod_view(&x, &y, q, &qn, r, &rn);
+    bool rneg = x.neg;
+    if (euclid) {
+        if (x.neg && rn > 0) {
+            /* Round the quotient away from zero: |q| + 1, |y| - r. */
+            static const uint32_t one = 1;
+            qn = big_add(q, q, qn, &one, 1);
+            rn = big_sub(r, y.d, y.n, r, rn);
+        }
+        rneg = false;
+    }
+    lean_object *res = want_mod ? big_make(r, rn, rneg, true) : big_make(q, qn, x.neg != y.neg, true);
+    big_scratch_done(&s);
+    return res;
+}
+
+LEAN_EXPORT lean_object *lean_int_big_div(lean_object *a1, lean_object *a2) { return int_big_divmod(a1, a2, false, false); }
+LEAN_EXPORT lean_object *lean_int_big_div_exact(lean_object *a1, lean_object *a2) { return int_big_divmod(a1, a2, false, false); }
+LEAN_EXPORT lean_object *lean_int_big_mod(lean_object *a1, lean_object *a2) { return int_big_divmod(a1, a2, false, true); }
+LEAN_EXPORT lean_object *lean_int_big_ediv(lean_object *a1, lean_object *a2) { return int_big_divmod(a1, a2, true, false); }
+LEAN_EXPORT lean_object *lean_int_big_emod(lean_object *a1, lean_object *a2) { return int_big_divmod(a1, a2, true, true); }
+
+static int int_big_cmp(lean_object *a1, lean_object *a2) {
+    big_view x, y;
+    big_view_int(&x, a1);
+    big_view_int(&y, a2);
+    if (x.neg != y.neg) return x.neg ? -1 : 1;
+    int c = big_cmp(x.d, x.n, y.d, y.n);
+    return x.neg ? -c : c;
+}
+
+LEAN_EXPORT bool lean_int_big_eq(lean_object *a1, lean_object *a2) { return int_big_cmp(a1, a2) == 0; }
+LEAN_EXPORT bool lean_int_big_le(lean_object *a1, lean_object *a2) { return int_big_cmp(a1, a2) <= 0; }
+LEAN_EXPORT bool lean_int_big_lt(lean_object *a1, lean_object *a2) { return int_big_cmp(a1, a2) < 0; }
+
+LEAN_EXPORT bool lean_int_big_nonneg(lean_object *a) {
+    big_view x;
+    big_view_int(&x, a);
+    return !x.neg;
+}
+
+LEAN_EXPORT lean_object *lean_big_int64_to_int(int64_t n) {
+    big_view x;
+    big_view_u64(&x, n < 0 ? -(uint64_t)n : (uint64_t)n, n < 0);
+    return big_make_view(&x, x.neg, true);
+}
+
+LEAN_EXPORT lean_object *lean_big_int_to_int(int n) { return lean_big_int64_to_int(n); }
+
+LEAN_EXPORT lean_object *lean_big_size_t_to_int(size_t n) {
+    big_view x;
+    big_view_u64(&x, n, false);
+    return big_make_view(&x, false, true);
+}
+
+LEAN_EXPORT lean_obj_res lean_big_int_to_nat(lean_obj_arg a) {
+    big_view x;
+    big_view_int(&x, a);
+    lean_object *res = x.neg ? lean_box(0) : big_make_view(&x, false, false);
+    lean_dec(a);
+    return res;
 }
 
 /* ================================================================
@@ -1048,29 +2702,798 @@ static lean_obj_res mk_io_error(const char *msg) {
     return r;
 }
 
-LEAN_EXPORT lean_obj_res lean_io_as_task(lean_obj_arg closure, lean_obj_arg prio) {
-    (void)prio;
-    /* Just execute synchronously */
-    return lean_apply_1(closure, lean_box(0));
-}
-
 LEAN_EXPORT lean_obj_res lean_io_error_to_string(lean_obj_arg e) {
     lean_dec(e);
     return lean_io_result_mk_ok(lean_mk_string("IO error (WASM)"));
 }
 
+/* ── Tasks ─────────────────────────────────────────────────────
+ * A task's m_value is NULL until it finishes. Until some thread claims
+ * it by swapping in NULL, m_imp->m_closure holds the Unit → α closure,
+ * so a task is waiting while it has a closure and running while it has
+ * neither closure nor value. lean_task_pure makes finished tasks without
+ * an m_imp.
+ *
+ * Without LEAN_WASM_THREADS a spawned task runs to completion before
+ * lean_task_spawn_core returns. With it, tasks and everything they hold
+ * are multi-threaded objects run by a pool of one worker thread per
+ * core. A worker pushes the tasks it spawns onto its own deque and pops
+ * them newest first; other threads spawn into a shared injection queue.
+ * An idle worker takes from its deque, then the injection queue, then
+ * steals the oldest entry of another worker's deque. A thread waiting
+ * for a task that has not started runs it itself, so tasks that wait on
+ * the tasks they spawn cannot starve the pool. Priorities, `sync` and
+ * `keep_alive` are accepted and ignored.
+ */
+static WASM_THREAD_LOCAL lean_task_object *task_current = NULL;
+
+static lean_task_object *task_alloc(lean_object *c, lean_object *v, unsigned prio) {
+    lean_task_object *t = (lean_task_object *)lean_alloc_small_object(sizeof(lean_task_object));
+    lean_set_st_header((lean_object *)t, LeanTask, 0);
+#ifdef LEAN_WASM_THREADS
+    t->m_header.m_rc = -1;
+    if (c) lean_mark_mt(c);
+    if (v) lean_mark_mt(v);
+#endif
+    atomic_init(&t->m_value, v);
+    t->m_imp = NULL;
+    if (c) {
+        lean_task_imp *imp = (lean_task_imp *)calloc(1, sizeof(lean_task_imp));
+        if (!imp) lean_internal_panic_out_of_memory();
+        imp->m_closure = c;
+        imp->m_prio = prio;
+        t->m_imp = imp;
+    }
+    return t;
+}
+
+/* Take the closure of a task that has not started; NULL if it has. */
+static inline lean_object *task_claim(lean_task_object *t) {
+    return t->m_imp ? __atomic_exchange_n(&t->m_imp->m_closure, NULL, __ATOMIC_ACQ_REL) : NULL;
+}
+
+#ifdef LEAN_WASM_THREADS
+static pthread_mutex_t task_mu = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  task_work_cv = PTHREAD_COND_INITIALIZER;  /* idle workers */
+static pthread_cond_t  task_done_cv = PTHREAD_COND_INITIALIZER;  /* lean_task_get, wait_any */
+#endif
+
+static void task_run(lean_task_object *t, lean_object *c) {
+    lean_task_object *outer = task_current;
+    task_current = t;
+    lean_object *v = lean_apply_1(c, lean_box(0));
+    task_current = outer;
+#ifdef LEAN_WASM_THREADS
+    lean_mark_mt(v);
+    atomic_store_explicit(&t->m_value, v, memory_order_release);
+    pthread_mutex_lock(&task_mu);
+    pthread_cond_broadcast(&task_done_cv);
+    pthread_mutex_unlock(&task_mu);
+#else
+    atomic_store_explicit(&t->m_value, v, memory_order_relaxed);
+#endif
+}
+
+#ifdef LEAN_WASM_THREADS
+#define TASK_MAX_WORKERS 64
+#define TASK_DEQUE_MIN   64
+
+typedef struct {
+    pthread_mutex_t    mu;
+    lean_task_object **buf;     /* ring of cap entries, cap a power of two */
+    size_t             cap, head, len;
+} task_deque;
+
+/* One deque per worker, then the injection queue at task_deques[task_nworkers] */
+static task_deque     task_deques[TASK_MAX_WORKERS + 1];
+static unsigned       task_nworkers;
+static size_t         task_queued;      /* entries in all deques */
+static pthread_once_t task_pool_once = PTHREAD_ONCE_INIT;
+static _Thread_local int task_worker = -1;
+
+static void deque_push(task_deque *q, lean_task_object *t) {
+    pthread_mutex_lock(&q->mu);
+    if (q->len == q->cap) {
+        size_t ncap = q->cap ? q->cap * 2 : TASK_DEQUE_MIN;
+        lean_task_object **nb = (lean_task_object **)malloc(sizeof(lean_task_object *) * ncap);
+        if (!nb) lean_internal_panic_out_of_memory();
+        for (size_t i = 0; i < q->len; i++)
+            nb[i] = q->buf[(q->head + i) & (q->cap - 1)];
+        free(q->buf);
+        q->buf = nb;
+        q->cap = ncap;
+        q->head = 0;
+    }
+    q->buf[(q->head + q->len++) & (q->cap - 1)] = t;
+    pthread_mutex_unlock(&q->mu);
+}
+
+static lean_task_object *deque_pop(task_deque *q, bool newest) {
+    lean_task_object *t = NULL;
+    pthread_mutex_lock(&q->mu);
+    if (q->len > 0) {
+        if (newest) {
+            t = q->buf[(q->head + --q->len) & (q->cap - 1)];
+        } else {
+            t = q->buf[q->head];
+            q->head = (q->head + 1) & (q->cap - 1);
+            q->len--;
+        }
+    }
+    pthread_mutex_unlock(&q->mu);
+    if (t) __atomic_fetch_sub(&task_queued, 1, __ATOMIC_RELAXED);
+    return t;
+}
+
+static lean_task_object *task_take(unsigned self) {
+    lean_task_object *t = deque_pop(&task_deques[self], true);
+    if (!t) t = deque_pop(&task_deques[task_nworkers], false);
+    for (unsigned k = 1; !t && k < task_nworkers; k++)
+        t = deque_pop(&task_deques[(self + k) % task_nworkers], false);
+    return t;
+}
+
+/* Run a task taken from a deque, unless a waiter has already claimed it,
+   and drop the reference the deque held. */
+static void task_exec(lean_task_object *t) {
+    lean_object *c = task_claim(t);
+    if (c) task_run(t, c);
+    lean_dec_ref((lean_object *)t);
+}
+
+static void *task_worker_main(void *arg) {
+    task_worker = (int)(intptr_t)arg;
+    for (;;) {
+        lean_task_object *t = task_take((unsigned)task_worker);
+        if (t) {
+            task_exec(t);
+            continue;
+        }
+        pthread_mutex_lock(&task_mu);
+        while (__atomic_load_n(&task_queued, __ATOMIC_ACQUIRE) == 0)
+            pthread_cond_wait(&task_work_cv, &task_mu);
+        pthread_mutex_unlock(&task_mu);
+    }
+    return NULL;
+}
+
+/* Under Emscripten the workers come from the pthread pool that
+   build_wasm.sh sizes to navigator.hardwareConcurrency. */
+static void task_pool_start(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) n = 1;
+    if (n > TASK_MAX_WORKERS) n = TASK_MAX_WORKERS;
+    task_nworkers = (unsigned)n;
+    for (unsigned i = 0; i <= task_nworkers; i++)
+        pthread_mutex_init(&task_deques[i].mu, NULL);
+    for (unsigned i = 0; i < task_nworkers; i++) {
+        pthread_t th;
+        if (pthread_create(&th, NULL, task_worker_main, (void *)(intptr_t)i) != 0)
+            lean_internal_panic("cannot start task worker thread");
+        pthread_detach(th);
+    }
+}
+
+static void task_push(lean_task_object *t) {
+    pthread_once(&task_pool_once, task_pool_start);
+    lean_inc_ref((lean_object *)t);     /* held by the deque */
+    __atomic_fetch_add(&task_queued, 1, __ATOMIC_RELEASE);
+    deque_push(&task_deques[task_worker >= 0 ? (unsigned)task_worker : task_nworkers], t);
+    pthread_mutex_lock(&task_mu);
+    pthread_cond_signal(&task_work_cv);
+    pthread_mutex_unlock(&task_mu);
+}
+#endif
+
+/* The value of `t`, blocking until it finishes. */
+static lean_object *task_wait(lean_task_object *t) {
+    lean_object *v = atomic_load_explicit(&t->m_value, memory_order_acquire);
+#ifdef LEAN_WASM_THREADS
+    if (v) return v;
+    lean_object *c = task_claim(t);
+    if (c) {
+        task_run(t, c);
+        return atomic_load_explicit(&t->m_value, memory_order_relaxed);
+    }
+    pthread_mutex_lock(&task_mu);
+    while (!(v = atomic_load_explicit(&t->m_value, memory_order_acquire)))
+        pthread_cond_wait(&task_done_cv, &task_mu);
+    pthread_mutex_unlock(&task_mu);
+#endif
+    return v;
+}
+
+LEAN_EXPORT lean_obj_res lean_task_pure(lean_obj_arg a) {
+    return (lean_object *)task_alloc(NULL, a, 0);
+}
+
+LEAN_EXPORT lean_obj_res lean_task_spawn_core(lean_obj_arg c, unsigned prio, bool keep_alive) {
+    (void)keep_alive;
+    lean_task_object *t = task_alloc(c, NULL, prio);
+#ifdef LEAN_WASM_THREADS
+    task_push(t);
+#else
+    task_run(t, task_claim(t));
+#endif
+    return (lean_object *)t;
+}
+
+LEAN_EXPORT b_lean_obj_res lean_task_get(b_lean_obj_arg t) {
+    return task_wait(lean_to_task(t));
+}
+
+static lean_object *task_map_fn(lean_object *f, lean_object *t, lean_object *unit) {
+    (void)unit;
+    return lean_apply_1(f, lean_task_get_own(t));
+}
+
+static lean_object *task_bind_fn(lean_object *x, lean_object *f, lean_object *unit) {
+    (void)unit;
+    return lean_task_get_own(lean_apply_1(f, lean_task_get_own(x)));
+}
+
+/* Spawn fn(a, b, ()) as a task */
+static lean_object *task_spawn2(void *fn, lean_object *a, lean_object *b, unsigned prio,
+                                bool keep_alive) {
+    lean_object *c = lean_alloc_closure(fn, 3, 2);
+    lean_closure_set(c, 0, a);
+    lean_closure_set(c, 1, b);
+    return lean_task_spawn_core(c, prio, keep_alive);
+}
+
+LEAN_EXPORT lean_obj_res lean_task_map_core(lean_obj_arg f, lean_obj_arg t, unsigned prio,
+                                            bool sync, bool keep_alive) {
+    (void)sync;
+    return task_spawn2((void *)task_map_fn, f, t, prio, keep_alive);
+}
+
+LEAN_EXPORT lean_obj_res lean_task_bind_core(lean_obj_arg x, lean_obj_arg f, unsigned prio,
+                                             bool sync, bool keep_alive) {
+    (void)sync;
+    return task_spawn2((void *)task_bind_fn, x, f, prio, keep_alive);
+}
+
+/* EStateM.Result → Except IO.Error α, the value of an IO task */
+static lean_object *io_result_to_except(lean_object *r) {
+    bool ok = lean_io_result_is_ok(r);
+    lean_object *v = ok ? lean_io_result_get_value(r) : lean_io_result_get_error(r);
+    lean_inc(v);
+    lean_dec(r);
+    lean_object *e = lean_alloc_ctor(ok ? 1 : 0, 1, 0);  /* Except.ok / Except.error */
+    lean_ctor_set(e, 0, v);
+    return e;
+}
+
+static lean_object *io_as_task_fn(lean_object *act, lean_object *unit) {
+    (void)unit;
+    return io_result_to_except(lean_apply_1(act, lean_box(0)));
+}
+
+static lean_object *io_map_task_fn(lean_object *f, lean_object *t, lean_object *unit) {
+    (void)unit;
+    return io_result_to_except(lean_apply_2(f, lean_task_get_own(t), lean_box(0)));
+}
+
+static lean_object *io_bind_task_fn(lean_object *t, lean_object *f, lean_object *unit) {
+    (void)unit;
+    lean_object *r = lean_apply_2(f, lean_task_get_own(t), lean_box(0));
+    if (!lean_io_result_is_ok(r)) return io_result_to_except(r);
+    lean_object *t2 = lean_io_result_get_value(r);
+    lean_inc(t2);
+    lean_dec(r);
+    return lean_task_get_own(t2);
+}
+
+LEAN_EXPORT lean_obj_res lean_io_as_task(lean_obj_arg act, lean_obj_arg prio) {
+    lean_object *c = lean_alloc_closure((void *)io_as_task_fn, 2, 1);
+    lean_closure_set(c, 0, act);
+    return lean_io_result_mk_ok(lean_task_spawn_core(c, (unsigned)lean_unbox(prio), true));
+}
+
+LEAN_EXPORT lean_obj_res lean_io_map_task(lean_obj_arg f, lean_obj_arg t, lean_obj_arg prio,
+                                          uint8_t sync) {
+    (void)sync;
+    return lean_io_result_mk_ok(
+        task_spawn2((void *)io_map_task_fn, f, t, (unsigned)lean_unbox(prio), true));
+}
+
+LEAN_EXPORT lean_obj_res lean_io_bind_task(lean_obj_arg t, lean_obj_arg f, lean_obj_arg prio,
+                                           uint8_t sync) {
+    (void)sync;
+    return lean_io_result_mk_ok(
+        task_spawn2((void *)io_bind_task_fn, t, f, (unsigned)lean_unbox(prio), true));
+}
+
+LEAN_EXPORT uint8_t lean_io_get_task_state_core(b_lean_obj_arg t) {
+    lean_task_object *o = lean_to_task(t);
+    if (atomic_load_explicit(&o->m_value, memory_order_acquire))
+        return 2; /* finished */
+    return __atomic_load_n(&o->m_imp->m_closure, __ATOMIC_ACQUIRE) ? 0 /* waiting */ : 1 /* running */;
+}
+
+LEAN_EXPORT void lean_io_cancel_core(b_lean_obj_arg t) {
+    lean_task_imp *imp = lean_to_task(t)->m_imp;
+    if (imp) __atomic_store_n(&imp->m_canceled, 1, __ATOMIC_RELAXED);
+}
+
+LEAN_EXPORT bool lean_io_check_canceled_core(void) {
+    return task_current && __atomic_load_n(&task_current->m_imp->m_canceled, __ATOMIC_RELAXED);
+}
+
+static lean_object *task_list_first_done(b_lean_obj_arg l) {
+    for (; !lean_is_scalar(l); l = lean_ctor_get(l, 1)) {
+        lean_object *t = lean_ctor_get(l, 0);
+        if (atomic_load_explicit(&lean_to_task(t)->m_value, memory_order_acquire)) return t;
+    }
+    return NULL;
+}
+
+LEAN_EXPORT b_lean_obj_res lean_io_wait_any_core(b_lean_obj_arg task_list) {
+    if (lean_is_scalar(task_list)) lean_internal_panic("IO.waitAny: empty task list");
+    lean_object *t = task_list_first_done(task_list);
+#ifdef LEAN_WASM_THREADS
+    while (!t) {
+        /* Run one that has not started, or sleep until one finishes */
+        for (lean_object *l = task_list; !lean_is_scalar(l); l = lean_ctor_get(l, 1)) {
+            lean_task_object *o = lean_to_task(lean_ctor_get(l, 0));
+            lean_object *c = task_claim(o);
+            if (c) {
+                task_run(o, c);
+                return (lean_object *)o;
+            }
+        }
+        pthread_mutex_lock(&task_mu);
+        if (!(t = task_list_first_done(task_list)))
+            pthread_cond_wait(&task_done_cv, &task_mu);
+        pthread_mutex_unlock(&task_mu);
+    }
+#endif
+    return t;
+}
+
+/* ── Random bytes ──────────────────────────────────────────────
+ * HMAC_DRBG (NIST SP 800-90A) over SHA-256, seeded from the host:
+ * getentropy() under Emscripten (crypto.getRandomValues) and WASI,
+ * getrandom() natively. Output is generated RNG_POOL_SIZE bytes at a
+ * time and requests are served from that pool, wiping bytes as they are
+ * handed out. The generator reseeds every RNG_RESEED_INTERVAL refills.
+ * SHA-256 is a plain C version here; the Lean one lives in WasmAPI,
+ * which the runtime does not link against. */
+
+#define RNG_POOL_SIZE       4096
+#define RNG_MAX_REQUEST     65536   /* SP 800-90A limit per generate call */
+#define RNG_RESEED_INTERVAL 256     /* refills between reseeds */
+
+typedef struct {
+    uint32_t h[8];
+    uint64_t len;
+    uint8_t  buf[64];
+} sha256_ctx;
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_block(uint32_t h[8], const uint8_t *p) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+        w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 |
+               (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROR32(w[i - 15], 7) ^ ROR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROR32(w[i - 2], 17) ^ ROR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+    uint32_t e = h[4], f = h[5], g = h[6], hh = h[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = hh + (ROR32(e, 6) ^ ROR32(e, 11) ^ ROR32(e, 25)) +
+                      ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+        uint32_t t2 = (ROR32(a, 2) ^ ROR32(a, 13) ^ ROR32(a, 22)) +
+                      ((a & b) ^ (a & c) ^ (b & c));
+        hh = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+}
+
+static const uint32_t sha256_iv[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static void sha256_init(sha256_ctx *c) {
+    memcpy(c->h, sha256_iv, sizeof(sha256_iv));
+    c->len = 0;
+}
+
+static void sha256_update(sha256_ctx *c, const uint8_t *p, size_t n) {
+    size_t used = (size_t)(c->len & 63);
+    c->len += n;
+    if (used) {
+        size_t k = 64 - used < n ? 64 - used : n;
+        memcpy(c->buf + used, p, k);
+        p += k; n -= k;
+        if (used + k < 64) return;
+        sha256_block(c->h, c->buf);
+    }
+    for (; n >= 64; p += 64, n -= 64) sha256_block(c->h, p);
+    memcpy(c->buf, p, n);
+}
+
+static void sha256_put_digest(uint8_t *out, const uint32_t h[8]) {
+    for (int i = 0; i < 8; i++) {
+        out[4 * i]     = (uint8_t)(h[i] >> 24);
+        out[4 * i + 1] = (uint8_t)(h[i] >> 16);
+        out[4 * i + 2] = (uint8_t)(h[i] >> 8);
+        out[4 * i + 3] = (uint8_t)h[i];
+    }
+}
+
+static void sha256_final(sha256_ctx *c, uint8_t out[32]) {
+    uint64_t bits = c->len * 8;
+    uint8_t pad[72] = { 0x80 };
+    size_t used = (size_t)(c->len & 63);
+    size_t npad = (used < 56 ? 56 : 120) - used;
+    for (int i = 0; i < 8; i++) pad[npad + i] = (uint8_t)(bits >> (56 - 8 * i));
+    sha256_update(c, pad, npad + 8);
+    sha256_put_digest(out, c->h);
+}
+
+/* HMAC-SHA-256 with a 32-byte key. The hash states after the ipad and
+   opad blocks are kept, so each MAC of a short message costs two
+   compressions instead of four. */
+typedef struct {
+    sha256_ctx ipad;
+    sha256_ctx opad;
+} hmac_sha256_key;
+
+static void hmac_sha256_set_key(hmac_sha256_key *hk, const uint8_t key[32]) {
+    uint8_t b[64];
+    memset(b, 0x36, sizeof(b));
+    for (int i = 0; i < 32; i++) b[i] ^= key[i];
+    sha256_init(&hk->ipad);
+    sha256_update(&hk->ipad, b, sizeof(b));
+    for (int i = 0; i < 64; i++) b[i] ^= 0x36 ^ 0x5c;
+    sha256_init(&hk->opad);
+    sha256_update(&hk->opad, b, sizeof(b));
+}
+
+static void hmac_sha256_end(sha256_ctx *c, const hmac_sha256_key *hk, uint8_t out[32]) {
+    uint8_t inner[32];
+    sha256_final(c, inner);
+    *c = hk->opad;
+    sha256_update(c, inner, sizeof(inner));
+    sha256_final(c, out);
+}
+
+static void secure_wipe(void *p, size_t n) {
+    volatile uint8_t *q = (volatile uint8_t *)p;
+    while (n--) *q++ = 0;
+}
+
+typedef struct {
+    hmac_sha256_key k;
+    uint8_t  v[32];
+    unsigned refills;   /* generate calls since the last (re)seed */
+    bool     seeded;
+} hmac_drbg;
+
+static hmac_drbg rng_drbg;
+static uint8_t   rng_pool[RNG_POOL_SIZE];
+static size_t    rng_avail = 0;   /* unread bytes, at the end of rng_pool */
+#ifdef LEAN_WASM_THREADS
+static pthread_mutex_t rng_mu = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* HMAC_DRBG_Update: K = HMAC(K, V || round || in), V = HMAC(K, V) */
+static void drbg_update(hmac_drbg *d, const uint8_t *in, size_t n) {
+    for (uint8_t round = 0; round < (n ? 2 : 1); round++) {
+        uint8_t k[32];
+        sha256_ctx c = d->k.ipad;
+        sha256_update(&c, d->v, 32);
+        sha256_update(&c, &round, 1);
+        if (n) sha256_update(&c, in, n);
+        hmac_sha256_end(&c, &d->k, k);
+        hmac_sha256_set_key(&d->k, k);
+        secure_wipe(k, sizeof(k));
+        c = d->k.ipad;
+        sha256_update(&c, d->v, 32);
+        hmac_sha256_end(&c, &d->k, d->v);
+    }
+}
+
+static void host_entropy(uint8_t *p, size_t n) {
+#if defined(__EMSCRIPTEN__) || defined(__wasi__)
+    /* at most 256 bytes per call; callers ask for less */
+    if (getentropy(p, n) != 0) lean_internal_panic("getentropy failed");
+#else
+    while (n > 0) {
+        ssize_t r = getrandom(p, n, 0);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            lean_internal_panic("getrandom failed");
+        }
+        p += r;
+        n -= (size_t)r;
+    }
+#endif
+}
+
+/* Entropy for drbg_seed. tests/drbg_test.c includes this file and
+   replaces it to run the CAVP known-answer vectors. */
+static void (*rng_entropy)(uint8_t *p, size_t n) = host_entropy;
+
+/* Instantiate (K = 0, V = 0x01…, seed material of 256 bits of entropy
+   plus a 128-bit nonce) or, once seeded, reseed from 256 bits of entropy. */
+static void drbg_seed(hmac_drbg *d) {
+    uint8_t seed[48];
+    size_t n = d->seeded ? 32 : 48;
+    rng_entropy(seed, n);
+    if (!d->seeded) {
+        static const uint8_t zero[32];
+        hmac_sha256_set_key(&d->k, zero);
+        memset(d->v, 0x01, 32);
+        d->seeded = true;
+    }
+    drbg_update(d, seed, n);
+    secure_wipe(seed, sizeof(seed));
+    d->refills = 0;
+}
+
+/* Instantiate on first use, reseed after RNG_RESEED_INTERVAL refills */
+static void drbg_generate(hmac_drbg *d, uint8_t *out, size_t n) {
+    if (!d->seeded || d->refills >= RNG_RESEED_INTERVAL) drbg_seed(d);
+    while (n > 0) {
+        sha256_ctx c = d->k.ipad;
+        sha256_update(&c, d->v, 32);
+        hmac_sha256_end(&c, &d->k, d->v);
+        size_t k = n < 32 ? n : 32;
+        memcpy(out, d->v, k);
+        out += k;
+        n -= k;
+    }
+    drbg_update(d, NULL, 0);
+    d->refills++;
+}
+
+void lean_wasm_random_bytes(uint8_t *dst, size_t n) {
+#ifdef LEAN_WASM_THREADS
+    pthread_mutex_lock(&rng_mu);
+#endif
+    while (n > 0) {
+        if (rng_avail == 0) {
+            if (n >= RNG_POOL_SIZE) {
+                /* large requests bypass the pool */
+                size_t k = n < RNG_MAX_REQUEST ? n : RNG_MAX_REQUEST;
+                drbg_generate(&rng_drbg, dst, k);
+                dst += k;
+                n -= k;
+                continue;
+            }
+            drbg_generate(&rng_drbg, rng_pool, RNG_POOL_SIZE);
+            rng_avail = RNG_POOL_SIZE;
+        }
+        size_t k = n < rng_avail ? n : rng_avail;
+        uint8_t *src = rng_pool + RNG_POOL_SIZE - rng_avail;
+        memcpy(dst, src, k);
+        memset(src, 0, k);
+        rng_avail -= k;
+        dst += k;
+        n -= k;
+    }
+#ifdef LEAN_WASM_THREADS
+    pthread_mutex_unlock(&rng_mu);
+#endif
+}
+
 LEAN_EXPORT lean_obj_res lean_io_get_random_bytes(size_t n) {
     lean_object *ba = lean_alloc_sarray(1, n, n);
-    memset(lean_sarray_cptr(ba), 0, n); /* zeros — not cryptographically random */
+    lean_wasm_random_bytes(lean_sarray_cptr(ba), n);
     return lean_io_result_mk_ok(ba);
 }
 
+/* ── Multi-buffer SHA-256 ──────────────────────────────────────
+ * Many independent messages hashed side by side, one message per vector
+ * lane: SHA_LANES is 4 with wasm simd128 or SSE2 and 8 with AVX2. A lane
+ * whose message is done takes the next one, so messages of different
+ * lengths keep the lanes busy until the queue runs dry; the last message
+ * left is finished with sha256_block. Without SIMD the messages are
+ * hashed one at a time. */
+
+#if defined(__wasm_simd128__)
+#define SHA_LANES 4
+typedef v128_t sha_vec;
+#define SV_ADD(a, b)   wasm_i32x4_add(a, b)
+#define SV_XOR(a, b)   wasm_v128_xor(a, b)
+#define SV_AND(a, b)   wasm_v128_and(a, b)
+#define SV_SHR(a, n)   wasm_u32x4_shr(a, n)
+#define SV_SHL(a, n)   wasm_i32x4_shl(a, n)
+#define SV_SPLAT(x)    wasm_i32x4_splat((int32_t)(x))
+#define SV_LOAD(p)     wasm_v128_load(p)
+#define SV_STORE(p, v) wasm_v128_store(p, v)
+#elif defined(__AVX2__)
+#define SHA_LANES 8
+typedef __m256i sha_vec;
+#define SV_ADD(a, b)   _mm256_add_epi32(a, b)
+#define SV_XOR(a, b)   _mm256_xor_si256(a, b)
+#define SV_AND(a, b)   _mm256_and_si256(a, b)
+#define SV_SHR(a, n)   _mm256_srli_epi32(a, n)
+#define SV_SHL(a, n)   _mm256_slli_epi32(a, n)
+#define SV_SPLAT(x)    _mm256_set1_epi32((int)(x))
+#define SV_LOAD(p)     _mm256_loadu_si256((const __m256i *)(p))
+#define SV_STORE(p, v) _mm256_storeu_si256((__m256i *)(p), v)
+#elif defined(__SSE2__)
+#define SHA_LANES 4
+typedef __m128i sha_vec;
+#define SV_ADD(a, b)   _mm_add_epi32(a, b)
+#define SV_XOR(a, b)   _mm_xor_si128(a, b)
+#define SV_AND(a, b)   _mm_and_si128(a, b)
+#define SV_SHR(a, n)   _mm_srli_epi32(a, n)
+#define SV_SHL(a, n)   _mm_slli_epi32(a, n)
+#define SV_SPLAT(x)    _mm_set1_epi32((int)(x))
+#define SV_LOAD(p)     _mm_loadu_si128((const __m128i *)(p))
+#define SV_STORE(p, v) _mm_storeu_si128((__m128i *)(p), v)
+#else
+#define SHA_LANES 1
+#endif
+
+size_t lean_wasm_sha256_lanes(void) { return SHA_LANES; }
+
+#if SHA_LANES > 1
+/* The shifted halves do not overlap, so XOR stands in for OR. */
+#define SV_ROR(x, n) SV_XOR(SV_SHR(x, n), SV_SHL(x, 32 - (n)))
+
+/* One block in every lane. h[i][j] is state word i of lane j, w[t][j]
+   message word t of lane j's block. */
+static void sha256_block_lanes(uint32_t h[8][SHA_LANES], const uint32_t w[16][SHA_LANES]) {
+    sha_vec ws[16];
+    for (int i = 0; i < 16; i++) ws[i] = SV_LOAD(w[i]);
+    sha_vec a = SV_LOAD(h[0]), b = SV_LOAD(h[1]), c = SV_LOAD(h[2]), d = SV_LOAD(h[3]);
+    sha_vec e = SV_LOAD(h[4]), f = SV_LOAD(h[5]), g = SV_LOAD(h[6]), hh = SV_LOAD(h[7]);
+    for (int i = 0; i < 64; i++) {
+        if (i >= 16) {
+            sha_vec w15 = ws[(i - 15) & 15], w2 = ws[(i - 2) & 15];
+            sha_vec s0 = SV_XOR(SV_XOR(SV_ROR(w15, 7), SV_ROR(w15, 18)), SV_SHR(w15, 3));
+            sha_vec s1 = SV_XOR(SV_XOR(SV_ROR(w2, 17), SV_ROR(w2, 19)), SV_SHR(w2, 10));
+            ws[i & 15] = SV_ADD(SV_ADD(ws[i & 15], s0), SV_ADD(ws[(i - 7) & 15], s1));
+        }
+        sha_vec s1 = SV_XOR(SV_XOR(SV_ROR(e, 6), SV_ROR(e, 11)), SV_ROR(e, 25));
+        sha_vec ch = SV_XOR(g, SV_AND(e, SV_XOR(f, g)));
+        sha_vec t1 = SV_ADD(SV_ADD(SV_ADD(hh, s1), SV_ADD(ch, SV_SPLAT(sha256_k[i]))), ws[i & 15]);
+        sha_vec s0 = SV_XOR(SV_XOR(SV_ROR(a, 2), SV_ROR(a, 13)), SV_ROR(a, 22));
+        sha_vec maj = SV_XOR(b, SV_AND(SV_XOR(a, b), SV_XOR(b, c)));
+        sha_vec t2 = SV_ADD(s0, maj);
+        hh = g; g = f; f = e; e = SV_ADD(d, t1);
+        d = c; c = b; b = a; a = SV_ADD(t1, t2);
+    }
+    SV_STORE(h[0], SV_ADD(SV_LOAD(h[0]), a)); SV_STORE(h[1], SV_ADD(SV_LOAD(h[1]), b));
+    SV_STORE(h[2], SV_ADD(SV_LOAD(h[2]), c)); SV_STORE(h[3], SV_ADD(SV_LOAD(h[3]), d));
+    SV_STORE(h[4], SV_ADD(SV_LOAD(h[4]), e)); SV_STORE(h[5], SV_ADD(SV_LOAD(h[5]), f));
+    SV_STORE(h[6], SV_ADD(SV_LOAD(h[6]), g)); SV_STORE(h[7], SV_ADD(SV_LOAD(h[7]), hh));
+}
+
+/* A message in a lane: its full blocks are read in place, the padded
+   last one or two blocks from `tail`. */
+typedef struct {
+    const uint8_t *p;
+    size_t         full;
+    const uint8_t *tp;
+    size_t         ntail;
+    size_t         idx;
+    uint8_t        tail[128];
+} sha_lane;
+
+static void sha_lane_start(sha_lane *l, const lean_wasm_bytes *m, size_t idx) {
+    size_t rem = m->len & 63;
+    l->p = m->data;
+    l->full = m->len >> 6;
+    l->ntail = rem < 56 ? 1 : 2;
+    l->tp = l->tail;
+    l->idx = idx;
+    memset(l->tail, 0, sizeof(l->tail));
+    if (rem) memcpy(l->tail, m->data + (m->len - rem), rem);
+    l->tail[rem] = 0x80;
+    uint64_t bits = (uint64_t)m->len * 8;
+    for (int i = 0; i < 8; i++) l->tail[64 * l->ntail - 1 - i] = (uint8_t)(bits >> (8 * i));
+}
+
+static const uint8_t *sha_lane_block(sha_lane *l) {
+    const uint8_t *blk;
+    if (l->full) { blk = l->p; l->p += 64; l->full--; }
+    else { blk = l->tp; l->tp += 64; l->ntail--; }
+    return blk;
+}
+
+#endif
+
+void lean_wasm_sha256_many(const lean_wasm_bytes *msgs, size_t n, uint8_t *out) {
+#if SHA_LANES > 1
+    static const uint8_t idle_block[64];
+    sha_lane lane[SHA_LANES];
+    bool busy[SHA_LANES];
+    uint32_t h[8][SHA_LANES];
+    uint32_t w[16][SHA_LANES];
+    size_t next = 0, active = 0;
+
+    for (int j = 0; j < SHA_LANES; j++) {
+        busy[j] = next < n;
+        if (!busy[j]) continue;
+        sha_lane_start(&lane[j], &msgs[next], next);
+        next++;
+        active++;
+        for (int i = 0; i < 8; i++) h[i][j] = sha256_iv[i];
+    }
+    while (active > 1) {
+        for (int j = 0; j < SHA_LANES; j++) {
+            const uint8_t *p = busy[j] ? sha_lane_block(&lane[j]) : idle_block;
+            for (int t = 0; t < 16; t++)
+                w[t][j] = (uint32_t)p[4 * t] << 24 | (uint32_t)p[4 * t + 1] << 16 |
+                          (uint32_t)p[4 * t + 2] << 8 | p[4 * t + 3];
+        }
+        sha256_block_lanes(h, w);
+        for (int j = 0; j < SHA_LANES; j++) {
+            if (!busy[j] || lane[j].full || lane[j].ntail) continue;
+            uint32_t hj[8];
+            for (int i = 0; i < 8; i++) hj[i] = h[i][j];
+            sha256_put_digest(out + 32 * lane[j].idx, hj);
+            if (next < n) {
+                sha_lane_start(&lane[j], &msgs[next], next);
+                next++;
+                for (int i = 0; i < 8; i++) h[i][j] = sha256_iv[i];
+            } else {
+                busy[j] = false;
+                active--;
+            }
+        }
+    }
+    for (int j = 0; j < SHA_LANES; j++) {
+        if (!busy[j]) continue;
+        uint32_t hj[8];
+        for (int i = 0; i < 8; i++) hj[i] = h[i][j];
+        while (lane[j].full || lane[j].ntail) sha256_block(hj, sha_lane_block(&lane[j]));
+        sha256_put_digest(out + 32 * lane[j].idx, hj);
+    }
+#else
+    for (size_t i = 0; i < n; i++) {
+        sha256_ctx c;
+        sha256_init(&c);
+        sha256_update(&c, msgs[i].data, msgs[i].len);
+        sha256_final(&c, out + 32 * i);
+    }
+#endif
+}
+
+/* performance.now() under Emscripten (ms as a double, microsecond or
+   coarser resolution depending on the host), CLOCK_MONOTONIC natively.
+   Nanoseconds pass LEAN_MAX_SMALL_NAT within seconds on wasm32, so the
+   results are boxed with lean_uint64_to_nat. */
+uint64_t lean_wasm_mono_ns(void) {
+#if defined(__EMSCRIPTEN__)
+    return (uint64_t)(emscripten_get_now() * 1e6);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
 LEAN_EXPORT lean_obj_res lean_io_mono_ms_now(void) {
-    return lean_io_result_mk_ok(lean_box(0));
+    return lean_io_result_mk_ok(lean_uint64_to_nat(lean_wasm_mono_ns() / 1000000u));
 }
 
 LEAN_EXPORT lean_obj_res lean_io_mono_nanos_now(void) {
-    return lean_io_result_mk_ok(lean_box(0));
+    return lean_io_result_mk_ok(lean_uint64_to_nat(lean_wasm_mono_ns()));
 }
 
 LEAN_EXPORT lean_obj_res lean_io_read_dir(lean_obj_arg path) {
@@ -1080,10 +3503,6 @@ LEAN_EXPORT lean_obj_res lean_io_read_dir(lean_obj_arg path) {
 
 LEAN_EXPORT void lean_io_result_show_error(b_lean_obj_arg r) { (void)r; }
 LEAN_EXPORT void lean_io_mark_end_initialization(void) { }
-LEAN_EXPORT bool lean_io_check_canceled_core(void) { return false; }
-LEAN_EXPORT void lean_io_cancel_core(b_lean_obj_arg t) { (void)t; }
-LEAN_EXPORT uint8_t lean_io_get_task_state_core(b_lean_obj_arg t) { (void)t; return 2; /* finished */ }
-LEAN_EXPORT b_lean_obj_res lean_io_wait_any_core(b_lean_obj_arg task_list) { (void)task_list; return lean_box(0); }
 
 /* ================================================================
  *  11. Crypto FFI Stubs
@@ -1131,7 +3550,7 @@ LEAN_EXPORT lean_obj_res lean_crypto_random_bytes(lean_obj_arg n, lean_obj_arg w
     (void)w;
     size_t sz = lean_unbox(n);
     lean_object *ba = lean_alloc_sarray(1, sz, sz);
-    memset(lean_sarray_cptr(ba), 0, sz);
+    lean_wasm_random_bytes(lean_sarray_cptr(ba), sz);
     return lean_io_result_mk_ok(ba);
 }
 
@@ -1149,8 +3568,26 @@ LEAN_EXPORT lean_external_class *lean_register_external_class(
 
 LEAN_EXPORT lean_obj_res lean_io_allocprof(lean_obj_arg desc, lean_obj_arg act, lean_obj_arg w) {
     (void)w;
+#ifdef LEAN_WASM_ALLOC_STATS
+    lean_wasm_alloc_stats before, after;
+    lean_wasm_alloc_stats_get(&before);
+    lean_obj_res r = lean_apply_1(act, lean_box(0));
+    lean_wasm_alloc_stats_get(&after);
+    uint64_t n = 0, bytes = 0;
+    for (unsigned i = 0; i < LEAN_WASM_STAT_TAGS; i++) {
+        n += after.allocs[i] - before.allocs[i];
+        bytes += after.bytes[i] - before.bytes[i];
+    }
+    fprintf(stderr, "allocprof %s: %llu allocs, %llu bytes, %llu frees, peak %llu bytes\n",
+            lean_string_cstr(desc), (unsigned long long)n, (unsigned long long)bytes,
+            (unsigned long long)(after.frees - before.frees),
+            (unsigned long long)after.peak_bytes);
+    lean_dec(desc);
+    return r;
+#else
     lean_dec(desc);
     return lean_apply_1(act, lean_box(0));
+#endif
 }
 
 /* Float operations that may be needed */
@@ -1162,22 +3599,27 @@ LEAN_EXPORT double lean_float_of_bits(uint64_t u) {
 
 LEAN_EXPORT double lean_float_of_nat(b_lean_obj_arg a) {
     if (lean_is_scalar(a)) return (double)lean_unbox(a);
-    return 0.0; /* big nat */
+    const lean_mpz_object *m = (const lean_mpz_object *)a;
+    double d = 0.0;
+    for (size_t i = m->m_size; i-- > 0;)
+        d = d * 4294967296.0 + m->m_digits[i];
+    return d;
 }
 
 LEAN_EXPORT uint8_t lean_uint8_of_big_nat(b_lean_obj_arg a) {
-    (void)a;
-    return 0; /* big nat → truncate to 0 */
+    return (uint8_t)big_low_u64(a);
+}
+
+LEAN_EXPORT uint16_t lean_uint16_of_big_nat(b_lean_obj_arg a) {
+    return (uint16_t)big_low_u64(a);
 }
 
 LEAN_EXPORT uint32_t lean_uint32_of_big_nat(b_lean_obj_arg a) {
-    (void)a;
-    return 0; /* big nat → truncate to 0 */
+    return (uint32_t)big_low_u64(a);
 }
 
 LEAN_EXPORT uint64_t lean_uint64_of_big_nat(b_lean_obj_arg a) {
-    (void)a;
-    return 0; /* big nat → truncate to 0 */
+    return big_low_u64(a);
 }
 
 /* Float array operations */
@@ -0,0 +1,149 @@
+/**
+ * lean_runtime_wasm.h — WASM-specific runtime hooks
+ *
+ * Entry points that lean_runtime_wasm.c provides on top of the standard
+ * lean.h runtime ABI, for use by wasm_glue.c. They are always defined;
+ * in builds without the corresponding feature flag they are no-ops.
+ */
+#pragma once
+#include <lean/lean.h>
+
+/* ── Per-call arena (LEAN_WASM_ARENA) ─────────────────────────── */
+
+/**
+ * Open the per-call arena. Until the matching lean_wasm_arena_end(), small
+ * objects are bump-allocated from one region instead of malloc'd. Calls
+ * nest; only the outermost pair opens and resets the region.
+ */
+void lean_wasm_arena_begin(void);
+
+/**
+ * Close the per-call arena. The region is reset for the next call once no
+ * object allocated in it is still alive.
+ */
+void lean_wasm_arena_end(void);
+
+/**
+ * Move `o` out of the arena so it can outlive the current call. Only leaf
+ * objects (ByteArray, String) can be promoted. Consumes `o`; returns `o`
+ * itself if it is not an arena object.
+ */
+lean_obj_res lean_wasm_arena_promote(lean_obj_arg o);
+
+/* ── Deferred freeing (LEAN_WASM_DEFERRED_FREE) ───────────────── */
+
+/**
+ * Release the objects freed since the last drain back to the allocator in
+ * one batch. Called at the end of every exported call.
+ */
+void lean_wasm_free_drain(void);
+
+/* ── Random bytes ─────────────────────────────────────────────── */
+
+/**
+ * Fill `dst` with `n` bytes from the runtime's HMAC_DRBG, which is seeded
+ * from host entropy (crypto.getRandomValues under Emscripten). This is
+ * the source behind IO.getRandomBytes. Aborts if the host has no entropy.
+ */
+void lean_wasm_random_bytes(uint8_t *dst, size_t n);
+
+/* ── Multi-buffer SHA-256 ─────────────────────────────────────── */
+
+typedef struct {
+    const uint8_t *data;
+    size_t         len;
+} lean_wasm_bytes;
+
+/**
+ * SHA-256 of each of the `n` messages in `msgs`, written to `out` as `n`
+ * consecutive 32-byte digests. Messages are hashed lean_wasm_sha256_lanes()
+ * at a time in SIMD lanes (4 with wasm simd128 or SSE2, 8 with AVX2, else
+ * 1), so many short messages cost about as much as a few long ones.
+ */
+void lean_wasm_sha256_many(const lean_wasm_bytes *msgs, size_t n, uint8_t *out);
+
+/** Messages lean_wasm_sha256_many() hashes side by side. */
+size_t lean_wasm_sha256_lanes(void);
+
+/* ── Monotonic clock ──────────────────────────────────────────── */
+
+/**
+ * Nanoseconds from an arbitrary fixed origin, never decreasing. Backs
+ * IO.monoMsNow and IO.monoNanosNow.
+ */
+uint64_t lean_wasm_mono_ns(void);
+
+/* ── Allocation statistics (LEAN_WASM_ALLOC_STATS) ────────────── */
+
+enum {
+    LEAN_WASM_STAT_TAGS  = 6,   /* ctor, closure, array, sarray, string, other */
+    LEAN_WASM_STAT_SIZES = 9    /* ≤16, ≤32, … ≤1024, ≤4096, larger */
+};
+
+typedef struct {
+    uint64_t allocs[LEAN_WASM_STAT_TAGS];       /* allocations by tag */
+    uint64_t bytes[LEAN_WASM_STAT_TAGS];        /* bytes allocated by tag */
+    uint64_t size_allocs[LEAN_WASM_STAT_SIZES]; /* allocations by size class */
+    uint64_t frees;
+    uint64_t live_bytes;
+    uint64_t peak_bytes;
+} lean_wasm_alloc_stats;
+
+/** Copy the counters into `out`. All zero in builds without the flag. */
+void lean_wasm_alloc_stats_get(lean_wasm_alloc_stats *out);
+
+/** Zero the counters. Live bytes are kept; peak restarts from them. */
+void lean_wasm_alloc_stats_reset(void);
+
+/* ── Copy-on-write counters (LEAN_WASM_COW_STATS) ─────────────── */
+
+/* Runtime paths that copy an object because it is shared. */
+enum {
+    LEAN_WASM_COW_ARRAY,            /* lean_copy_expand_array, lean_array_push */
+    LEAN_WASM_COW_ARRAY_MAP,        /* Array.mapMUnsafe.map */
+    LEAN_WASM_COW_BYTE_ARRAY,       /* lean_copy_byte_array, lean_byte_array_push */
+    LEAN_WASM_COW_BYTE_ARRAY_SLICE, /* lean_byte_array_copy_slice */
+    LEAN_WASM_COW_STRING_PUSH,      /* lean_string_push */
+    LEAN_WASM_COW_STRING_APPEND,    /* lean_string_append */
+    LEAN_WASM_COW_STRING_SET,       /* lean_string_utf8_set */
+    LEAN_WASM_COW_KINDS
+};
+
+typedef struct {
+    uint64_t copies[LEAN_WASM_COW_KINDS];
+    uint64_t bytes[LEAN_WASM_COW_KINDS];
+} lean_wasm_cow_stats;
+
+/**
+ * Record one copy of `bytes` bytes. `site` is the code address the copy
+ * is attributed to, or NULL. Use LEAN_WASM_COW() rather than calling this
+ * directly.
+ */
+void lean_wasm_cow_note(unsigned kind, size_t bytes, void *site);
+
+/** Copy the counters into `out`. All zero in builds without the flag. */
+void lean_wasm_cow_stats_get(lean_wasm_cow_stats *out);
+
+/** Zero the counters and the call-site table. */
+void lean_wasm_cow_stats_reset(void);
+
+/**
+ * Print the counters to stderr, followed on native builds by the call
+ * sites that copied most (resolve them with addr2line).
+ */
+void lean_wasm_cow_dump(void);
+
+/*
+ * LEAN_WASM_COW(kind, bytes) records a copy in the calling function. On
+ * native builds it is attributed to that function's caller through
+ * __builtin_return_address. WASM has no usable return addresses, so
+ * there only the per-kind counters are kept.
+ */
+#if !defined(LEAN_WASM_COW_STATS)
+#define LEAN_WASM_COW(kind, bytes) ((void)0)
+#elif defined(__EMSCRIPTEN__)
+#define LEAN_WASM_COW(kind, bytes) lean_wasm_cow_note((kind), (bytes), NULL)
+#else
+#define LEAN_WASM_COW(kind, bytes) \
+    lean_wasm_cow_note((kind), (bytes), __builtin_return_address(0))
+#endif
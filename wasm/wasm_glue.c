@@ -9,15 +9,39 @@
  *
  * The exported WASM functions follow the naming convention:
  *   js_<operation>(ptr, len, ...) → ptr
- * where returned ptr points to a length-prefixed buffer in WASM memory.
+ * where returned ptr points to a malloc'd copy of the result payload, and
+ * its length is stored in the trailing `out_len` argument. Operations whose
+ * Lean export returns `Option ByteArray` (AES-GCM decrypt, Huffman decode)
+ * report `none` as JS_RESULT_NONE instead of a length.
+ *
+ * Each operation also has a handle variant:
+ *   js_<operation>_h(handle, ...) → ptr
+ * taking ByteArrays from js_alloc_byte_array() whose payload JS has filled
+ * in place. This skips the staging malloc and the copy into Lean memory.
+ * Handles are consumed by the call.
+ *
+ * The js_<operation>_into(handle, ..., dst, cap) → size_t variants write
+ * the result payload straight into a caller-chosen region instead of a
+ * fresh malloc, and return its length (or JS_RESULT_NONE). If the length
+ * exceeds `cap`, nothing is written; fetch the result with
+ * js_take_result_into().
+ *
+ * js_batch(cmds, n) runs a list of operations described in linear memory
+ * in a single call.
+ * js_sha256_many(descs, n, out) hashes many messages in one call.
  */
 
 #include <stdio.h>
 #include <lean/lean.h>
+#include "lean_runtime_wasm.h"
 #include <emscripten/emscripten.h>
 #include <string.h>
 #include <stdlib.h>
 
+/* Length reported for an `Option ByteArray` result that is `none`
+   (e.g. AES-GCM authentication failure). Never a valid length. */
+#define JS_RESULT_NONE ((size_t)-1)
+
 /* ── Stubs for @[extern] functions not available in WASM ──────── */
 
 /* SideChannel.lean: secureZero (opaque secureZero : ByteArray → IO Unit)
@@ -71,21 +95,124 @@ static const uint8_t *byte_array_data(lean_obj_arg arr, size_t *out_len) {
 }
 
 /**
- * Copy a Lean ByteArray result into a freshly malloc'd buffer,
- * prefixed with 4-byte LE length. Caller must free().
- * Note: Our WasmAPI already packs results, so this extracts and re-exports.
+ * Take the ByteArray out of an `Option ByteArray`, or return NULL for
+ * `none`. Consumes `opt`; the returned array is owned by the caller.
  */
-static uint8_t *export_byte_array(lean_obj_arg arr, size_t *total_len) {
+static lean_obj_res unwrap_option(lean_obj_arg opt) {
+    if (lean_is_scalar(opt)) return NULL;
+    lean_object *arr = lean_ctor_get(opt, 0);
+    lean_inc(arr);
+    lean_dec(opt);
+    return arr;
+}
+
+/**
+ * Copy a Lean ByteArray result into a freshly malloc'd buffer and store
+ * its length in `*out_len`. Caller must free(). Consumes `arr`.
+ */
+static uint8_t *export_byte_array(lean_obj_arg arr, size_t *out_len) {
     size_t len;
     const uint8_t *data = byte_array_data(arr, &len);
     uint8_t *buf = (uint8_t *)malloc(len);
     if (buf && len > 0) {
         memcpy(buf, data, len);
     }
-    *total_len = len;
+    *out_len = len;
+    lean_dec(arr);
     return buf;
 }
 
+/**
+ * export_byte_array() for an `Option ByteArray` result: `none` returns
+ * NULL with `*out_len` set to JS_RESULT_NONE. Consumes `opt`.
+ */
+static uint8_t *export_option(lean_obj_arg opt, size_t *out_len) {
+    lean_object *arr = unwrap_option(opt);
+    if (!arr) {
+        *out_len = JS_RESULT_NONE;
+        return NULL;
+    }
+    return export_byte_array(arr, out_len);
+}
+
+/* Result that did not fit the caller's buffer, kept for js_take_result_into */
+static lean_object *_pending_result = NULL;
+
+/**
+ * Copy a Lean ByteArray result into `dst` if it fits in `cap` bytes, and
+ * return its length. A result that does not fit is kept so the caller can
+ * fetch it into a larger buffer with js_take_result_into() instead of
+ * running the operation again. Consumes `arr`.
+ */
+static size_t export_into(lean_obj_arg arr, uint8_t *dst, size_t cap) {
+    size_t len;
+    const uint8_t *data = byte_array_data(arr, &len);
+    if (len > cap) {
+        if (_pending_result) lean_dec(_pending_result);
+        _pending_result = arr;
+        return len;
+    }
+    if (len > 0) {
+        memcpy(dst, data, len);
+    }
+    lean_dec(arr);
+    return len;
+}
+
+/**
+ * export_into() for an `Option ByteArray` result: `none` writes nothing
+ * and returns JS_RESULT_NONE. Consumes `opt`.
+ */
+static size_t export_option_into(lean_obj_arg opt, uint8_t *dst, size_t cap) {
+    lean_object *arr = unwrap_option(opt);
+    if (!arr) return JS_RESULT_NONE;
+    return export_into(arr, dst, cap);
+}
+
+/**
+ * Bracket one exported call. Inputs are built before call_begin() so they
+ * live outside the per-call arena (LEAN_WASM_ARENA builds), and results
+ * are copied out before call_end() resets it. A result parked for
+ * js_take_result_into() is promoted so it survives the reset. Objects
+ * freed during the call are released in one batch at the end
+ * (LEAN_WASM_DEFERRED_FREE builds).
+ */
+static void call_begin(void) {
+    ensure_initialized();
+    lean_wasm_arena_begin();
+}
+
+static void call_end(void) {
+    if (_pending_result)
+        _pending_result = lean_wasm_arena_promote(_pending_result);
+    lean_wasm_free_drain();
+    lean_wasm_arena_end();
+}
+
+/* ── Zero-copy input handles ───────────────────────────────────── */
+
+/**
+ * Allocate an uninitialized Lean ByteArray of `len` bytes and store its
+ * payload address in `*out_data`, so JS can write the argument directly
+ * into Lean memory. The handle is owned by the caller until it is passed
+ * to a js_*_h function (which consumes it) or released with
+ * js_free_byte_array().
+ */
+EMSCRIPTEN_KEEPALIVE
+lean_object *js_alloc_byte_array(size_t len, uint8_t **out_data) {
+    lean_obj_res arr = lean_alloc_sarray(1, len, len);
+    *out_data = lean_sarray_cptr(arr);
+    return arr;
+}
+
+/**
+ * Release a handle from js_alloc_byte_array() that was never consumed.
+ */
+EMSCRIPTEN_KEEPALIVE
+void js_free_byte_array(lean_object *arr) {
+    lean_dec(arr);
+}
+
 /* ── Exported WASM functions (called from JavaScript) ──────────── */
 
 /* Forward declarations of Lean @[export] functions */
@@ -110,165 +237,713 @@ extern lean_obj_res wasm_tls_derive_application(lean_obj_arg hs, lean_obj_arg hh
 
 /* ── SHA-256 ──────────────────────────────────────────────────── */
 
+EMSCRIPTEN_KEEPALIVE
+uint8_t *js_sha256_h(lean_obj_arg data, size_t *out_len) {
+    call_begin();
+    uint8_t *buf = export_byte_array(wasm_sha256(data), out_len);
+    call_end();
+    return buf;
+}
+
+EMSCRIPTEN_KEEPALIVE
+size_t js_sha256_into(lean_obj_arg data, uint8_t *dst, size_t cap) {
+    call_begin();
+    size_t n = export_into(wasm_sha256(data), dst, cap);
+    call_end();
+    return n;
+}
+
 EMSCRIPTEN_KEEPALIVE
 uint8_t *js_sha256(const uint8_t *data, size_t len, size_t *out_len) {
-    ensure_initialized();
-    lean_obj_res arr = mk_byte_array(data, len);
-    lean_obj_res result = wasm_sha256(arr);
-    return export_byte_array(result, out_len);
+    return js_sha256_h(mk_byte_array(data, len), out_len);
 }
 
 /* ── HMAC-SHA-256 ─────────────────────────────────────────────── */
 
+EMSCRIPTEN_KEEPALIVE
+uint8_t *js_hmac_sha256_h(lean_obj_arg key,
+                          lean_obj_arg msg,
+                          size_t *out_len) {
+    call_begin();
+    uint8_t *buf = export_byte_array(wasm_hmac_sha256(key, msg), out_len);
+    call_end();
+    return buf;
+}
+
+EMSCRIPTEN_KEEPALIVE
+size_t js_hmac_sha256_into(lean_obj_arg key,
+                           lean_obj_arg msg,
+                           uint8_t *dst, size_t cap) {
+    call_begin();
+    size_t n = export_into(wasm_hmac_sha256(key, msg), dst, cap);
+    call_end();
+    return n;
+}
+
 EMSCRIPTEN_KEEPALIVE
 uint8_t *js_hmac_sha256(const uint8_t *key, size_t klen,
                          const uint8_t *msg, size_t mlen,
                          size_t *out_len) {
-    ensure_initialized();
-    lean_obj_res k = mk_byte_array(key, klen);
-    lean_obj_res m = mk_byte_array(msg, mlen);
-    lean_obj_res result = wasm_hmac_sha256(k, m);
-    return export_byte_array(result, out_len);
+    return js_hmac_sha256_h(mk_byte_array(key, klen),
+                            mk_byte_array(msg, mlen),
+                            out_len);
 }
 
 /* ── HKDF-Extract ─────────────────────────────────────────────── */
 
+EMSCRIPTEN_KEEPALIVE
+uint8_t *js_hkdf_extract_h(lean_obj_arg salt,
+                           lean_obj_arg ikm,
+                           size_t *out_len) {
+    call_begin();
+    uint8_t *buf = export_byte_array(wasm_hkdf_extract(salt, ikm), out_len);
+    call_end();
+    return buf;
+}
+
+EMSCRIPTEN_KEEPALIVE
+size_t js_hkdf_extract_into(lean_obj_arg salt,
+                            lean_obj_arg ikm,
+                            uint8_t *dst, size_t cap) {
+    call_begin();
+    size_t n = export_into(wasm_hkdf_extract(salt, ikm), dst, cap);
+    call_end();
+    return n;
+}
+
 EMSCRIPTEN_KEEPALIVE
 uint8_t *js_hkdf_extract(const uint8_t *salt, size_t slen,
                           const uint8_t *ikm, size_t ilen,
                           size_t *out_len) {
-    ensure_initialized();
-    lean_obj_res s = mk_byte_array(salt, slen);
-    lean_obj_res i = mk_byte_array(ikm, ilen);
-    lean_obj_res result = wasm_hkdf_extract(s, i);
-    return export_byte_array(result, out_len);
+    return js_hkdf_extract_h(mk_byte_array(salt, slen),
+                             mk_byte_array(ikm, ilen),
+                             out_len);
 }
 
 /* ── AES-128-GCM Encrypt ─────────────────────────────────────── */
 
+EMSCRIPTEN_KEEPALIVE
+uint8_t *js_aes_gcm_encrypt_h(lean_obj_arg key,
+                              lean_obj_arg iv,
+                              lean_obj_arg aad,
+                              lean_obj_arg pt,
+                              size_t *out_len) {
+    call_begin();
+    uint8_t *buf = export_byte_array(wasm_aes_gcm_encrypt(key, iv, aad, pt), out_len);
+    call_end();
+    return buf;
+}
+
+EMSCRIPTEN_KEEPALIVE
+size_t js_aes_gcm_encrypt_into(lean_obj_arg key,
+                               lean_obj_arg iv,
+                               lean_obj_arg aad,
+                               lean_obj_arg pt,
+                               uint8_t *dst, size_t cap) {
+    call_begin();
+    size_t n = export_into(wasm_aes_gcm_encrypt(key, iv, aad, pt), dst, cap);
+    call_end();
+    return n;
+}
+
 EMSCRIPTEN_KEEPALIVE
 uint8_t *js_aes_gcm_encrypt(const uint8_t *key, size_t klen,
                               const uint8_t *iv, size_t ivlen,
                               const uint8_t *aad, size_t alen,
                               const uint8_t *pt, size_t ptlen,
                               size_t *out_len) {
-    ensure_initialized();
-    lean_obj_res k = mk_byte_array(key, klen);
-    lean_obj_res v = mk_byte_array(iv, ivlen);
-    lean_obj_res a = mk_byte_array(aad, alen);
-    lean_obj_res p = mk_byte_array(pt, ptlen);
-    lean_obj_res result = wasm_aes_gcm_encrypt(k, v, a, p);
-    return export_byte_array(result, out_len);
+    return js_aes_gcm_encrypt_h(mk_byte_array(key, klen),
+                                mk_byte_array(iv, ivlen),
+                                mk_byte_array(aad, alen),
+                                mk_byte_array(pt, ptlen),
+                                out_len);
 }
 
 /* ── AES-128-GCM Decrypt ─────────────────────────────────────── */
 
+EMSCRIPTEN_KEEPALIVE
+uint8_t *js_aes_gcm_decrypt_h(lean_obj_arg key,
+                              lean_obj_arg iv,
+                              lean_obj_arg aad,
+                              lean_obj_arg ct,
+                              size_t *out_len) {
+    call_begin();
+    uint8_t *buf = export_option(wasm_aes_gcm_decrypt(key, iv, aad, ct), out_len);
+    call_end();
+    return buf;
+}
+
+EMSCRIPTEN_KEEPALIVE
+size_t js_aes_gcm_decrypt_into(lean_obj_arg key,
+                               lean_obj_arg iv,
+                               lean_obj_arg aad,
+                               lean_obj_arg ct,
+                               uint8_t *dst, size_t cap) {
+    call_begin();
+    size_t n = export_option_into(wasm_aes_gcm_decrypt(key, iv, aad, ct), dst, cap);
+    call_end();
+    return n;
+}
+
 EMSCRIPTEN_KEEPALIVE
 uint8_t *js_aes_gcm_decrypt(const uint8_t *key, size_t klen,
                               const uint8_t *iv, size_t ivlen,
                               const uint8_t *aad, size_t alen,
                               const uint8_t *ct, size_t ctlen,
                               size_t *out_len) {
-    ensure_initialized();
-    lean_obj_res k = mk_byte_array(key, klen);
-    lean_obj_res v = mk_byte_array(iv, ivlen);
-    lean_obj_res a = mk_byte_array(aad, alen);
-    lean_obj_res c = mk_byte_array(ct, ctlen);
-    lean_obj_res result = wasm_aes_gcm_decrypt(k, v, a, c);
-    return export_byte_array(result, out_len);
+    return js_aes_gcm_decrypt_h(mk_byte_array(key, klen),
+                                mk_byte_array(iv, ivlen),
+                                mk_byte_array(aad, alen),
+                                mk_byte_array(ct, ctlen),
+                                out_len);
 }
 
 /* ── X25519 ───────────────────────────────────────────────────── */
 
+EMSCRIPTEN_KEEPALIVE
+uint8_t *js_x25519_base_h(lean_obj_arg privkey, size_t *out_len) {
+    call_begin();
+    uint8_t *buf = export_byte_array(wasm_x25519_base(privkey), out_len);
+    call_end();
+    return buf;
+}
+
+EMSCRIPTEN_KEEPALIVE
+size_t js_x25519_base_into(lean_obj_arg privkey, uint8_t *dst, size_t cap) {
+    call_begin();
+    size_t n = export_into(wasm_x25519_base(privkey), dst, cap);
+    call_end();
+    return n;
+}
+
 EMSCRIPTEN_KEEPALIVE
 uint8_t *js_x25519_base(const uint8_t *privkey, size_t len, size_t *out_len) {
-    ensure_initialized();
-    lean_obj_res pk = mk_byte_array(privkey, len);
-    lean_obj_res result = wasm_x25519_base(pk);
-    return export_byte_array(result, out_len);
+    return js_x25519_base_h(mk_byte_array(privkey, len), out_len);
+}
+
+EMSCRIPTEN_KEEPALIVE
+uint8_t *js_x25519_scalarmult_h(lean_obj_arg scalar,
+                                lean_obj_arg point,
+                                size_t *out_len) {
+    call_begin();
+    uint8_t *buf = export_byte_array(wasm_x25519_scalarmult(scalar, point), out_len);
+    call_end();
+    return buf;
+}
+
+EMSCRIPTEN_KEEPALIVE
+size_t js_x25519_scalarmult_into(lean_obj_arg scalar,
+                                 lean_obj_arg point,
+                                 uint8_t *dst, size_t cap) {
+    call_begin();
+    size_t n = export_into(wasm_x25519_scalarmult(scalar, point), dst, cap);
+    call_end();
+    return n;
 }
 
 EMSCRIPTEN_KEEPALIVE
 uint8_t *js_x25519_scalarmult(const uint8_t *scalar, size_t slen,
                                 const uint8_t *point, size_t plen,
                                 size_t *out_len) {
-    ensure_initialized();
-    lean_obj_res s = mk_byte_array(scalar, slen);
-    lean_obj_res p = mk_byte_array(point, plen);
-    lean_obj_res result = wasm_x25519_scalarmult(s, p);
-    return export_byte_array(result, out_len);
+    return js_x25519_scalarmult_h(mk_byte_array(scalar, slen),
+                                  mk_byte_array(point, plen),
+                                  out_len);
+}
+
+/**
+ * Build a fresh X25519 key pair as one 64-byte ByteArray: the private key
+ * (32 bytes from lean_wasm_random_bytes) followed by its public key.
+ */
+static lean_obj_res x25519_keypair(void) {
+    lean_object *priv = lean_alloc_sarray(1, 32, 32);
+    lean_wasm_random_bytes(lean_sarray_cptr(priv), 32);
+    lean_inc(priv);
+    lean_object *pub = wasm_x25519_base(priv);
+    lean_object *pair = lean_alloc_sarray(1, 64, 64);
+    memcpy(lean_sarray_cptr(pair), lean_sarray_cptr(priv), 32);
+    memcpy(lean_sarray_cptr(pair) + 32, lean_sarray_cptr(pub), 32);
+    memset(lean_sarray_cptr(priv), 0, 32);
+    lean_dec(priv);
+    lean_dec(pub);
+    return pair;
+}
+
+EMSCRIPTEN_KEEPALIVE
+uint8_t *js_x25519_keypair(size_t *out_len) {
+    call_begin();
+    uint8_t *buf = export_byte_array(x25519_keypair(), out_len);
+    call_end();
+    return buf;
+}
+
+EMSCRIPTEN_KEEPALIVE
+size_t js_x25519_keypair_into(uint8_t *dst, size_t cap) {
+    call_begin();
+    size_t n = export_into(x25519_keypair(), dst, cap);
+    call_end();
+    return n;
 }
 
 /* ── Hex encoding ─────────────────────────────────────────────── */
 
+EMSCRIPTEN_KEEPALIVE
+uint8_t *js_bytes_to_hex_h(lean_obj_arg data, size_t *out_len) {
+    call_begin();
+    uint8_t *buf = export_byte_array(wasm_bytes_to_hex(data), out_len);
+    call_end();
+    return buf;
+}
+
+EMSCRIPTEN_KEEPALIVE
+size_t js_bytes_to_hex_into(lean_obj_arg data, uint8_t *dst, size_t cap) {
+    call_begin();
+    size_t n = export_into(wasm_bytes_to_hex(data), dst, cap);
+    call_end();
+    return n;
+}
+
 EMSCRIPTEN_KEEPALIVE
 uint8_t *js_bytes_to_hex(const uint8_t *data, size_t len, size_t *out_len) {
-    ensure_initialized();
-    lean_obj_res arr = mk_byte_array(data, len);
-    lean_obj_res result = wasm_bytes_to_hex(arr);
-    return export_byte_array(result, out_len);
+    return js_bytes_to_hex_h(mk_byte_array(data, len), out_len);
 }
 
 /* ── HPACK decode ─────────────────────────────────────────────── */
 
+EMSCRIPTEN_KEEPALIVE
+uint8_t *js_hpack_decode_h(lean_obj_arg data, size_t *out_len) {
+    call_begin();
+    uint8_t *buf = export_byte_array(wasm_hpack_decode(data), out_len);
+    call_end();
+    return buf;
+}
+
+EMSCRIPTEN_KEEPALIVE
+size_t js_hpack_decode_into(lean_obj_arg data, uint8_t *dst, size_t cap) {
+    call_begin();
+    size_t n = export_into(wasm_hpack_decode(data), dst, cap);
+    call_end();
+    return n;
+}
+
 EMSCRIPTEN_KEEPALIVE
 uint8_t *js_hpack_decode(const uint8_t *data, size_t len, size_t *out_len) {
-    ensure_initialized();
-    lean_obj_res arr = mk_byte_array(data, len);
-    lean_obj_res result = wasm_hpack_decode(arr);
-    return export_byte_array(result, out_len);
+    return js_hpack_decode_h(mk_byte_array(data, len), out_len);
 }
 
 /* ── Huffman encode/decode ────────────────────────────────────── */
 
+EMSCRIPTEN_KEEPALIVE
+uint8_t *js_huffman_encode_h(lean_obj_arg data, size_t *out_len) {
+    call_begin();
+    uint8_t *buf = export_byte_array(wasm_huffman_encode(data), out_len);
+    call_end();
+    return buf;
+}
+
+EMSCRIPTEN_KEEPALIVE
+size_t js_huffman_encode_into(lean_obj_arg data, uint8_t *dst, size_t cap) {
+    call_begin();
+    size_t n = export_into(wasm_huffman_encode(data), dst, cap);
+    call_end();
+    return n;
+}
+
 EMSCRIPTEN_KEEPALIVE
 uint8_t *js_huffman_encode(const uint8_t *data, size_t len, size_t *out_len) {
-    ensure_initialized();
-    lean_obj_res arr = mk_byte_array(data, len);
-    lean_obj_res result = wasm_huffman_encode(arr);
-    return export_byte_array(result, out_len);
+    return js_huffman_encode_h(mk_byte_array(data, len), out_len);
+}
+
+EMSCRIPTEN_KEEPALIVE
+uint8_t *js_huffman_decode_h(lean_obj_arg data, size_t *out_len) {
+    call_begin();
+    uint8_t *buf = export_option(wasm_huffman_decode(data), out_len);
+    call_end();
+    return buf;
+}
+
+EMSCRIPTEN_KEEPALIVE
+size_t js_huffman_decode_into(lean_obj_arg data, uint8_t *dst, size_t cap) {
+    call_begin();
+    size_t n = export_option_into(wasm_huffman_decode(data), dst, cap);
+    call_end();
+    return n;
 }
 
 EMSCRIPTEN_KEEPALIVE
 uint8_t *js_huffman_decode(const uint8_t *data, size_t len, size_t *out_len) {
-    ensure_initialized();
-    lean_obj_res arr = mk_byte_array(data, len);
-    lean_obj_res result = wasm_huffman_decode(arr);
-    return export_byte_array(result, out_len);
+    return js_huffman_decode_h(mk_byte_array(data, len), out_len);
 }
 
 /* ── TLS Key Derivation ───────────────────────────────────────── */
 
+EMSCRIPTEN_KEEPALIVE
+uint8_t *js_tls_derive_handshake_h(lean_obj_arg ss,
+                                   lean_obj_arg hh,
+                                   size_t *out_len) {
+    call_begin();
+    uint8_t *buf = export_byte_array(wasm_tls_derive_handshake(ss, hh), out_len);
+    call_end();
+    return buf;
+}
+
+EMSCRIPTEN_KEEPALIVE
+size_t js_tls_derive_handshake_into(lean_obj_arg ss,
+                                    lean_obj_arg hh,
+                                    uint8_t *dst, size_t cap) {
+    call_begin();
+    size_t n = export_into(wasm_tls_derive_handshake(ss, hh), dst, cap);
+    call_end();
+    return n;
+}
+
 EMSCRIPTEN_KEEPALIVE
 uint8_t *js_tls_derive_handshake(const uint8_t *ss, size_t sslen,
                                    const uint8_t *hh, size_t hhlen,
                                    size_t *out_len) {
-    ensure_initialized();
-    lean_obj_res s = mk_byte_array(ss, sslen);
-    lean_obj_res h = mk_byte_array(hh, hhlen);
-    lean_obj_res result = wasm_tls_derive_handshake(s, h);
-    return export_byte_array(result, out_len);
+    return js_tls_derive_handshake_h(mk_byte_array(ss, sslen),
+                                     mk_byte_array(hh, hhlen),
+                                     out_len);
+}
+
+EMSCRIPTEN_KEEPALIVE
+uint8_t *js_tls_derive_application_h(lean_obj_arg hs,
+                                     lean_obj_arg hh,
+                                     size_t *out_len) {
+    call_begin();
+    uint8_t *buf = export_byte_array(wasm_tls_derive_application(hs, hh), out_len);
+    call_end();
+    return buf;
+}
+
+EMSCRIPTEN_KEEPALIVE
+size_t js_tls_derive_application_into(lean_obj_arg hs,
+                                      lean_obj_arg hh,
+                                      uint8_t *dst, size_t cap) {
+    call_begin();
+    size_t n = export_into(wasm_tls_derive_application(hs, hh), dst, cap);
+    call_end();
+    return n;
 }
 
 EMSCRIPTEN_KEEPALIVE
 uint8_t *js_tls_derive_application(const uint8_t *hs, size_t hslen,
                                      const uint8_t *hh, size_t hhlen,
                                      size_t *out_len) {
-    ensure_initialized();
-    lean_obj_res s = mk_byte_array(hs, hslen);
-    lean_obj_res h = mk_byte_array(hh, hhlen);
-    lean_obj_res result = wasm_tls_derive_application(s, h);
-    return export_byte_array(result, out_len);
+    return js_tls_derive_application_h(mk_byte_array(hs, hslen),
+                                       mk_byte_array(hh, hhlen),
+                                       out_len);
 }
 
 /* ── HTTP/2 frame parse ───────────────────────────────────────── */
 
+EMSCRIPTEN_KEEPALIVE
+uint8_t *js_http2_parse_frame_h(lean_obj_arg data, size_t *out_len) {
+    call_begin();
+    uint8_t *buf = export_byte_array(wasm_http2_parse_frame(data), out_len);
+    call_end();
+    return buf;
+}
+
+EMSCRIPTEN_KEEPALIVE
+size_t js_http2_parse_frame_into(lean_obj_arg data, uint8_t *dst, size_t cap) {
+    call_begin();
+    size_t n = export_into(wasm_http2_parse_frame(data), dst, cap);
+    call_end();
+    return n;
+}
+
 EMSCRIPTEN_KEEPALIVE
 uint8_t *js_http2_parse_frame(const uint8_t *data, size_t len, size_t *out_len) {
-    ensure_initialized();
-    lean_obj_res arr = mk_byte_array(data, len);
-    lean_obj_res result = wasm_http2_parse_frame(arr);
-    return export_byte_array(result, out_len);
+    return js_http2_parse_frame_h(mk_byte_array(data, len), out_len);
+}
+
+/* ── Command batches ──────────────────────────────────────────── */
+
+/* Opcodes of js_batch_cmd.op. The order is that of OPS in
+   lean_server_wasm.js. */
+typedef enum {
+    JS_OP_SHA256,
+    JS_OP_HMAC_SHA256,
+    JS_OP_HKDF_EXTRACT,
+    JS_OP_AES_GCM_ENCRYPT,
+    JS_OP_AES_GCM_DECRYPT,
+    JS_OP_X25519_BASE,
+    JS_OP_X25519_SCALARMULT,
+    JS_OP_X25519_KEYPAIR,
+    JS_OP_BYTES_TO_HEX,
+    JS_OP_HPACK_DECODE,
+    JS_OP_HUFFMAN_ENCODE,
+    JS_OP_HUFFMAN_DECODE,
+    JS_OP_TLS_DERIVE_HANDSHAKE,
+    JS_OP_TLS_DERIVE_APPLICATION,
+    JS_OP_HTTP2_PARSE_FRAME,
+    JS_OP_COUNT
+} js_op;
+
+/* Byte-array arguments each opcode takes */
+static const uint8_t js_op_arity[JS_OP_COUNT] = {
+    1, 2, 2, 4, 4, 1, 2, 0, 1, 1, 1, 1, 2, 2, 1
+};
+
+/**
+ * One command of js_batch(): 16 little-endian 32-bit words. Arguments
+ * and output are addresses in linear memory. out_len receives what the
+ * matching js_*_into call would return: the result length (nothing is
+ * written if it exceeds out_cap) or JS_RESULT_NONE.
+ */
+typedef struct {
+    uint32_t op;
+    uint32_t arg_off[4];
+    uint32_t arg_len[4];
+    uint32_t out_off;
+    uint32_t out_cap;
+    uint32_t out_len;
+    uint32_t reserved[4];
+} js_batch_cmd;
+
+_Static_assert(sizeof(js_batch_cmd) == 64, "js_batch_cmd is 16 words");
+
+static lean_obj_res js_op_run(js_op op, lean_object **a, bool *is_option) {
+    *is_option = false;
+    switch (op) {
+    case JS_OP_SHA256:                 return wasm_sha256(a[0]);
+    case JS_OP_HMAC_SHA256:            return wasm_hmac_sha256(a[0], a[1]);
+    case JS_OP_HKDF_EXTRACT:           return wasm_hkdf_extract(a[0], a[1]);
+    case JS_OP_AES_GCM_ENCRYPT:        return wasm_aes_gcm_encrypt(a[0], a[1], a[2], a[3]);
+    case JS_OP_AES_GCM_DECRYPT:
+        *is_option = true;
+        return wasm_aes_gcm_decrypt(a[0], a[1], a[2], a[3]);
+    case JS_OP_X25519_BASE:            return wasm_x25519_base(a[0]);
+    case JS_OP_X25519_SCALARMULT:      return wasm_x25519_scalarmult(a[0], a[1]);
+    case JS_OP_X25519_KEYPAIR:         return x25519_keypair();
+    case JS_OP_BYTES_TO_HEX:           return wasm_bytes_to_hex(a[0]);
+    case JS_OP_HPACK_DECODE:           return wasm_hpack_decode(a[0]);
+    case JS_OP_HUFFMAN_ENCODE:         return wasm_huffman_encode(a[0]);
+    case JS_OP_HUFFMAN_DECODE:
+        *is_option = true;
+        return wasm_huffman_decode(a[0]);
+    case JS_OP_TLS_DERIVE_HANDSHAKE:   return wasm_tls_derive_handshake(a[0], a[1]);
+    case JS_OP_TLS_DERIVE_APPLICATION: return wasm_tls_derive_application(a[0], a[1]);
+    case JS_OP_HTTP2_PARSE_FRAME:      return wasm_http2_parse_frame(a[0]);
+    case JS_OP_COUNT:
+    default: lean_internal_panic("js_op_run: unknown opcode"); return NULL;
+    }
+}
+
+/**
+ * Run `n` commands in order within one call, so several small operations
+ * cost one crossing from JS. Each command is bracketed like a call of
+ * its own: its arguments are read and built just before its call_begin(),
+ * so a command can take an earlier command's output as input. Results
+ * that do not fit are dropped rather than kept for js_take_result_into().
+ * Returns the number of commands run: `n`, or the index of the first
+ * command with an unknown opcode.
+ */
+EMSCRIPTEN_KEEPALIVE
+size_t js_batch(js_batch_cmd *cmds, size_t n) {
+    size_t i;
+    for (i = 0; i < n; i++) {
+        js_batch_cmd *c = &cmds[i];
+        if (c->op >= JS_OP_COUNT) break;
+        lean_object *args[4];
+        for (unsigned k = 0; k < js_op_arity[c->op]; k++)
+            args[k] = mk_byte_array((const uint8_t *)(uintptr_t)c->arg_off[k], c->arg_len[k]);
+        call_begin();
+        bool is_option;
+        lean_object *r = js_op_run((js_op)c->op, args, &is_option);
+        if (is_option && !(r = unwrap_option(r))) {
+            c->out_len = (uint32_t)JS_RESULT_NONE;
+        } else {
+            size_t len;
+            const uint8_t *data = byte_array_data(r, &len);
+            if (len <= c->out_cap && len > 0)
+                memcpy((uint8_t *)(uintptr_t)c->out_off, data, len);
+            c->out_len = (uint32_t)len;
+            lean_dec(r);
+        }
+        call_end();
+    }
+    return i;
+}
+
+/* ── Batched SHA-256 ─────────────────────────────────────────── */
+
+/** One message for js_sha256_many(): address and length in linear memory. */
+typedef struct {
+    uint32_t off;
+    uint32_t len;
+} js_sha256_desc;
+
+/* 0 until the first js_sha256_many(), then 1 if the runtime's
+   multi-buffer SHA-256 agreed with LeanServer.sha256, -1 if not. */
+static int _sha256_many_ok = 0;
+
+/* Hash every length from 0 to 129 bytes (one to three blocks, each
+   padding case) with both implementations. */
+static bool sha256_many_self_check(void) {
+    enum { N = 130 };
+    uint8_t msg[N];
+    lean_wasm_bytes msgs[N];
+    uint8_t digests[N * 32];
+    for (size_t i = 0; i < N; i++) {
+        msg[i] = (uint8_t)(i * 131 + 7);
+        msgs[i].data = msg;
+        msgs[i].len = i;
+    }
+    lean_wasm_sha256_many(msgs, N, digests);
+    bool ok = true;
+    for (size_t i = 0; i < N && ok; i++) {
+        size_t len;
+        lean_object *r = wasm_sha256(mk_byte_array(msg, i));
+        const uint8_t *d = byte_array_data(r, &len);
+        ok = len == 32 && memcmp(d, digests + 32 * i, 32) == 0;
+        lean_dec(r);
+    }
+    return ok;
+}
+
+/**
+ * SHA-256 of `n` messages, written to `out` as `n` consecutive 32-byte
+ * digests. The messages are hashed several at a time in SIMD lanes by
+ * the runtime (lean_wasm_sha256_many). The first call checks that path
+ * against LeanServer.sha256 and, should they ever disagree, every call
+ * uses LeanServer.sha256 instead. Returns `n`.
+ */
+EMSCRIPTEN_KEEPALIVE
+size_t js_sha256_many(const js_sha256_desc *descs, size_t n, uint8_t *out) {
+    call_begin();
+    if (_sha256_many_ok == 0) {
+        _sha256_many_ok = sha256_many_self_check() ? 1 : -1;
+        if (_sha256_many_ok < 0)
+            fprintf(stderr, "js_sha256_many: multi-buffer SHA-256 disagrees with "
+                            "LeanServer.sha256, using LeanServer.sha256\n");
+    }
+    if (_sha256_many_ok > 0) {
+        lean_wasm_bytes chunk[64];
+        for (size_t i = 0; i < n; i += 64) {
+            size_t k = n - i < 64 ? n - i : 64;
+            for (size_t j = 0; j < k; j++) {
+                chunk[j].data = (const uint8_t *)(uintptr_t)descs[i + j].off;
+                chunk[j].len = descs[i + j].len;
+            }
+            lean_wasm_sha256_many(chunk, k, out + 32 * i);
+        }
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            lean_object *r = wasm_sha256(
+                mk_byte_array((const uint8_t *)(uintptr_t)descs[i].off, descs[i].len));
+            size_t len;
+            memcpy(out + 32 * i, byte_array_data(r, &len), 32);
+            lean_dec(r);
+        }
+    }
+    call_end();
+    return n;
+}
+
+/* ── Caller-provided output buffers ────────────────────────────── */
+
+/**
+ * Copy the result kept by the last js_*_into call whose `cap` was too
+ * small into `dst`, and release it. Returns the number of bytes written,
+ * or 0 if no result is pending or it still does not fit.
+ */
+EMSCRIPTEN_KEEPALIVE
+size_t js_take_result_into(uint8_t *dst, size_t cap) {
+    lean_object *arr = _pending_result;
+    if (!arr) return 0;
+    size_t len;
+    const uint8_t *data = byte_array_data(arr, &len);
+    if (len > cap) return 0;
+    _pending_result = NULL;
+    if (len > 0) {
+        memcpy(dst, data, len);
+    }
+    lean_dec(arr);
+    return len;
+}
+
+/* ── Allocation statistics (LEAN_WASM_ALLOC_STATS builds) ────── */
+
+#define JS_ALLOC_STATS_COUNT \
+    (2 * LEAN_WASM_STAT_TAGS + LEAN_WASM_STAT_SIZES + 3)
+
+/**
+ * Copy the runtime's allocation counters into `dst` as doubles, in
+ * lean_wasm_alloc_stats field order: allocs by tag, bytes by tag,
+ * allocs by size class, frees, live bytes, peak bytes. Writes at most
+ * `cap` values. Returns the number of counters, or 0 if the build was
+ * made without LEAN_WASM_ALLOC_STATS.
+ */
+EMSCRIPTEN_KEEPALIVE
+size_t js_alloc_stats(double *dst, size_t cap) {
+#ifdef LEAN_WASM_ALLOC_STATS
+    lean_wasm_alloc_stats st;
+    lean_wasm_alloc_stats_get(&st);
+    double vals[JS_ALLOC_STATS_COUNT];
+    size_t n = 0;
+    for (unsigned i = 0; i < LEAN_WASM_STAT_TAGS; i++) vals[n++] = (double)st.allocs[i];
+    for (unsigned i = 0; i < LEAN_WASM_STAT_TAGS; i++) vals[n++] = (double)st.bytes[i];
+    for (unsigned i = 0; i < LEAN_WASM_STAT_SIZES; i++) vals[n++] = (double)st.size_allocs[i];
+    vals[n++] = (double)st.frees;
+    vals[n++] = (double)st.live_bytes;
+    vals[n++] = (double)st.peak_bytes;
+    memcpy(dst, vals, (n < cap ? n : cap) * sizeof(double));
+    return n;
+#else
+    (void)dst;
+    (void)cap;
+    return 0;
+#endif
+}
+
+/** Zero the allocation counters (live bytes are kept). */
+EMSCRIPTEN_KEEPALIVE
+void js_alloc_stats_reset(void) {
+    lean_wasm_alloc_stats_reset();
+}
+
+/* ── Copy-on-write counters (LEAN_WASM_COW_STATS builds) ──────── */
+
+/**
+ * Copy the copy-on-write counters into `dst` as doubles: copies per kind,
+ * then bytes copied per kind (LEAN_WASM_COW_* order). Writes at most
+ * `cap` values. Returns the number of counters, or 0 if the build was
+ * made without LEAN_WASM_COW_STATS.
+ */
+EMSCRIPTEN_KEEPALIVE
+size_t js_cow_stats(double *dst, size_t cap) {
+#ifdef LEAN_WASM_COW_STATS
+    lean_wasm_cow_stats st;
+    lean_wasm_cow_stats_get(&st);
+    double vals[2 * LEAN_WASM_COW_KINDS];
+    size_t n = 0;
+    for (unsigned i = 0; i < LEAN_WASM_COW_KINDS; i++) vals[n++] = (double)st.copies[i];
+    for (unsigned i = 0; i < LEAN_WASM_COW_KINDS; i++) vals[n++] = (double)st.bytes[i];
+    memcpy(dst, vals, (n < cap ? n : cap) * sizeof(double));
+    return n;
+#else
+    (void)dst;
+    (void)cap;
+    return 0;
+#endif
+}
+
+/** Zero the copy-on-write counters. */
+EMSCRIPTEN_KEEPALIVE
+void js_cow_stats_reset(void) {
+    lean_wasm_cow_stats_reset();
+}
+
+/* ── Monotonic clock ──────────────────────────────────────────── */
+
+/**
+ * The runtime's monotonic clock in nanoseconds, the one behind
+ * IO.monoNanosNow. A double is exact up to 2^53 ns (about 104 days).
+ */
+EMSCRIPTEN_KEEPALIVE
+double js_now_ns(void) {
+    return (double)lean_wasm_mono_ns();
 }
 
 /* ── Memory management (called from JS to free returned buffers) ── */